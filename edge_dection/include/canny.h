@@ -1,5 +1,7 @@
 
 #include "./common/utilities.h"
+#include "./common/frame_pool.h"
+#include "./common/stream_executor.h"
 
 /**
  一维高斯卷积，对每行进行高斯卷积
@@ -12,24 +14,28 @@ void gaussianConvolution(cv::Mat &img, cv::Mat &dst);
  高斯滤波器，利用3*3的高斯模版进行高斯卷积
  img 输入原图像
  dst  高斯滤波后的输出图像
+ pool 可选的帧缓冲池，给出时输出从池中分配，在 pool->endFrame() 之前有效；
+      不给出时按 cv::Mat::create 的约定写入 dst，尺寸和类型不变就沿用原有内存（下同）
 */
-void gaussianFilter(cv::Mat &img, cv::Mat &dst);
+void gaussianFilter(cv::Mat &img, cv::Mat &dst, FramePool *pool = nullptr);
 
 /**
  用一阶偏导有限差分计算梯度幅值和方向
  img 输入原图像
  gradXY 输出的梯度幅值
  theta 输出的梯度方向
+ pool 可选的帧缓冲池
  */
-void getGrandient(cv::Mat &img, cv::Mat &gradXY, cv::Mat &theta);
+void getGrandient(cv::Mat &img, cv::Mat &gradXY, cv::Mat &theta, FramePool *pool = nullptr);
 
 /**
  局部非极大值抑制
  gradXY 输入的梯度幅值
  theta 输入的梯度方向
  dst 输出的经局部非极大值抑制后的图像
+ pool 可选的帧缓冲池
  */
-void nonLocalMaxValue(cv::Mat &gradXY, cv::Mat &theta, cv::Mat &dst);
+void nonLocalMaxValue(cv::Mat &gradXY, cv::Mat &theta, cv::Mat &dst, FramePool *pool = nullptr);
 
 /**
  弱边缘点补充连接强边缘点
@@ -43,5 +49,25 @@ void doubleThresholdLink(cv::Mat &img);
  high 输入的高阈值
  img 输入的原图像
  dst 输出的用双阈值算法检测和连接边缘后的图像
+ pool 可选的帧缓冲池
  */
-void doubleThreshold(double low, double high, cv::Mat &img, cv::Mat &dst);
\ No newline at end of file
+void doubleThreshold(double low, double high, cv::Mat &img, cv::Mat &dst, FramePool *pool = nullptr);
+
+// cannyStreamStages 各步结果在 StreamFrame::mats 中的位置
+enum CannyStreamSlot
+{
+  CannyBlurred = 0,
+  CannyGradient,
+  CannyTheta,
+  CannySuppressed,
+  CannyEdges
+};
+
+/**
+ 把 canny 的四步作为 StreamExecutor 的四个阶段：高斯滤波、梯度、非极大值抑制、双阈值
+ 输入为 StreamFrame::image（CV_8UC1），边缘图在 mats[CannyEdges]，结果与逐步调用相同
+ 各步的结果写回帧自己的 mats，帧循环复用，图像尺寸不变时各阶段不再申请内存
+ low high 同 doubleThreshold
+ cpus 依次为各阶段绑定的 CPU，未给出的阶段不绑定
+ */
+std::vector<StreamStage> cannyStreamStages(double low, double high, const std::vector<int> &cpus = {});
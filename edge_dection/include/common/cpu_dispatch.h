@@ -0,0 +1,85 @@
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+/**
+ 运行时按 CPU 指令集分派内核
+ 整个工程按基线指令集（x86-64 上为 SSE2）编译，热点循环另外为 SSE4.2、AVX2、AVX-512 各编译一份，
+ 启动后第一次使用时按 cpuid 选出本机支持的最高一档，同一个二进制可以分发到不同的机器上。
+ 放在 edge_dection 命名空间中，与 feature_descriptor 的分派层互不冲突，两个库可以链接进同一个程序。
+ */
+namespace edge_dection
+{
+enum class CpuLevel
+{
+  Baseline,
+  SSE42,  // SSE4.2 + POPCNT
+  AVX2,
+  AVX512  // AVX-512F + AVX-512BW
+};
+
+const char *cpuLevelName(CpuLevel level);
+
+// 本机（含操作系统）支持的最高一档
+CpuLevel cpuSupportedLevel();
+
+/**
+ 各内核实际使用的档位，首次调用时确定
+ 环境变量 BS_IMAGE_ISA（baseline、sse4.2、avx2、avx512）可以把档位降低，用于测试其他路径；不会高于本机支持的档位
+ */
+CpuLevel cpuLevel();
+
+/**
+ 改变各内核此后使用的档位，高于本机支持的档位时取本机支持的档位；返回此前的档位
+ 供测试在同一进程中逐档比较结果，不要在内核运行时调用
+ */
+CpuLevel setCpuLevel(CpuLevel level);
+
+namespace cpu_dispatch_detail
+{
+// flatten 把 body 及其中能内联的调用全部内联进来，按该函数的指令集重新编译
+template <class Body>
+__attribute__((noinline)) void runBaseline(Body &body)
+{
+  body();
+}
+#if defined(__x86_64__) || defined(__i386__)
+template <class Body>
+__attribute__((target("sse4.2,popcnt"), flatten, noinline)) void runSSE42(Body &body)
+{
+  body();
+}
+template <class Body>
+__attribute__((target("avx2,popcnt"), flatten, noinline)) void runAVX2(Body &body)
+{
+  body();
+}
+template <class Body>
+__attribute__((target("avx512f,avx512bw,avx2,popcnt"), flatten, noinline)) void runAVX512(Body &body)
+{
+  body();
+}
+#endif
+} // namespace cpu_dispatch_detail
+
+/**
+ 以 level 档的指令集执行 body
+ body 中的普通循环会按该档的寄存器宽度自动向量化。每次调用有一次 switch 的开销，应按行或按块调用，不要按像素调用；
+ cv::parallel_for_ 的循环体不会被内联，应在循环体内部分派。
+ level 不能高于 cpuSupportedLevel()
+ */
+template <class Body>
+void cpuDispatch(Body &&body, CpuLevel level = cpuLevel())
+{
+  switch (level)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+  case CpuLevel::AVX512: cpu_dispatch_detail::runAVX512(body); break;
+  case CpuLevel::AVX2: cpu_dispatch_detail::runAVX2(body); break;
+  case CpuLevel::SSE42: cpu_dispatch_detail::runSSE42(body); break;
+#endif
+  default: cpu_dispatch_detail::runBaseline(body); break;
+  }
+}
+} // namespace edge_dection
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <opencv2/opencv.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ 帧内图像缓冲池
+ 内存块 64 字节对齐，按大小分档（每个 2 的幂区间分 4 档，浪费不超过 25%）缓存，以 cv::Mat 头的形式分发。
+ endFrame() 把本帧分发的全部内存块放回各自的档位，下一帧直接复用；
+ 稳定之后每帧不再调用 malloc，也不再因新申请的页产生缺页。
+ 分发的 cv::Mat 不带引用计数，只在下一次 endFrame() 之前有效。
+ 一个池只供一个线程使用，多路视频流各用各的池（如 local()），彼此没有锁竞争。
+ */
+class FramePool
+{
+ public:
+  struct Stats
+  {
+    uint64_t requests     = 0; // acquire 次数
+    uint64_t hits         = 0; // 由缓存块满足的次数
+    uint64_t frames       = 0; // endFrame 次数
+    size_t reservedBytes  = 0; // 向系统申请且尚未释放的字节数（缓存 + 使用中）
+    size_t inUseBytes     = 0; // 本帧已分发的字节数
+    size_t peakInUseBytes = 0; // 单帧分发字节数的峰值
+  };
+
+  FramePool() = default;
+  ~FramePool();
+  FramePool(const FramePool &)            = delete;
+  FramePool &operator=(const FramePool &) = delete;
+
+  /**
+   分配一幅连续存储、内容未初始化的图像
+   rows, cols, type 同 cv::Mat::create
+   */
+  cv::Mat acquire(int rows, int cols, int type);
+  cv::Mat acquire(cv::Size size, int type) { return acquire(size.height, size.width, type); }
+  cv::Mat zeros(cv::Size size, int type);
+  cv::Mat clone(const cv::Mat &src);
+
+  // 回收本帧分发的全部缓冲，此前得到的 cv::Mat 随之失效
+  void endFrame();
+  // 把缓存的空闲块还给系统
+  void trim();
+
+  const Stats &stats() const { return stats_; }
+
+  // 当前线程专用的池
+  static FramePool &local();
+
+ private:
+  struct Block
+  {
+    void *data;
+    size_t bytes;
+  };
+
+  static size_t bucketSize(size_t bytes);
+
+  // 档位大小 -> 空闲块，后进先出，最近用过的块更可能还在缓存中
+  std::unordered_map<size_t, std::vector<void *>> free_;
+  std::vector<Block> in_use_;
+  Stats stats_;
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef GRADIENT_FILTER_H
+#define GRADIENT_FILTER_H
+
+#include <opencv2/opencv.hpp>
+
+/**
+ 用两个方向模板（至多 3*3，CV_32F）对灰度图卷积，输出两方向响应绝对值之和，饱和到 0~255；Sobel 与 Prewitt 共用
+ 模板元素 (h, w) 对应像素 (row + h - 1, col + w - 1)。只写除最外一圈以外的像素，边缘像素保持 output_img 原值
+ 按行计算，每次把一个模板元素作用到整行，循环可按 cpuDispatch 选出的指令集向量化；累加顺序与逐像素计算相同，结果一致
+ input_img 输入的 CV_8UC1 图像
+ output_img 输出图像，与输入同尺寸的 CV_8UC1，不能与 input_img 共用数据
+ kernel_x X 方向模板
+ kernel_y Y 方向模板
+ */
+void absGradientSum(const cv::Mat &input_img, cv::Mat &output_img, const cv::Mat &kernel_x, const cv::Mat &kernel_y);
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+/**
+ 单生产者、单消费者的无锁环形队列，元素为指针之类可以原子读写的小对象
+ 生产者只写 tail_，消费者只写 head_；另有 pushOverwrite 在队列满时由生产者丢弃最旧的元素，
+ 为此 head_ 用比较交换推进，生产者与消费者争同一个元素时只有一方成功，失败的一方重新读取。
+ 不会阻塞：满或空时返回 false，由调用方决定如何等待。
+ */
+template <class T>
+class SpscRing
+{
+  static_assert(std::is_trivially_copyable<T>::value, "SpscRing holds small trivially copyable values");
+
+ public:
+  explicit SpscRing(size_t capacity) : capacity_(capacity)
+  {
+    size_t size = 1;
+    while (size < capacity)
+    {
+      size <<= 1;
+    }
+    mask_  = size - 1;
+    slots_ = std::unique_ptr<std::atomic<T>[]>(new std::atomic<T>[size]);
+  }
+
+  SpscRing(const SpscRing &)            = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  size_t capacity() const { return capacity_; }
+
+  // 当前元素个数，其他线程调用时只是近似值
+  size_t size() const
+  {
+    const size_t t = tail_.load(std::memory_order_acquire);
+    const size_t h = head_.load(std::memory_order_acquire);
+    return t - h;
+  }
+
+  // 生产者调用
+  bool tryPush(T value)
+  {
+    const size_t t = tail_.load(std::memory_order_relaxed);
+    if (t - head_.load(std::memory_order_acquire) >= capacity_)
+    {
+      return false;
+    }
+    slots_[t & mask_].store(value, std::memory_order_relaxed);
+    tail_.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   生产者调用，总能入队；队列满时先取走最旧的元素放入 dropped，返回 true
+   */
+  bool pushOverwrite(T value, T &dropped)
+  {
+    const size_t t = tail_.load(std::memory_order_relaxed);
+    bool overwritten = false;
+    size_t h         = head_.load(std::memory_order_acquire);
+    while (t - h >= capacity_)
+    {
+      const T oldest = slots_[h & mask_].load(std::memory_order_relaxed);
+      if (head_.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+      {
+        dropped     = oldest;
+        overwritten = true;
+        break;
+      }
+      // 失败时 h 已更新为最新的 head_，消费者刚取走一个，通常已有空位
+    }
+    slots_[t & mask_].store(value, std::memory_order_relaxed);
+    tail_.store(t + 1, std::memory_order_release);
+    return overwritten;
+  }
+
+  // 消费者调用
+  bool tryPop(T &value)
+  {
+    size_t h = head_.load(std::memory_order_acquire);
+    for (;;)
+    {
+      if (h == tail_.load(std::memory_order_acquire))
+      {
+        return false;
+      }
+      const T v = slots_[h & mask_].load(std::memory_order_relaxed);
+      // 生产者可能刚把这个元素丢弃，此时交换失败，h 更新后重试
+      if (head_.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+      {
+        value = v;
+        return true;
+      }
+    }
+  }
+
+ private:
+  std::unique_ptr<std::atomic<T>[]> slots_;
+  size_t capacity_ = 0;
+  size_t mask_     = 0;
+  // 生产者与消费者各写各的缓存行
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+};
+
+#endif
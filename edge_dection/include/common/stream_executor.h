@@ -0,0 +1,145 @@
+#ifndef STREAM_EXECUTOR_H
+#define STREAM_EXECUTOR_H
+
+#include <opencv2/opencv.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/spsc_ring.h"
+
+// 每帧携带的图像个数，下标由各阶段约定（如 canny.h 中的 CannyStreamSlot）
+constexpr int kStreamSlots = 8;
+
+/**
+ 在流水线中流动的一帧
+ 帧在启动时一次分配好，处理完后回到入口复用；各图像用 create 或 copyTo 写入时，尺寸不变就不再申请内存
+ */
+struct StreamFrame
+{
+  int64_t index = -1;                                // 入队的序号，被拒绝的帧不占序号
+  std::chrono::steady_clock::time_point pushed;      // 进入流水线的时刻
+  std::chrono::steady_clock::time_point queued;      // 进入当前阶段输入队列的时刻
+  cv::Mat image;                                     // 输入图像
+  std::array<cv::Mat, kStreamSlots> mats;            // 各阶段的中间结果与输出
+  std::vector<cv::Point> points;                     // 点状结果，如角点
+  bool failed = false;                               // 某个阶段抛出了异常，后面的阶段跳过这一帧
+};
+
+/**
+ 流水线的一个阶段，在自己的线程上依次处理每一帧
+ 几个步骤写进同一个 run 即为一组，共用一个线程和一个输入队列
+ run 抛出的 std::exception 由执行器捕获并计数，这一帧作废后回到入口
+ */
+struct StreamStage
+{
+  std::string name;
+  std::function<void(StreamFrame &)> run;
+  int cpu = -1; // 绑定到的 CPU 编号，-1 不绑定
+};
+
+struct StreamOptions
+{
+  // 每个阶段的输入队列最多容纳的帧数，越小端到端延迟越低
+  size_t queueCapacity = 2;
+  // 入口队列满时：true 丢弃排队最久的帧，让新帧入队（最新帧优先）；false 拒绝新帧
+  bool dropOldest = true;
+};
+
+struct StreamStageStats
+{
+  std::string name;
+  int cpu     = -1;
+  bool pinned = false; // 是否成功绑定到 cpu
+  uint64_t frames = 0;
+  uint64_t errors = 0;      // run 抛出异常的帧，也计入 frames
+  size_t queueDepth    = 0; // 输入队列当前的帧数
+  size_t maxQueueDepth = 0; // 取帧时看到的最大帧数
+  double meanWaitMs = 0.0;  // 帧在输入队列中等待的时间
+  double maxWaitMs  = 0.0;
+  double meanRunMs  = 0.0;  // 本阶段处理一帧的时间
+  double maxRunMs   = 0.0;
+};
+
+struct StreamStats
+{
+  uint64_t pushed    = 0;
+  uint64_t dropped   = 0; // 被新帧顶替或被拒绝的帧
+  uint64_t completed = 0; // 走完全部阶段的帧
+  uint64_t failed    = 0; // 某个阶段出错而作废的帧；stop 之后 completed + failed + dropped == pushed
+  double meanLatencyMs = 0.0; // push 到最后一个阶段处理完的时间
+  double maxLatencyMs  = 0.0;
+  std::vector<StreamStageStats> stages;
+};
+
+/**
+ 多阶段视频流水线
+ 每个阶段一个线程（可绑定 CPU），相邻阶段之间是单生产者单消费者的无锁环形队列，队列中传递的是预先分配的帧。
+ 阶段内部的队列满时上游等待，压力一直传到入口；入口由 push 的线程写入，按 dropOldest 丢帧而不等待，
+ 所以采集线程不会被拖慢，排队的帧数有上限，端到端延迟也就有上限。
+ 最后一个阶段处理完的帧经一个回收队列回到入口，结果要在最后一个阶段里取走。
+ */
+class StreamExecutor
+{
+ public:
+  // 构造时启动各阶段的线程
+  explicit StreamExecutor(std::vector<StreamStage> stages, const StreamOptions &options = StreamOptions());
+  ~StreamExecutor();
+  StreamExecutor(const StreamExecutor &)            = delete;
+  StreamExecutor &operator=(const StreamExecutor &) = delete;
+
+  /**
+   送入一帧，图像复制到预分配的帧中，不会阻塞；只能由一个线程调用
+   返回是否入队，dropOldest 为 true 时总是入队（可能顶替一个排队的旧帧）；stop 之后返回 false
+   */
+  bool push(const cv::Mat &image);
+
+  // 不再接收新帧，等已入队的帧全部处理完后结束各线程；可重复调用
+  void stop();
+
+  // 任何时候都可调用，运行中得到的是近似值
+  StreamStats stats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // 各阶段线程写、stats() 读的计数，每个阶段只有自己的线程写
+  struct alignas(64) StageCounters
+  {
+    std::atomic<uint64_t> frames{0}, errors{0};
+    std::atomic<uint64_t> waitNs{0}, maxWaitNs{0};
+    std::atomic<uint64_t> runNs{0}, maxRunNs{0};
+    std::atomic<size_t> maxDepth{0};
+    std::atomic<bool> pinned{false};
+  };
+
+  void runStage(size_t i);
+  void recycle(StreamFrame *frame);
+
+  std::vector<StreamStage> stages_;
+  StreamOptions options_;
+  std::vector<std::unique_ptr<StreamFrame>> frames_;
+  // queues_[i] 是第 i 个阶段的输入队列；returned_ 把帧从最后一个阶段送回入口
+  std::vector<std::unique_ptr<SpscRing<StreamFrame *>>> queues_;
+  std::unique_ptr<SpscRing<StreamFrame *>> returned_;
+  // 只由 push 的线程使用
+  std::vector<StreamFrame *> free_;
+  int64_t next_index_ = 0;
+
+  std::unique_ptr<StageCounters[]> counters_;
+  std::atomic<uint64_t> pushed_{0}, dropped_{0}, completed_{0}, failed_{0};
+  std::atomic<uint64_t> latencyNs_{0}, maxLatencyNs_{0};
+  // upstream_done_[i] 表示第 i 个阶段的上游不会再写入
+  std::unique_ptr<std::atomic<bool>[]> upstream_done_;
+  bool stopped_ = false;
+  std::vector<std::thread> threads_;
+};
+
+#endif
@@ -1,3 +1,5 @@
 #include "./common/utilities.h"
+#include "./common/frame_pool.h"
 
-cv::Mat roberts(cv::Mat srcImage);
\ No newline at end of file
+// pool 可选的帧缓冲池，给出时输出图像从池中分配，在 pool->endFrame() 之前有效
+cv::Mat roberts(cv::Mat srcImage, FramePool *pool = nullptr);
\ No newline at end of file
@@ -1,107 +1,204 @@
 #include "canny.h"
 
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+
+#include "common/cpu_dispatch.h"
+
+namespace
+{
+// 准备输出图像：有缓冲池时从池中分配；否则按 cv::Mat::create 的约定，尺寸和类型不变就沿用 dst 原有的内存，
+// 流水线中每帧的结果图像因此不再重新分配。dst 与某个输入共用内存时换一块新内存，免得边读边写。
+// inputs 须是调用者自己的 cv::Mat 头，dst 释放后输入仍被它们引用
+void prepareOutput(cv::Mat &dst, cv::Size size, int type, FramePool *pool, std::initializer_list<const cv::Mat *> inputs)
+{
+  if (pool)
+  {
+    dst = pool->acquire(size, type);
+    return;
+  }
+  for (const cv::Mat *input : inputs)
+  {
+    if (!dst.empty() && dst.datastart == input->datastart)
+    {
+      dst.release();
+      break;
+    }
+  }
+  dst.create(size, type);
+}
+} // namespace
 
 void gaussianConvolution(cv::Mat &img, cv::Mat &dst)
 {
   int nr = img.rows;
   int nc = img.cols;
-  int templates[3] = {1, 2, 1};
 
-  // 按行遍历除每行边缘点的所有点
-  for (int j = 0; j < nr; j++)
+  // 按行遍历除每行边缘点的所有点，模板 {1, 2, 1} / 4
+  cv::parallel_for_(cv::Range(0, nr), [&](const cv::Range &range) {
+    edge_dection::cpuDispatch([&]() {
+      for (int j = range.start; j < range.end; j++)
+      {
+        const uchar *data = img.ptr<uchar>(j); // 提取该行地址
+        uchar *out        = dst.ptr<uchar>(j);
+        for (int i = 1; i < nc - 1; i++)
+        {
+          out[i] = static_cast<uchar>((data[i - 1] + 2 * data[i] + data[i + 1]) / 4);
+        }
+      }
+    });
+  });
+}
+
+
+void gaussianFilter(cv::Mat &img, cv::Mat &dst, FramePool *pool)
+{
+  // 先水平、后垂直两遍 {1, 2, 1} / 4 滤波合成一遍：输出行由相邻三行的水平滤波结果按列滤波得到，
+  // 首末两行就是水平滤波结果，水平滤波不动首末两列。逐点重算水平滤波结果，代替整幅中间图像，结果与两遍相同
+  const cv::Mat src = img;
+  prepareOutput(dst, src.size(), src.type(), pool, {&src});
+  const int nr = src.rows;
+  const int nc = src.cols;
+  if (nr == 0 || nc == 0)
   {
-    uchar *data = img.ptr<uchar>(j); // 提取该行地址
+    return;
+  }
+
+  auto horizontalRow = [nc](const uchar *in, uchar *out) {
+    out[0]      = in[0];
+    out[nc - 1] = in[nc - 1];
     for (int i = 1; i < nc - 1; i++)
     {
-      int sum = 0;
-      for (int n = 0; n < 3; n++)
+      out[i] = static_cast<uchar>((in[i - 1] + 2 * in[i] + in[i + 1]) / 4);
+    }
+  };
+  horizontalRow(src.ptr<uchar>(0), dst.ptr<uchar>(0));
+  horizontalRow(src.ptr<uchar>(nr - 1), dst.ptr<uchar>(nr - 1));
+  cv::parallel_for_(cv::Range(1, std::max(nr - 1, 1)), [&](const cv::Range &range) {
+    edge_dection::cpuDispatch([&]() {
+      for (int j = range.start; j < range.end; j++)
       {
-        sum += data[i - 1 + n] * templates[n]; // 累加
+        const uchar *up   = src.ptr<uchar>(j - 1);
+        const uchar *mid  = src.ptr<uchar>(j);
+        const uchar *down = src.ptr<uchar>(j + 1);
+        uchar *out        = dst.ptr<uchar>(j);
+        for (int i : {0, nc - 1})
+        {
+          out[i] = static_cast<uchar>((up[i] + 2 * mid[i] + down[i]) / 4);
+        }
+        for (int i = 1; i < nc - 1; i++)
+        {
+          const int a = (up[i - 1] + 2 * up[i] + up[i + 1]) / 4;
+          const int b = (mid[i - 1] + 2 * mid[i] + mid[i + 1]) / 4;
+          const int c = (down[i - 1] + 2 * down[i] + down[i + 1]) / 4;
+          out[i]      = static_cast<uchar>((a + 2 * b + c) / 4);
+        }
       }
-      sum /= 4;
-      dst.ptr<uchar>(j)[i] = sum;
-    }
-  }
+    });
+  });
 }
 
 
-void gaussianFilter(cv::Mat &img, cv::Mat &dst)
+void getGrandient(cv::Mat &img, cv::Mat &gradXY, cv::Mat &theta, FramePool *pool)
 {
-  // 对水平方向进行滤波
-  cv::Mat dst1 = img.clone();
-  gaussianConvolution(img, dst1);
-  // 图像矩阵转置
-  cv::Mat dst2;
-  transpose(dst1, dst2);
-  // 对垂直方向进行滤波
-  cv::Mat dst3 = dst2.clone();
-  gaussianConvolution(dst2, dst3);
-  // 再次转置
-  transpose(dst3, dst);
+  const cv::Mat src = img;
+  prepareOutput(gradXY, src.size(), CV_8U, pool, {&src});
+  prepareOutput(theta, src.size(), CV_8U, pool, {&src, &gradXY});
+  // 边界一圈不计算，置 0
+  const int nr = src.rows;
+  const int nc = src.cols;
+  if (nr == 0 || nc == 0)
+  {
+    return;
+  }
+  for (int j : {0, nr - 1})
+  {
+    std::fill(gradXY.ptr<uchar>(j), gradXY.ptr<uchar>(j) + nc, uchar(0));
+    std::fill(theta.ptr<uchar>(j), theta.ptr<uchar>(j) + nc, uchar(0));
+  }
+
+  // 方向 atan(gradY / gradX) 存为 uchar 时截断为 -1、0、1（即 255、0、1），0 / 0 为 0。
+  // 直接比较 gradY / gradX 与 tan(1) 得到相同的值：可达的比值离 tan(1) 都远大于 atan 的误差，且不调用 atan，循环可以向量化
+  const double tan1 = std::tan(1.0);
+  cv::parallel_for_(cv::Range(1, std::max(nr - 1, 1)), [&](const cv::Range &range) {
+    edge_dection::cpuDispatch([&]() {
+      for (int j = range.start; j < range.end; j++)
+      {
+        const uchar *up   = src.ptr<uchar>(j - 1);
+        const uchar *mid  = src.ptr<uchar>(j);
+        const uchar *down = src.ptr<uchar>(j + 1);
+        uchar *grad       = gradXY.ptr<uchar>(j);
+        uchar *dir        = theta.ptr<uchar>(j);
+        grad[0] = grad[nc - 1] = 0;
+        dir[0] = dir[nc - 1] = 0;
+        for (int i = 1; i < nc - 1; i++)
+        {
+          double gradY = double(up[i - 1] + 2 * up[i] + up[i + 1] - down[i - 1] - 2 * down[i] - down[i + 1]);
+          double gradX = double(up[i + 1] + 2 * mid[i + 1] + down[i + 1] - up[i - 1] - 2 * mid[i - 1] - down[i - 1]);
+
+          // 计算梯度，超过 255 时取低 8 位，与此前 double 直接赋给 uchar 的结果相同
+          grad[i] = static_cast<uchar>(static_cast<int>(std::sqrt(gradX * gradX + gradY * gradY)));
+          // 计算梯度方向
+          const double ratio = gradY / gradX;
+          dir[i]             = ratio >= tan1 ? 1 : (ratio <= -tan1 ? 255 : 0);
+        }
+      }
+    });
+  });
 }
 
 
-void getGrandient(cv::Mat &img, cv::Mat &gradXY, cv::Mat &theta)
+void nonLocalMaxValue(cv::Mat &gradXY, cv::Mat &theta, cv::Mat &dst, FramePool *pool)
 {
-  gradXY = cv::Mat::zeros(img.size(), CV_8U);
-  theta = cv::Mat::zeros(img.size(), CV_8U);
+  const cv::Mat grad = gradXY, dir = theta;
+  prepareOutput(dst, grad.size(), grad.type(), pool, {&grad, &dir});
+  grad.copyTo(dst);
 
-  for (int j = 1; j < img.rows - 1; j++)
+  // 每个方向值对应的两个比较点相对当前点的偏移，判断条件与逐点计算时相同
+  const int step = static_cast<int>(dst.step);
+  int offset0[256], offset1[256];
+  for (int v = 0; v < 256; v++)
   {
-    for (int i = 1; i < img.cols - 1; i++)
+    double t = double(v);
+    if ((-(3 * M_PI / 8) <= t) && (t < -(M_PI / 8))) // -67.5  -22.5
     {
-      double gradY = double(img.ptr<uchar>(j - 1)[i - 1] + 2 * img.ptr<uchar>(j - 1)[i] + img.ptr<uchar>(j - 1)[i + 1] -
-                            img.ptr<uchar>(j + 1)[i - 1] - 2 * img.ptr<uchar>(j + 1)[i] - img.ptr<uchar>(j + 1)[i + 1]);
-      double gradX = double(img.ptr<uchar>(j - 1)[i + 1] + 2 * img.ptr<uchar>(j)[i + 1] + img.ptr<uchar>(j + 1)[i + 1] -
-                            img.ptr<uchar>(j - 1)[i - 1] - 2 * img.ptr<uchar>(j)[i - 1] - img.ptr<uchar>(j + 1)[i - 1]);
-
-      gradXY.ptr<uchar>(j)[i] = sqrt(gradX * gradX + gradY * gradY); // 计算梯度
-      theta.ptr<uchar>(j)[i] = atan(gradY / gradX);                  // 计算梯度方向
+      offset0[v] = -step - 1;
+      offset1[v] = step + 1;
+    }
+    else if ((t >= -(M_PI / 8)) && (t < M_PI / 8)) // -22.5  22.5
+    {
+      offset0[v] = -1;
+      offset1[v] = 1;
+    }
+    else if ((t >= M_PI / 8) && (t < 3 * M_PI / 8)) // 22.5  67.5
+    {
+      offset0[v] = -step + 1;
+      offset1[v] = step - 1;
+    }
+    else // 67.5  90    -90  -67.5
+    {
+      offset0[v] = -step;
+      offset1[v] = step;
     }
   }
-}
 
-
-void nonLocalMaxValue(cv::Mat &gradXY, cv::Mat &theta, cv::Mat &dst)
-{
-  dst = gradXY.clone();
-  for (int j = 1; j < gradXY.rows - 1; j++)
+  // 被抑制的点会参与右侧和下一行的比较（读的是修改后的 dst），所以必须按行、按列顺序处理，不能向量化
+  for (int j = 1; j < grad.rows - 1; j++)
   {
-    for (int i = 1; i < gradXY.cols - 1; i++)
+    const uchar *t = dir.ptr<uchar>(j);
+    uchar *p       = dst.ptr<uchar>(j);
+    for (int i = 1; i < grad.cols - 1; i++)
     {
-      double t = double(theta.ptr<uchar>(j)[i]);
-      double g = double(dst.ptr<uchar>(j)[i]);
-      if (g == 0.0)
+      const uchar g = p[i];
+      if (g == 0)
       {
         continue;
       }
-
       // find local max
-      double g0, g1;
-      if ((-(3 * M_PI / 8) <= t) && (t < -(M_PI / 8))) // -67.5  -22.5
-      {
-        g0 = double(dst.ptr<uchar>(j - 1)[i - 1]);
-        g1 = double(dst.ptr<uchar>(j + 1)[i + 1]);
-      }
-      else if ((t >= -(M_PI / 8)) && (t < M_PI / 8)) // -22.5  22.5
+      if (g <= p[i + offset0[t[i]]] || g <= p[i + offset1[t[i]]])
       {
-        g0 = double(dst.ptr<uchar>(j)[i - 1]);
-        g1 = double(dst.ptr<uchar>(j)[i + 1]);
-      }
-      else if ((t >= M_PI / 8) && (t < 3 * M_PI / 8)) // 22.5  67.5
-      {
-        g0 = double(dst.ptr<uchar>(j - 1)[i + 1]);
-        g1 = double(dst.ptr<uchar>(j + 1)[i - 1]);
-      }
-      else // 67.5  90    -90  -67.5
-      {
-        g0 = double(dst.ptr<uchar>(j - 1)[i]);
-        g1 = double(dst.ptr<uchar>(j + 1)[i]);
-      }
-
-      if (g <= g0 || g <= g1)
-      {
-        dst.ptr<uchar>(j)[i] = 0.0;
+        p[i] = 0;
       }
     }
   }
@@ -134,43 +231,70 @@ void doubleThresholdLink(cv::Mat &img)
     }
   }
 
-  for (int j = 0; j < img.rows - 1; j++)
-  {
-    for (int i = 0; i < img.cols - 1; i++)
-    {
-      // 如果该点依旧是弱边缘点，及此点是孤立边缘点
-      if (img.ptr<uchar>(j)[i] != 255 && img.ptr<uchar>(j)[i] != 255)
+  cv::parallel_for_(cv::Range(0, std::max(img.rows - 1, 0)), [&](const cv::Range &range) {
+    edge_dection::cpuDispatch([&]() {
+      for (int j = range.start; j < range.end; j++)
       {
-        img.ptr<uchar>(j)[i] = 0; // 该孤立弱边缘点抑制
+        uchar *p = img.ptr<uchar>(j);
+        for (int i = 0; i < img.cols - 1; i++)
+        {
+          // 如果该点依旧是弱边缘点，及此点是孤立边缘点，则抑制
+          p[i] = p[i] == 255 ? 255 : 0;
+        }
       }
-    }
-  }
+    });
+  });
 }
 
 
-void doubleThreshold(double low, double high, cv::Mat &img, cv::Mat &dst)
+void doubleThreshold(double low, double high, cv::Mat &img, cv::Mat &dst, FramePool *pool)
 {
-  dst = img.clone();
+  const cv::Mat src = img;
+  prepareOutput(dst, src.size(), src.type(), pool, {&src});
+  src.copyTo(dst);
 
-  // 区分出弱边缘点和强边缘点
-  for (int j = 0; j < img.rows - 1; j++)
+  // 区分出弱边缘点和强边缘点。像素值是整数，两个阈值换成整数界限：
+  // 不小于 strong 的为强边缘点，置255；其余小于 weak 的置0，被抑制掉
+  int strong = 0;
+  while (strong < 256 && !(double(strong) > high))
   {
-    for (int i = 0; i < img.cols - 1; i++)
-    {
-      double x = double(dst.ptr<uchar>(j)[i]);
-      // 像素点为强边缘点，置255
-      if (x > high)
-      {
-        dst.ptr<uchar>(j)[i] = 255;
-      }
-      // 像素点置0，被抑制掉
-      else if (x < low)
+    strong++;
+  }
+  int weak = 0;
+  while (weak < 256 && double(weak) < low)
+  {
+    weak++;
+  }
+  cv::parallel_for_(cv::Range(0, std::max(src.rows - 1, 0)), [&](const cv::Range &range) {
+    edge_dection::cpuDispatch([&]() {
+      for (int j = range.start; j < range.end; j++)
       {
-        dst.ptr<uchar>(j)[i] = 0;
+        uchar *p = dst.ptr<uchar>(j);
+        for (int i = 0; i < src.cols - 1; i++)
+        {
+          const int x = p[i];
+          p[i]        = x >= strong ? 255 : (x < weak ? 0 : x);
+        }
       }
-    }
-  }
+    });
+  });
 
   // 弱边缘点补充连接强边缘点
   doubleThresholdLink(dst);
-}
\ No newline at end of file
+}
+
+
+std::vector<StreamStage> cannyStreamStages(double low, double high, const std::vector<int> &cpus)
+{
+  std::vector<StreamStage> stages = {
+    {"gaussian", [](StreamFrame &f) { gaussianFilter(f.image, f.mats[CannyBlurred]); }},
+    {"gradient", [](StreamFrame &f) { getGrandient(f.mats[CannyBlurred], f.mats[CannyGradient], f.mats[CannyTheta]); }},
+    {"nms", [](StreamFrame &f) { nonLocalMaxValue(f.mats[CannyGradient], f.mats[CannyTheta], f.mats[CannySuppressed]); }},
+    {"threshold", [low, high](StreamFrame &f) { doubleThreshold(low, high, f.mats[CannySuppressed], f.mats[CannyEdges]); }},
+  };
+  for (size_t i = 0; i < stages.size() && i < cpus.size(); i++)
+  {
+    stages[i].cpu = cpus[i];
+  }
+  return stages;
+}
@@ -0,0 +1,76 @@
+#include "common/cpu_dispatch.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace edge_dection
+{
+const char *cpuLevelName(CpuLevel level)
+{
+  switch (level)
+  {
+  case CpuLevel::SSE42: return "sse4.2";
+  case CpuLevel::AVX2: return "avx2";
+  case CpuLevel::AVX512: return "avx512";
+  default: return "baseline";
+  }
+}
+
+CpuLevel cpuSupportedLevel()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  // __builtin_cpu_supports 同时检查操作系统是否保存 AVX / AVX-512 寄存器
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+  {
+    return CpuLevel::AVX512;
+  }
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return CpuLevel::AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+  {
+    return CpuLevel::SSE42;
+  }
+#endif
+  return CpuLevel::Baseline;
+}
+
+static CpuLevel selectLevel()
+{
+  const CpuLevel supported = cpuSupportedLevel();
+  const char *env          = std::getenv("BS_IMAGE_ISA");
+  if (env == nullptr)
+  {
+    return supported;
+  }
+  for (CpuLevel level : {CpuLevel::Baseline, CpuLevel::SSE42, CpuLevel::AVX2, CpuLevel::AVX512})
+  {
+    if (std::strcmp(env, cpuLevelName(level)) == 0)
+    {
+      return level < supported ? level : supported;
+    }
+  }
+  std::cerr << "BS_IMAGE_ISA=" << env << " 无效（可选 baseline、sse4.2、avx2、avx512），已忽略" << std::endl;
+  return supported;
+}
+
+static std::atomic<CpuLevel> &currentLevel()
+{
+  static std::atomic<CpuLevel> level{selectLevel()};
+  return level;
+}
+
+CpuLevel cpuLevel()
+{
+  return currentLevel().load(std::memory_order_relaxed);
+}
+
+CpuLevel setCpuLevel(CpuLevel level)
+{
+  const CpuLevel supported = cpuSupportedLevel();
+  return currentLevel().exchange(level < supported ? level : supported, std::memory_order_relaxed);
+}
+} // namespace edge_dection
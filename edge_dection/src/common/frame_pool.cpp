@@ -0,0 +1,100 @@
+#include "common/frame_pool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+FramePool::~FramePool()
+{
+  endFrame();
+  trim();
+}
+
+size_t FramePool::bucketSize(size_t bytes)
+{
+  size_t pow2 = 64;
+  while (pow2 < bytes)
+  {
+    pow2 <<= 1;
+  }
+  if (pow2 <= 256)
+  {
+    return pow2;
+  }
+  // (pow2 / 2, pow2] 分为 4 档，档宽是 64 的倍数
+  const size_t step = pow2 / 8;
+  return (bytes + step - 1) / step * step;
+}
+
+cv::Mat FramePool::acquire(int rows, int cols, int type)
+{
+  CV_Assert(rows > 0 && cols > 0);
+  const size_t bytes = bucketSize(static_cast<size_t>(rows) * cols * CV_ELEM_SIZE(type));
+  ++stats_.requests;
+
+  void *data                  = nullptr;
+  std::vector<void *> &bucket = free_[bytes];
+  if (!bucket.empty())
+  {
+    data = bucket.back();
+    bucket.pop_back();
+    ++stats_.hits;
+  }
+  else
+  {
+    data = std::aligned_alloc(64, bytes);
+    if (data == nullptr)
+    {
+      CV_Error(cv::Error::StsNoMem, "FramePool: out of memory");
+    }
+    stats_.reservedBytes += bytes;
+  }
+  in_use_.push_back({data, bytes});
+  stats_.inUseBytes += bytes;
+  stats_.peakInUseBytes = std::max(stats_.peakInUseBytes, stats_.inUseBytes);
+  return cv::Mat(rows, cols, type, data);
+}
+
+cv::Mat FramePool::zeros(cv::Size size, int type)
+{
+  cv::Mat m = acquire(size, type);
+  std::memset(m.data, 0, m.total() * m.elemSize());
+  return m;
+}
+
+cv::Mat FramePool::clone(const cv::Mat &src)
+{
+  cv::Mat m = acquire(src.size(), src.type());
+  src.copyTo(m);
+  return m;
+}
+
+void FramePool::endFrame()
+{
+  for (const Block &b : in_use_)
+  {
+    free_[b.bytes].push_back(b.data);
+  }
+  in_use_.clear();
+  stats_.inUseBytes = 0;
+  ++stats_.frames;
+}
+
+void FramePool::trim()
+{
+  for (auto &bucket : free_)
+  {
+    for (void *data : bucket.second)
+    {
+      std::free(data);
+      stats_.reservedBytes -= bucket.first;
+    }
+  }
+  free_.clear();
+}
+
+FramePool &FramePool::local()
+{
+  static thread_local FramePool pool;
+  return pool;
+}
@@ -0,0 +1,73 @@
+#include "common/gradient_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "common/cpu_dispatch.h"
+
+namespace
+{
+/**
+ 与 cv::saturate_cast<uchar>(v) 相同（v >= 0）：就近舍入、相等时取偶，再饱和到 255
+ 加减 1.5 * 2^23 在默认舍入模式下正是就近取偶，且只用加减法，可以向量化
+ */
+inline uchar roundToUchar(float v)
+{
+  const float magic = 12582912.0f;
+  const float r     = (std::min(v, 256.0f) + magic) - magic;
+  return static_cast<uchar>(std::min(r, 255.0f));
+}
+
+// 模板的一行作用到输入的一行，累加到 acc 的第 1 ~ width-2 列
+inline void accumulateRow(const uchar *in, const float *k, int kernel_cols, int width, float *acc)
+{
+  for (int w = 0; w < kernel_cols; ++w)
+  {
+    const float kw   = k[w];
+    const uchar *src = in + w - 1;
+    for (int col = 1; col < width - 1; ++col)
+    {
+      acc[col] += src[col] * kw;
+    }
+  }
+}
+} // namespace
+
+void absGradientSum(const cv::Mat &input_img, cv::Mat &output_img, const cv::Mat &kernel_x, const cv::Mat &kernel_y)
+{
+  CV_Assert(input_img.type() == CV_8UC1 && output_img.type() == CV_8UC1 && output_img.size() == input_img.size());
+  CV_Assert(kernel_x.type() == CV_32FC1 && kernel_x.rows <= 3 && kernel_x.cols <= 3);
+  CV_Assert(kernel_y.type() == CV_32FC1 && kernel_y.rows <= 3 && kernel_y.cols <= 3);
+  const int height = input_img.rows;
+  const int width  = input_img.cols;
+  if (height < 3 || width < 3)
+  {
+    return;
+  }
+
+  cv::parallel_for_(cv::Range(1, height - 1), [&](const cv::Range &range) {
+    std::vector<float> gx(width), gy(width);
+    edge_dection::cpuDispatch([&]() {
+      for (int row = range.start; row < range.end; ++row)
+      {
+        std::fill(gx.begin(), gx.end(), 0.0f);
+        std::fill(gy.begin(), gy.end(), 0.0f);
+        // 与逐像素计算相同的顺序：先 X 模板的各行各列，再 Y 模板
+        for (int h = 0; h < kernel_x.rows; ++h)
+        {
+          accumulateRow(input_img.ptr<uchar>(row + h - 1), kernel_x.ptr<float>(h), kernel_x.cols, width, gx.data());
+        }
+        for (int h = 0; h < kernel_y.rows; ++h)
+        {
+          accumulateRow(input_img.ptr<uchar>(row + h - 1), kernel_y.ptr<float>(h), kernel_y.cols, width, gy.data());
+        }
+        uchar *out = output_img.ptr<uchar>(row);
+        for (int col = 1; col < width - 1; ++col)
+        {
+          out[col] = roundToUchar(std::abs(gx[col]) + std::abs(gy[col]));
+        }
+      }
+    });
+  });
+}
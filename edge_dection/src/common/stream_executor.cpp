@@ -0,0 +1,303 @@
+#include "common/stream_executor.h"
+
+#include <algorithm>
+#include <exception>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+// 先空转，再让出时间片，最后短暂休眠，空闲的阶段不会一直占着自己的核
+class Backoff
+{
+ public:
+  void wait()
+  {
+    if (spins_ < 16)
+    {
+      ++spins_;
+    }
+    else if (spins_ < 64)
+    {
+      ++spins_;
+      std::this_thread::yield();
+    }
+    else
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+  void reset() { spins_ = 0; }
+
+ private:
+  int spins_ = 0;
+};
+
+bool pinCurrentThread(int cpu)
+{
+#ifdef __linux__
+  if (cpu < 0 || cpu >= CPU_SETSIZE)
+  {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)cpu;
+  return false;
+#endif
+}
+
+uint64_t nanoseconds(std::chrono::steady_clock::duration d)
+{
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+// 只有一个线程写 value，不需要比较交换
+template <class T>
+void storeMax(std::atomic<T> &value, T v)
+{
+  if (v > value.load(std::memory_order_relaxed))
+  {
+    value.store(v, std::memory_order_relaxed);
+  }
+}
+
+double milliseconds(uint64_t ns) { return ns * 1e-6; }
+} // namespace
+
+StreamExecutor::StreamExecutor(std::vector<StreamStage> stages, const StreamOptions &options)
+  : stages_(std::move(stages)), options_(options)
+{
+  CV_Assert(!stages_.empty() && options_.queueCapacity > 0);
+  for (const StreamStage &stage : stages_)
+  {
+    CV_Assert(stage.run);
+  }
+  const size_t n = stages_.size();
+
+  // 在途的帧至多为各输入队列的容量加上每个阶段手里的一帧，再多一帧供 push 写入，入口就不会缺帧
+  const size_t count = n * (options_.queueCapacity + 1) + 1;
+  frames_.reserve(count);
+  free_.reserve(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    frames_.emplace_back(new StreamFrame());
+    free_.push_back(frames_.back().get());
+  }
+  for (size_t i = 0; i < n; ++i)
+  {
+    queues_.emplace_back(new SpscRing<StreamFrame *>(options_.queueCapacity));
+  }
+  returned_.reset(new SpscRing<StreamFrame *>(count));
+
+  counters_.reset(new StageCounters[n]);
+  upstream_done_.reset(new std::atomic<bool>[n]);
+  for (size_t i = 0; i < n; ++i)
+  {
+    upstream_done_[i].store(false);
+  }
+  threads_.reserve(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    threads_.emplace_back(&StreamExecutor::runStage, this, i);
+  }
+}
+
+StreamExecutor::~StreamExecutor()
+{
+  stop();
+}
+
+bool StreamExecutor::push(const cv::Mat &image)
+{
+  if (stopped_)
+  {
+    return false;
+  }
+  StreamFrame *frame = nullptr;
+  while (returned_->tryPop(frame))
+  {
+    free_.push_back(frame);
+  }
+  pushed_.fetch_add(1, std::memory_order_relaxed);
+  if (free_.empty())
+  {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  frame = free_.back();
+  free_.pop_back();
+  image.copyTo(frame->image);
+  frame->points.clear();
+  frame->failed = false;
+  frame->index  = next_index_;
+  frame->pushed = Clock::now();
+  frame->queued = frame->pushed;
+
+  SpscRing<StreamFrame *> &entry = *queues_[0];
+  if (!options_.dropOldest)
+  {
+    if (!entry.tryPush(frame))
+    {
+      free_.push_back(frame);
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    ++next_index_;
+    return true;
+  }
+  ++next_index_;
+  StreamFrame *oldest = nullptr;
+  if (entry.pushOverwrite(frame, oldest))
+  {
+    free_.push_back(oldest);
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+void StreamExecutor::stop()
+{
+  if (stopped_)
+  {
+    return;
+  }
+  stopped_ = true;
+  upstream_done_[0].store(true, std::memory_order_release);
+  for (std::thread &t : threads_)
+  {
+    t.join();
+  }
+}
+
+void StreamExecutor::runStage(size_t i)
+{
+  const StreamStage &stage = stages_[i];
+  StageCounters &counters  = counters_[i];
+  counters.pinned.store(pinCurrentThread(stage.cpu), std::memory_order_relaxed);
+
+  SpscRing<StreamFrame *> &in = *queues_[i];
+  const bool last              = i + 1 == stages_.size();
+  Backoff backoff;
+  for (;;)
+  {
+    const size_t depth = in.size();
+    StreamFrame *frame = nullptr;
+    if (!in.tryPop(frame))
+    {
+      // 上游结束后不再有写入，再取一次仍为空，队列就空了
+      if (upstream_done_[i].load(std::memory_order_acquire) && !in.tryPop(frame))
+      {
+        break;
+      }
+      if (frame == nullptr)
+      {
+        backoff.wait();
+        continue;
+      }
+    }
+    backoff.reset();
+
+    // 出错的帧照常往下传，由最后一个阶段送回入口，每个队列仍只有一个生产者
+    if (!frame->failed)
+    {
+      const Clock::time_point start = Clock::now();
+      try
+      {
+        stage.run(*frame);
+      }
+      catch (const std::exception &)
+      {
+        // 异常逃出线程会终止整个进程，只作废这一帧
+        frame->failed = true;
+        counters.errors.fetch_add(1, std::memory_order_relaxed);
+      }
+      const Clock::time_point end = Clock::now();
+
+      const uint64_t wait = nanoseconds(start - frame->queued);
+      const uint64_t run  = nanoseconds(end - start);
+      counters.waitNs.fetch_add(wait, std::memory_order_relaxed);
+      counters.runNs.fetch_add(run, std::memory_order_relaxed);
+      storeMax(counters.maxWaitNs, wait);
+      storeMax(counters.maxRunNs, run);
+      storeMax(counters.maxDepth, depth);
+      counters.frames.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (last)
+    {
+      recycle(frame);
+      continue;
+    }
+    frame->queued = Clock::now();
+    SpscRing<StreamFrame *> &out = *queues_[i + 1];
+    Backoff full;
+    while (!out.tryPush(frame))
+    {
+      full.wait();
+    }
+  }
+  if (!last)
+  {
+    upstream_done_[i + 1].store(true, std::memory_order_release);
+  }
+}
+
+void StreamExecutor::recycle(StreamFrame *frame)
+{
+  if (frame->failed)
+  {
+    failed_.fetch_add(1, std::memory_order_relaxed);
+    returned_->tryPush(frame);
+    return;
+  }
+  const uint64_t latency = nanoseconds(Clock::now() - frame->pushed);
+  latencyNs_.fetch_add(latency, std::memory_order_relaxed);
+  storeMax(maxLatencyNs_, latency);
+  completed_.fetch_add(1, std::memory_order_relaxed);
+  // 容量等于帧数，不会满
+  returned_->tryPush(frame);
+}
+
+StreamStats StreamExecutor::stats() const
+{
+  StreamStats s;
+  s.pushed    = pushed_.load(std::memory_order_relaxed);
+  s.dropped   = dropped_.load(std::memory_order_relaxed);
+  s.completed = completed_.load(std::memory_order_relaxed);
+  s.failed    = failed_.load(std::memory_order_relaxed);
+  if (s.completed > 0)
+  {
+    s.meanLatencyMs = milliseconds(latencyNs_.load(std::memory_order_relaxed)) / s.completed;
+  }
+  s.maxLatencyMs = milliseconds(maxLatencyNs_.load(std::memory_order_relaxed));
+
+  for (size_t i = 0; i < stages_.size(); ++i)
+  {
+    const StageCounters &c = counters_[i];
+    StreamStageStats st;
+    st.name          = stages_[i].name;
+    st.cpu           = stages_[i].cpu;
+    st.pinned        = c.pinned.load(std::memory_order_relaxed);
+    st.frames        = c.frames.load(std::memory_order_relaxed);
+    st.errors        = c.errors.load(std::memory_order_relaxed);
+    st.queueDepth    = queues_[i]->size();
+    st.maxQueueDepth = c.maxDepth.load(std::memory_order_relaxed);
+    if (st.frames > 0)
+    {
+      st.meanWaitMs = milliseconds(c.waitNs.load(std::memory_order_relaxed)) / st.frames;
+      st.meanRunMs  = milliseconds(c.runNs.load(std::memory_order_relaxed)) / st.frames;
+    }
+    st.maxWaitMs = milliseconds(c.maxWaitNs.load(std::memory_order_relaxed));
+    st.maxRunMs  = milliseconds(c.maxRunNs.load(std::memory_order_relaxed));
+    s.stages.push_back(st);
+  }
+  return s;
+}
@@ -1,23 +1,33 @@
 #include "roberts.h"
 
+#include <algorithm>
+#include <cmath>
 
-cv::Mat roberts(cv::Mat srcImage)
+#include "common/cpu_dispatch.h"
+
+
+cv::Mat roberts(cv::Mat srcImage, FramePool *pool)
 {
-  cv::Mat dstImage = srcImage.clone();
+  cv::Mat dstImage = pool ? pool->clone(srcImage) : srcImage.clone();
   int nRows = dstImage.rows;
   int nCols = dstImage.cols;
-  for (int i = 0; i < nRows - 1; i++)
-  {
-    for (int j = 0; j < nCols - 1; j++)
-    {
-      // 根据公式计算
-      int t1 = (srcImage.at<uchar>(i, j) - srcImage.at<uchar>(i + 1, j + 1)) *
-               (srcImage.at<uchar>(i, j) - srcImage.at<uchar>(i + 1, j + 1));
-      int t2 = (srcImage.at<uchar>(i + 1, j) - srcImage.at<uchar>(i, j + 1)) *
-               (srcImage.at<uchar>(i + 1, j) - srcImage.at<uchar>(i, j + 1));
-      // 计算g（x,y）
-      dstImage.at<uchar>(i, j) = (uchar)sqrt(t1 + t2);
-    }
-  }
+  cv::parallel_for_(cv::Range(0, std::max(nRows - 1, 0)), [&](const cv::Range &range) {
+    edge_dection::cpuDispatch([&]() {
+      for (int i = range.start; i < range.end; i++)
+      {
+        const uchar *p = srcImage.ptr<uchar>(i);
+        const uchar *q = srcImage.ptr<uchar>(i + 1);
+        uchar *out     = dstImage.ptr<uchar>(i);
+        for (int j = 0; j < nCols - 1; j++)
+        {
+          // 根据公式计算
+          int t1 = (p[j] - q[j + 1]) * (p[j] - q[j + 1]);
+          int t2 = (q[j] - p[j + 1]) * (q[j] - p[j + 1]);
+          // 计算g（x,y），超过 255 时取低 8 位，与此前 (uchar) 转换的结果相同
+          out[j] = static_cast<uchar>(static_cast<int>(std::sqrt(t1 + t2)));
+        }
+      }
+    });
+  });
   return dstImage;
-}
\ No newline at end of file
+}
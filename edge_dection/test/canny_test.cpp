@@ -4,6 +4,17 @@
 #include <gtest/gtest.h>
 
 #include "canny.h"
+#include "common/cpu_dispatch.h"
+#include "common/gradient_filter.h"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 TEST(CannyTest, test1)
 {
@@ -42,6 +53,252 @@ TEST(CannyTest, test1)
   cv::waitKey(); // 等待键值输入
 }
 
+// 合成的测试图：明暗相间的块加噪声，每帧不同
+static cv::Mat syntheticFrame(int index)
+{
+  cv::Mat img(120, 160, CV_8UC1);
+  for (int r = 0; r < img.rows; r++)
+  {
+    for (int c = 0; c < img.cols; c++)
+    {
+      const bool bright   = ((r + index) / 16 + c / 20) % 2 == 0;
+      img.at<uchar>(r, c) = static_cast<uchar>((bright ? 190 : 40) + (r * 131 + c * 71 + index * 29) % 40);
+    }
+  }
+  return img;
+}
+
+// 本机支持的每一档指令集与基线的结果逐字节相同
+TEST(CannyTest, cpuLevelsMatchBaseline)
+{
+  const float sobel_x[9] = {-1, 0, 1, -2, 0, 2, -1, 0, 1};
+  const float sobel_y[9] = {-1, -2, -1, 0, 0, 0, 1, 2, 1};
+  const cv::Mat kernel_x = cv::Mat(3, 3, CV_32F, const_cast<float *>(sobel_x)).clone();
+  const cv::Mat kernel_y = cv::Mat(3, 3, CV_32F, const_cast<float *>(sobel_y)).clone();
+
+  // 宽度不是向量宽度的整数倍，覆盖各档的尾部处理
+  std::mt19937 rng(7);
+  std::vector<cv::Mat> images;
+  for (const cv::Size &size : {cv::Size(3, 3), cv::Size(17, 5), cv::Size(131, 67)})
+  {
+    cv::Mat img(size, CV_8UC1);
+    for (int r = 0; r < img.rows; r++)
+    {
+      for (int c = 0; c < img.cols; c++)
+      {
+        img.at<uchar>(r, c) = static_cast<uchar>(rng() % 256);
+      }
+    }
+    images.push_back(img);
+  }
+
+  // 每幅图依次为高斯滤波、梯度幅值、梯度方向、非极大值抑制、双阈值、absGradientSum 的结果
+  auto run = [&](const cv::Mat &input) {
+    cv::Mat img = input;
+    std::vector<cv::Mat> out(6);
+    gaussianFilter(img, out[0]);
+    getGrandient(out[0], out[1], out[2]);
+    nonLocalMaxValue(out[1], out[2], out[3]);
+    doubleThreshold(40, 80, out[3], out[4]);
+    out[5] = cv::Mat::zeros(img.size(), CV_8UC1);
+    absGradientSum(img, out[5], kernel_x, kernel_y);
+    return out;
+  };
+
+  const edge_dection::CpuLevel initial = edge_dection::setCpuLevel(edge_dection::CpuLevel::Baseline);
+  std::vector<std::vector<cv::Mat>> expected;
+  for (const cv::Mat &img : images)
+  {
+    expected.push_back(run(img));
+  }
+
+  const edge_dection::CpuLevel supported = edge_dection::cpuSupportedLevel();
+  for (edge_dection::CpuLevel level : {edge_dection::CpuLevel::SSE42, edge_dection::CpuLevel::AVX2, edge_dection::CpuLevel::AVX512})
+  {
+    if (level > supported)
+    {
+      break;
+    }
+    edge_dection::setCpuLevel(level);
+    ASSERT_EQ(edge_dection::cpuLevel(), level);
+    int calls = 0;
+    edge_dection::cpuDispatch([&]() { calls++; }, level);
+    EXPECT_EQ(calls, 1);
+
+    for (size_t i = 0; i < images.size(); i++)
+    {
+      const std::vector<cv::Mat> actual = run(images[i]);
+      for (size_t k = 0; k < actual.size(); k++)
+      {
+        EXPECT_EQ(cv::norm(actual[k], expected[i][k], cv::NORM_INF), 0)
+          << edge_dection::cpuLevelName(level) << " image " << i << " output " << k;
+      }
+    }
+  }
+  edge_dection::setCpuLevel(initial);
+}
+
+// 本进程允许运行的第一个 CPU，取不到时返回 -1（不绑定）
+static int allowedCpu()
+{
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0)
+  {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+      if (CPU_ISSET(cpu, &set))
+      {
+        return cpu;
+      }
+    }
+  }
+#endif
+  return -1;
+}
+
+TEST(CannyTest, streamMatchesSerial)
+{
+  const int frames = 12;
+  std::vector<cv::Mat> results(frames);
+  const int cpu                   = allowedCpu();
+  std::vector<StreamStage> stages = cannyStreamStages(40, 80, {cpu});
+  stages.push_back({"collect", [&](StreamFrame &f) { f.mats[CannyEdges].copyTo(results[f.index]); }});
+
+  StreamOptions options;
+  options.dropOldest = false;
+  StreamExecutor executor(stages, options);
+  for (int i = 0; i < frames; i++)
+  {
+    cv::Mat img = syntheticFrame(i);
+    // 不丢帧：入口满时稍后重试
+    while (!executor.push(img))
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  executor.stop();
+
+  StreamStats stats = executor.stats();
+  EXPECT_EQ(stats.completed, static_cast<uint64_t>(frames));
+  ASSERT_EQ(stats.stages.size(), 5u);
+  EXPECT_EQ(stats.stages[0].pinned, cpu >= 0);
+  for (const StreamStageStats &stage : stats.stages)
+  {
+    EXPECT_EQ(stage.frames, static_cast<uint64_t>(frames));
+    EXPECT_EQ(stage.queueDepth, 0u);
+    EXPECT_LE(stage.maxQueueDepth, options.queueCapacity);
+  }
+
+  for (int i = 0; i < frames; i++)
+  {
+    cv::Mat img = syntheticFrame(i), gauss_img, gradXY, theta, local_img, dst;
+    gaussianFilter(img, gauss_img);
+    getGrandient(gauss_img, gradXY, theta);
+    nonLocalMaxValue(gradXY, theta, local_img);
+    doubleThreshold(40, 80, local_img, dst);
+    ASSERT_FALSE(results[i].empty());
+    EXPECT_EQ(cv::norm(results[i], dst, cv::NORM_INF), 0);
+  }
+}
+
+TEST(CannyTest, streamStagesReuseFrameBuffers)
+{
+  const std::vector<StreamStage> stages = cannyStreamStages(40, 80);
+  StreamFrame frame;
+  std::vector<const uchar *> buffers;
+  for (int i = 0; i < 3; i++)
+  {
+    syntheticFrame(i).copyTo(frame.image);
+    for (const StreamStage &stage : stages)
+    {
+      stage.run(frame);
+    }
+    std::vector<const uchar *> current;
+    for (const cv::Mat &m : frame.mats)
+    {
+      current.push_back(m.data);
+    }
+    // 第一帧分配，之后每帧写进同样的内存
+    if (i > 0)
+    {
+      EXPECT_EQ(current, buffers);
+    }
+    buffers = current;
+  }
+}
+
+TEST(CannyTest, streamDropsOldestFrames)
+{
+  std::vector<int64_t> done;
+  std::vector<StreamStage> stages = {
+    {"slow",
+     [&](StreamFrame &f) {
+       std::this_thread::sleep_for(std::chrono::milliseconds(2));
+       done.push_back(f.index);
+     }},
+  };
+  StreamExecutor executor(stages);
+  for (int i = 0; i < 100; i++)
+  {
+    EXPECT_TRUE(executor.push(syntheticFrame(0)));
+  }
+  executor.stop();
+  EXPECT_FALSE(executor.push(syntheticFrame(0)));
+
+  StreamStats stats = executor.stats();
+  EXPECT_EQ(stats.pushed, 100u);
+  EXPECT_GT(stats.dropped, 0u);
+  EXPECT_EQ(stats.completed + stats.dropped, stats.pushed);
+  EXPECT_EQ(stats.failed, 0u);
+  ASSERT_EQ(done.size(), stats.completed);
+  // 处理的帧按序号递增，最新的一帧一定被处理
+  EXPECT_TRUE(std::is_sorted(done.begin(), done.end()));
+  EXPECT_EQ(done.back(), 99);
+}
+
+TEST(CannyTest, streamSurvivesThrowingStage)
+{
+  std::vector<int64_t> done;
+  std::vector<StreamStage> stages = {
+    {"throw",
+     [](StreamFrame &f) {
+       if (f.index % 3 == 1)
+       {
+         throw std::runtime_error("bad frame");
+       }
+     }},
+    {"collect", [&](StreamFrame &f) { done.push_back(f.index); }},
+  };
+  StreamOptions options;
+  options.dropOldest = false;
+  StreamExecutor executor(stages, options);
+  // 帧数多于预分配的帧，出错的帧必须回到入口才能全部送入
+  const int frames = 60;
+  for (int i = 0; i < frames; i++)
+  {
+    while (!executor.push(syntheticFrame(0)))
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  executor.stop();
+
+  StreamStats stats = executor.stats();
+  EXPECT_EQ(stats.failed, static_cast<uint64_t>(frames / 3));
+  EXPECT_EQ(stats.completed, static_cast<uint64_t>(frames - frames / 3));
+  EXPECT_EQ(stats.completed + stats.failed + stats.dropped, stats.pushed);
+  EXPECT_EQ(stats.stages[0].errors, static_cast<uint64_t>(frames / 3));
+  EXPECT_EQ(stats.stages[1].errors, 0u);
+  EXPECT_EQ(stats.stages[1].frames, stats.completed);
+  ASSERT_EQ(done.size(), stats.completed);
+  for (int64_t index : done)
+  {
+    EXPECT_NE(index % 3, 1);
+  }
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
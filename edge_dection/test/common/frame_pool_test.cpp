@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "canny.h"
+#include "roberts.h"
+
+// 合成的测试图：明暗相间的块加噪声，每帧不同
+static cv::Mat syntheticFrame(int index)
+{
+  cv::Mat img(97, 131, CV_8UC1);
+  for (int r = 0; r < img.rows; r++)
+  {
+    for (int c = 0; c < img.cols; c++)
+    {
+      const bool bright   = ((r + index) / 16 + c / 20) % 2 == 0;
+      img.at<uchar>(r, c) = static_cast<uchar>((bright ? 190 : 40) + (r * 131 + c * 71 + index * 29) % 40);
+    }
+  }
+  return img;
+}
+
+TEST(FramePoolTest, hitStatistics)
+{
+  FramePool pool;
+  // 第一帧全部向系统申请
+  pool.acquire(100, 100, CV_8UC1);
+  pool.acquire(100, 100, CV_32FC1);
+  pool.acquire(3, 5, CV_8UC3);
+  EXPECT_EQ(pool.stats().requests, 3u);
+  EXPECT_EQ(pool.stats().hits, 0u);
+  EXPECT_GT(pool.stats().reservedBytes, 0u);
+  EXPECT_EQ(pool.stats().inUseBytes, pool.stats().reservedBytes);
+  const size_t reserved = pool.stats().reservedBytes;
+
+  pool.endFrame();
+  EXPECT_EQ(pool.stats().frames, 1u);
+  EXPECT_EQ(pool.stats().inUseBytes, 0u);
+  EXPECT_EQ(pool.stats().reservedBytes, reserved);
+
+  // 下一帧同样的请求都由缓存块满足；同一档内略小的请求也能命中
+  pool.acquire(100, 100, CV_8UC1);
+  pool.acquire(99, 100, CV_32FC1);
+  pool.acquire(3, 5, CV_8UC3);
+  EXPECT_EQ(pool.stats().requests, 6u);
+  EXPECT_EQ(pool.stats().hits, 3u);
+  EXPECT_EQ(pool.stats().reservedBytes, reserved);
+  EXPECT_EQ(pool.stats().peakInUseBytes, reserved);
+
+  // 缓存块用完后再请求同一档，只能向系统申请
+  pool.acquire(100, 100, CV_8UC1);
+  EXPECT_EQ(pool.stats().hits, 3u);
+  EXPECT_GT(pool.stats().reservedBytes, reserved);
+
+  pool.endFrame();
+  pool.trim();
+  EXPECT_EQ(pool.stats().reservedBytes, 0u);
+  pool.acquire(100, 100, CV_8UC1);
+  EXPECT_EQ(pool.stats().hits, 3u);
+}
+
+TEST(FramePoolTest, alignment)
+{
+  FramePool pool;
+  for (int frame = 0; frame < 2; frame++)
+  {
+    for (int cols : {1, 3, 63, 64, 65, 640, 1921})
+    {
+      for (int type : {CV_8UC1, CV_8UC3, CV_16UC1, CV_32FC1})
+      {
+        const cv::Mat m = pool.acquire(7, cols, type);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(m.data) % 64, 0u) << cols << " " << type;
+        EXPECT_TRUE(m.isContinuous());
+        EXPECT_EQ(m.rows, 7);
+        EXPECT_EQ(m.cols, cols);
+        EXPECT_EQ(m.type(), type);
+      }
+    }
+    const cv::Mat z = pool.zeros(cv::Size(33, 9), CV_8UC1);
+    EXPECT_EQ(cv::countNonZero(z), 0);
+    pool.endFrame();
+  }
+}
+
+TEST(FramePoolTest, sameOutputWithAndWithoutPool)
+{
+  FramePool pool;
+  uint64_t requests = 0, hits = 0;
+  for (int i = 0; i < 6; i++)
+  {
+    cv::Mat img = syntheticFrame(i);
+
+    cv::Mat gauss, grad, theta, local, edges;
+    gaussianFilter(img, gauss);
+    getGrandient(gauss, grad, theta);
+    nonLocalMaxValue(grad, theta, local);
+    doubleThreshold(40, 80, local, edges);
+    const cv::Mat expectedRoberts = roberts(img);
+
+    cv::Mat pgauss, pgrad, ptheta, plocal, pedges;
+    gaussianFilter(img, pgauss, &pool);
+    getGrandient(pgauss, pgrad, ptheta, &pool);
+    nonLocalMaxValue(pgrad, ptheta, plocal, &pool);
+    doubleThreshold(40, 80, plocal, pedges, &pool);
+    const cv::Mat pooledRoberts = roberts(img, &pool);
+
+    EXPECT_EQ(cv::norm(pgauss, gauss, cv::NORM_INF), 0) << i;
+    EXPECT_EQ(cv::norm(pgrad, grad, cv::NORM_INF), 0) << i;
+    EXPECT_EQ(cv::norm(ptheta, theta, cv::NORM_INF), 0) << i;
+    EXPECT_EQ(cv::norm(plocal, local, cv::NORM_INF), 0) << i;
+    EXPECT_EQ(cv::norm(pedges, edges, cv::NORM_INF), 0) << i;
+    EXPECT_EQ(cv::norm(pooledRoberts, expectedRoberts, cv::NORM_INF), 0) << i;
+
+    // 第一帧之后每帧的请求都由上一帧回收的块满足
+    if (i > 0)
+    {
+      EXPECT_EQ(pool.stats().requests - requests, pool.stats().hits - hits) << i;
+    }
+    requests = pool.stats().requests;
+    hits     = pool.stats().hits;
+    pool.endFrame();
+  }
+  EXPECT_GT(hits, 0u);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,125 @@
+#ifndef CPU_DISPATCH_HPP_
+#define CPU_DISPATCH_HPP_
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// a namespace of its own, so this and the edge_dection dispatch layer can link into one program
+namespace feature_descriptor
+{
+// instruction sets the hot kernels are built for, each level a superset of the one before
+enum class CpuLevel
+{
+  baseline, // what the whole build targets, sse2 on x86-64
+  sse42,    // sse4.2 + popcnt
+  avx2,
+  avx512 // avx512f + avx512bw
+};
+
+inline const char *cpu_level_name(CpuLevel level_)
+{
+  switch (level_)
+  {
+  case CpuLevel::sse42: return "sse4.2";
+  case CpuLevel::avx2: return "avx2";
+  case CpuLevel::avx512: return "avx512";
+  default: return "baseline";
+  }
+}
+
+// highest level this cpu (and os) supports
+inline CpuLevel cpu_supported_level()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+  {
+    return CpuLevel::avx512;
+  }
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return CpuLevel::avx2;
+  }
+  if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+  {
+    return CpuLevel::sse42;
+  }
+#endif
+  return CpuLevel::baseline;
+}
+
+// level every dispatched kernel uses, picked on first use: the supported level, lowered to the one
+// named by BS_IMAGE_ISA (baseline, sse4.2, avx2, avx512) if set, e.g. to test the other paths
+inline CpuLevel cpu_level()
+{
+  static const CpuLevel level = []() {
+    const CpuLevel supported = cpu_supported_level();
+    const char *env          = std::getenv("BS_IMAGE_ISA");
+    if (env == nullptr)
+    {
+      return supported;
+    }
+    for (CpuLevel l : {CpuLevel::baseline, CpuLevel::sse42, CpuLevel::avx2, CpuLevel::avx512})
+    {
+      if (std::strcmp(env, cpu_level_name(l)) == 0)
+      {
+        return l < supported ? l : supported;
+      }
+    }
+    std::cerr << "BS_IMAGE_ISA=" << env << " is not one of baseline, sse4.2, avx2, avx512; ignored" << std::endl;
+    return supported;
+  }();
+  return level;
+}
+
+namespace cpu_dispatch_detail
+{
+// flatten inlines the body, and what it calls, into each of these, where it is compiled again
+// with the instruction set of the attribute
+template <class Body>
+__attribute__((noinline)) void run_baseline(Body &body_)
+{
+  body_();
+}
+#if defined(__x86_64__) || defined(__i386__)
+template <class Body>
+__attribute__((target("sse4.2,popcnt"), flatten, noinline)) void run_sse42(Body &body_)
+{
+  body_();
+}
+template <class Body>
+__attribute__((target("avx2,popcnt"), flatten, noinline)) void run_avx2(Body &body_)
+{
+  body_();
+}
+template <class Body>
+__attribute__((target("avx512f,avx512bw,avx2,popcnt"), flatten, noinline)) void run_avx512(Body &body_)
+{
+  body_();
+}
+#endif
+} // namespace cpu_dispatch_detail
+
+/**
+ * runs body_ built for level_: body_ and every call inside it that can be inlined are compiled once
+ * per level, so plain loops in the body are vectorized for the widest registers of the cpu while the
+ * binary still targets the baseline. level_ must not exceed cpu_supported_level(). Dispatch costs a
+ * switch per call, so call it per row or stripe, not per pixel; cv::parallel_for_ bodies are not
+ * inlined, dispatch inside them.
+ */
+template <class Body>
+void cpu_dispatch(Body &&body_, CpuLevel level_ = cpu_level())
+{
+  switch (level_)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+  case CpuLevel::avx512: cpu_dispatch_detail::run_avx512(body_); break;
+  case CpuLevel::avx2: cpu_dispatch_detail::run_avx2(body_); break;
+  case CpuLevel::sse42: cpu_dispatch_detail::run_sse42(body_); break;
+#endif
+  default: cpu_dispatch_detail::run_baseline(body_); break;
+  }
+}
+} // namespace feature_descriptor
+
+#endif
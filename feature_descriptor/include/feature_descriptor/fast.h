@@ -0,0 +1,32 @@
+
+
+#ifndef FAST_HPP_
+#define FAST_HPP_
+
+
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+// FAST-9: a pixel is a corner if 9 contiguous pixels on the 16-pixel Bresenham circle of radius 3
+// are all brighter than centre + threshold or all darker than centre - threshold.
+class Fast
+{
+ public:
+  Fast(int threshold_ = 20, bool nonmax_suppression_ = true);
+  ~Fast();
+
+  // keypoints closer than border_ (at least 3) to the image edge are skipped; response is the corner score
+  void detect(const cv::Mat &img_, std::vector<cv::KeyPoint> &keypoints_, int border_ = 3);
+
+ private:
+  // largest threshold for which the pixel is still a corner, 0 if not a corner at _threshold
+  int corner_score(const uchar *p_, const int *offsets_);
+
+  void make_offsets(int step_, int *offsets_);
+
+ private:
+  int _threshold;
+  bool _nonmax_suppression;
+};
+
+#endif
@@ -0,0 +1,84 @@
+
+
+#ifndef FEATURE_STORE_HPP_
+#define FEATURE_STORE_HPP_
+
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <opencv2/opencv.hpp>
+
+// 64-bit hash of size_ bytes (xxHash64 construction: four multiply-rotate lanes over 32-byte stripes)
+uint64_t hash64(const void *data_, size_t size_, uint64_t seed_ = 0);
+
+// features of one image in a versioned binary file: header, cv::KeyPoint array and descriptor
+// matrix, each section 64-byte aligned. open() maps the file read-only and keypoints()/descriptors()
+// point straight into the mapping, so loading costs no parsing and no copy.
+class FeatureStore
+{
+ public:
+  static constexpr uint32_t kVersion = 1;
+
+  FeatureStore();
+  ~FeatureStore();
+
+  // writes to a temporary file and renames it, a reader never sees a partial store
+  static void write(const std::string &path_, uint64_t key_, const std::vector<cv::KeyPoint> &keypoints_, const cv::Mat &descriptors_);
+
+  // false if the file is missing, truncated or written by another format version
+  bool open(const std::string &path_);
+  void close();
+
+  uint64_t key() const { return _key; }
+  size_t size() const { return _n_keypoints; }
+  const cv::KeyPoint *keypoints() const { return _keypoints; }
+  std::vector<cv::KeyPoint> keypoint_vector() const { return std::vector<cv::KeyPoint>(_keypoints, _keypoints + _n_keypoints); }
+
+  // header over the read-only mapping, must not be written; empty if no descriptors were stored
+  const cv::Mat &descriptors() const { return _descriptors; }
+
+ private:
+  std::shared_ptr<const uint8_t> _map;
+  uint64_t _key                  = 0;
+  size_t _n_keypoints            = 0;
+  const cv::KeyPoint *_keypoints = nullptr;
+  cv::Mat _descriptors;
+};
+
+// directory of feature stores named by a key over image content and detector parameters. A batch
+// that sees the same image with the same detector again maps the stored features instead of
+// recomputing them.
+class FeatureCache
+{
+ public:
+  using Detector = std::function<void(const cv::Mat &, std::vector<cv::KeyPoint> &, cv::Mat &)>;
+
+  // creates dir_ if needed
+  explicit FeatureCache(const std::string &dir_);
+  ~FeatureCache();
+
+  // params_ must change whenever the detector output would, e.g. Harris::signature()
+  static uint64_t key(const cv::Mat &img_, const std::string &params_);
+
+  bool lookup(uint64_t key_, FeatureStore &store_) const;
+  void insert(uint64_t key_, const std::vector<cv::KeyPoint> &keypoints_, const cv::Mat &descriptors_) const;
+
+  // stored features of img_, running detector_ and storing its output only on a miss
+  FeatureStore get(const cv::Mat &img_, const std::string &params_, const Detector &detector_);
+
+  size_t hits() const { return _hits; }
+  size_t misses() const { return _misses; }
+
+ private:
+  std::string path(uint64_t key_) const;
+
+ private:
+  std::string _dir;
+  std::atomic<size_t> _hits{0};
+  std::atomic<size_t> _misses{0};
+};
+
+#endif
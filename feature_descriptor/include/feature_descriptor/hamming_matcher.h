@@ -0,0 +1,47 @@
+
+
+#ifndef HAMMING_MATCHER_HPP_
+#define HAMMING_MATCHER_HPP_
+
+
+#include <cstdint>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "feature_descriptor/cpu_dispatch.h"
+#include "feature_descriptor/orb.h"
+
+// hamming distance of two 32-byte descriptors
+int hamming_distance(const uint8_t *a_, const uint8_t *b_);
+
+// distances from one query row to n_ consecutive train rows, with the popcnt, AVX2 or AVX-512
+// kernel of cpu_level()
+void hamming_distances(const uint8_t *query_, const uint8_t *train_, int n_, int *dist_);
+
+// same with the kernel of level_, which the cpu must support; for comparing the kernels
+void hamming_distances(const uint8_t *query_, const uint8_t *train_, int n_, int *dist_, feature_descriptor::CpuLevel level_);
+
+// brute-force k-NN over binary descriptors. Query and train are walked in tiles small enough
+// to stay in L1 together, and query tiles are spread over threads.
+class HammingMatcher
+{
+ public:
+  // ratio_ >= 1 disables the ratio test
+  HammingMatcher(float ratio_ = 0.8f, bool cross_check_ = false);
+  ~HammingMatcher();
+
+  // k_ nearest train rows of every query row, nearest first
+  void knn_match(const BinaryDescriptors &query_, const BinaryDescriptors &train_, int k_, std::vector<std::vector<cv::DMatch>> &matches_);
+
+  // nearest train row of every query row that passes the ratio test and, if enabled, the cross check
+  void match(const BinaryDescriptors &query_, const BinaryDescriptors &train_, std::vector<cv::DMatch> &matches_);
+
+ private:
+  float _ratio;
+  bool _cross_check;
+
+  int _query_tile = 32;  // 1 KB of queries
+  int _train_tile = 512; // 16 KB of train rows
+};
+
+#endif
@@ -15,6 +15,16 @@ class Harris
 
   void detect(const cv::Mat &img_, std::vector<cv::Point> &corners_);
 
+  // set response of each keypoint to the Harris score of the block_size_ x block_size_ window around it
+  void score_points(const cv::Mat &img_, std::vector<cv::KeyPoint> &keypoints_, int block_size_ = 7);
+
+  // every parameter that changes the output of detect, e.g. as FeatureCache key
+  std::string signature() const;
+
+  // raw 3x3 sobel responses of a CV_8UC1 image (8x the derivative), zero outside the image;
+  // the gradients detect is built on
+  static void gradient(const cv::Mat &img_, cv::Mat &ix_, cv::Mat &iy_);
+
  private:
   void get_corners(const cv::Mat &res_, const float thresh_, std::vector<cv::Point> &corners_);
 
@@ -22,9 +32,7 @@ class Harris
 
   void get_gradient(const cv::Mat &in_);
 
-  cv::Mat filter_uchar(const cv::Mat &in_, const cv::Mat &kernel_);
-
-  cv::Mat filter_float(const cv::Mat &in_, const cv::Mat &kernel_);
+  void filter_float(const cv::Mat &in_, const cv::Mat &kernel_, cv::Mat &res);
 
   float gaussion(int x, int y, float theta);
 
@@ -33,6 +41,8 @@ class Harris
 
  private:
   cv::Mat Ixx, Iyy, Ixy;
+  // per-call intermediates kept between calls, so detect on same-sized frames does not allocate
+  cv::Mat _ix, _iy, _scratch, _response;
   int _kernel_size = 5;
   float _delta     = 1.4;
   // 增大 α 的值，将减小角点响应值 R ，减少被检测角点的数量；减小 α 的值，将增大角点响应值 R ，增加被检测角点的数量。
@@ -0,0 +1,67 @@
+
+
+#ifndef KD_FOREST_HPP_
+#define KD_FOREST_HPP_
+
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <opencv2/opencv.hpp>
+
+// randomized kd-forest (Silpa-Anan & Hartley 2008, as in FLANN) over float descriptors. Every tree
+// splits on a dimension drawn from the few with the highest variance; a query descends all trees,
+// then keeps expanding the closest unexplored branch of any tree until checks_ train rows are scored.
+//
+// Nodes are stored as parallel arrays and descriptors as zero-padded 64-byte aligned rows, all in
+// one block that is written to disk as is, so a saved index is mapped back without a rebuild.
+class KdForest
+{
+ public:
+  KdForest(int n_trees_ = 4, int leaf_size_ = 16);
+  ~KdForest();
+
+  // train_ is CV_32F N x dims, row i is reported as trainIdx i
+  void build(const cv::Mat &train_);
+
+  // k_ approximate nearest neighbours of every query row, nearest first, distance is L2
+  void knn_match(const cv::Mat &query_, int k_, std::vector<std::vector<cv::DMatch>> &matches_, int checks_ = 64) const;
+
+  void save(const std::string &path_) const;
+
+  // maps the file read-only; false if it is missing, not an index of this format version, or
+  // truncated or corrupt (sections overlapping, node links or ids out of range)
+  bool load(const std::string &path_);
+
+  size_t size() const { return _n_rows; }
+  int dims() const { return _dims; }
+
+ private:
+  void build_tree(const cv::Mat &train_, int tree_, std::vector<uint32_t> &ids_, std::vector<int32_t> &split_dim_,
+                  std::vector<float> &split_val_, std::vector<int32_t> &left_, std::vector<int32_t> &right_);
+
+  // points the views below into _blob, checking the header against blob_size_ and every link
+  bool attach(std::shared_ptr<const uint8_t> blob_, size_t blob_size_);
+
+ private:
+  int _n_trees;
+  int _leaf_size;
+
+  // owns the whole layout, either heap memory or a file mapping
+  std::shared_ptr<const uint8_t> _blob;
+  size_t _blob_size = 0;
+
+  size_t _n_rows = 0;
+  int _dims      = 0;
+  int _stride    = 0; // floats per padded row
+  // split_dim < 0 marks a leaf, whose rows are _ids[left .. right)
+  const int32_t *_roots     = nullptr;
+  const int32_t *_split_dim = nullptr;
+  const float *_split_val   = nullptr;
+  const int32_t *_left      = nullptr;
+  const int32_t *_right     = nullptr;
+  const uint32_t *_ids      = nullptr;
+  const float *_data        = nullptr;
+};
+
+#endif
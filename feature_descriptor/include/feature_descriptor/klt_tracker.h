@@ -0,0 +1,64 @@
+
+
+#ifndef KLT_TRACKER_HPP_
+#define KLT_TRACKER_HPP_
+
+
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "feature_descriptor/harris.h"
+
+// pyramidal Lucas-Kanade tracker (Bouguet) over Harris corners. Features are followed from frame
+// to frame and corners are searched only in grid cells that have no feature left. The sobel
+// gradients of every pyramid level come from Harris::gradient once per frame and serve both the
+// re-detection in this frame and the tracking into the next one.
+class KltTracker
+{
+ public:
+  KltTracker(int win_size_ = 15, int n_levels_ = 3, int cell_size_ = 32, float min_response_ = 300.f,
+             int max_iterations_ = 20, float epsilon_ = 0.03f);
+  ~KltTracker();
+
+  // CV_8UC1 frames of one size; class_id of a feature is its track id, stable while it is tracked
+  void process(const cv::Mat &img_, std::vector<cv::KeyPoint> &features_);
+
+  // the next frame starts from scratch
+  void reset();
+
+ private:
+  void build_pyramid(const cv::Mat &img_);
+
+  // follows pt_ from _prev into _curr, false if the feature is lost
+  bool track_feature(cv::Point2f &pt_) const;
+
+  // strongest harris corner of one grid cell, false if none passes _min_response
+  bool detect_cell(int cell_x_, int cell_y_, cv::KeyPoint &kp_) const;
+
+  // drops the younger of two features closer than half a cell, then fills the empty cells
+  void refill(std::vector<cv::KeyPoint> &features_);
+
+ private:
+  int _win_size;
+  int _n_levels;
+  int _cell_size;
+  float _min_response;
+  int _max_iterations;
+  float _epsilon;
+  // minimum eigenvalue of the window structure tensor per pixel, below it the feature is lost
+  float _min_eigen = 1e-1f;
+  // mean absolute intensity difference of the final window, above it the feature is lost
+  float _max_residual = 25.f;
+
+  struct Level
+  {
+    cv::Mat img;    // CV_32F
+    cv::Mat dx, dy; // raw sobel from Harris::gradient
+  };
+  std::vector<Level> _prev;
+  std::vector<Level> _curr;
+  std::vector<cv::KeyPoint> _features;
+  int _next_id = 0;
+};
+
+#endif
@@ -0,0 +1,49 @@
+
+
+#ifndef LSH_INDEX_HPP_
+#define LSH_INDEX_HPP_
+
+
+#include <cstdint>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "feature_descriptor/orb.h"
+
+// multi-probe LSH over binary descriptors. Every table hashes a descriptor to key_bits_ of its
+// bits; a query visits its own bucket plus all buckets within probe_level_ bit flips, then ranks
+// the union of candidates by exact hamming distance.
+class LshIndex
+{
+ public:
+  LshIndex(int n_tables_ = 8, int key_bits_ = 20, int probe_level_ = 1);
+  ~LshIndex();
+
+  // keeps a copy of train_, row i of train_ is reported as trainIdx i
+  void build(const BinaryDescriptors &train_);
+
+  // k_ approximate nearest neighbours of every query row, nearest first
+  void knn_match(const BinaryDescriptors &query_, int k_, std::vector<std::vector<cv::DMatch>> &matches_) const;
+
+  size_t size() const { return _train.rows(); }
+
+ private:
+  uint32_t hash(const uint8_t *desc_, int table_) const;
+
+  // own bucket first, then every key within _probe_level flips
+  void probe_keys(uint32_t key_, std::vector<uint32_t> &keys_) const;
+
+ private:
+  int _n_tables;
+  int _key_bits;
+  int _probe_level;
+
+  BinaryDescriptors _train;
+  // _n_tables x _key_bits bit positions sampled from the 256 descriptor bits
+  std::vector<int> _bits;
+  // per table: bucket b holds _ids[t][_offsets[t][b] .. _offsets[t][b + 1])
+  std::vector<std::vector<uint32_t>> _offsets;
+  std::vector<std::vector<uint32_t>> _ids;
+};
+
+#endif
@@ -0,0 +1,97 @@
+
+
+#ifndef ORB_HPP_
+#define ORB_HPP_
+
+
+#include <cstdint>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "feature_descriptor/fast.h"
+#include "feature_descriptor/harris.h"
+
+// 256-bit binary descriptors stored as contiguous 32-byte rows in one cache-aligned block
+class BinaryDescriptors
+{
+ public:
+  static constexpr int kBytes     = 32;
+  static constexpr int kAlignment = 64;
+
+  BinaryDescriptors();
+  explicit BinaryDescriptors(size_t rows_);
+  BinaryDescriptors(const BinaryDescriptors &other_);
+  BinaryDescriptors(BinaryDescriptors &&other_) noexcept;
+  BinaryDescriptors &operator=(BinaryDescriptors other_) noexcept;
+  ~BinaryDescriptors();
+
+  // keeps the first min(rows, rows_) rows; only reallocates when growing past capacity
+  void resize(size_t rows_);
+  void clear() { _rows = 0; }
+
+  size_t rows() const { return _rows; }
+  bool empty() const { return _rows == 0; }
+
+  uint8_t *data() { return _data; }
+  const uint8_t *data() const { return _data; }
+  uint8_t *row(size_t i_) { return _data + i_ * kBytes; }
+  const uint8_t *row(size_t i_) const { return _data + i_ * kBytes; }
+
+  // CV_8UC1 rows() x 32 header over the same memory, no copy
+  cv::Mat mat() const;
+
+ private:
+  uint8_t *_data   = nullptr;
+  size_t _rows     = 0;
+  size_t _capacity = 0;
+};
+
+// oriented FAST + rotated BRIEF
+class ORB
+{
+ public:
+  ORB(int n_features_ = 500, float scale_factor_ = 1.2f, int n_levels_ = 8, int fast_threshold_ = 20);
+  ~ORB();
+
+  // keypoints are in level-0 coordinates, octave is the pyramid level, angle in degrees
+  void detect_and_compute(const cv::Mat &img_, std::vector<cv::KeyPoint> &keypoints_, BinaryDescriptors &descriptors_);
+
+ private:
+  void build_pyramid(const cv::Mat &img_);
+
+  // FAST corners ranked by Harris score, at most n_ per level
+  void detect_level(int level_, int n_, std::vector<cv::KeyPoint> &keypoints_);
+
+  // intensity centroid orientation from integer moments over the circular patch
+  float ic_angle(const cv::Mat &img_, const cv::Point &pt_);
+
+  void compute_descriptor(const cv::Mat &blurred_, const cv::KeyPoint &kp_, uint8_t *desc_);
+
+  // sampling pairs of the unrotated pattern, fixed seed so descriptors are reproducible
+  void gen_pattern(std::vector<cv::Point> &pattern_);
+
+  void gen_rotated_patterns();
+
+ private:
+  int _n_features;
+  float _scale_factor;
+  int _n_levels;
+
+  int _patch_size  = 31;
+  int _half_patch  = 15;
+  int _edge        = 16; // orientation patch radius + 1, the rotated pattern stays within radius 14
+  int _angle_bins  = 30; // 12 degree steps
+  int _pattern_max = 13; // pattern points lie in this radius so any rotation stays in the patch
+
+  Fast _fast;
+  Harris _harris;
+
+  std::vector<cv::Mat> _pyramid;
+  std::vector<float> _scales;
+  // half width of each row of the circular patch
+  std::vector<int> _umax;
+  // _angle_bins x 256 pairs of (x1, y1, x2, y2)
+  std::vector<int8_t> _rotated_pattern;
+};
+
+#endif
@@ -0,0 +1,61 @@
+
+
+#ifndef SIFT_HPP_
+#define SIFT_HPP_
+
+
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+// scale-invariant feature transform (Lowe 2004) on a gaussian/DoG pyramid.
+// Octave bases are chained by one blur each, then every octave blurs its levels incrementally
+// from the previous level; octaves, extremum search bands and descriptors run in parallel.
+class SIFT
+{
+ public:
+  // descriptor_type_ is CV_32F (unit length rows) or CV_8U (rows scaled by 512 and saturated)
+  SIFT(int n_features_ = 0, int n_octave_layers_ = 3, double contrast_threshold_ = 0.04, double edge_threshold_ = 10,
+       double sigma_ = 1.6, int descriptor_type_ = CV_32F);
+  ~SIFT();
+
+  // keypoints in image coordinates, octave packs octave | layer << 8 | sub-layer offset << 16;
+  // descriptors_ is a contiguous keypoints_.size() x 128 matrix
+  void detect_and_compute(const cv::Mat &img_, std::vector<cv::KeyPoint> &keypoints_, cv::Mat &descriptors_);
+
+ private:
+  void build_octave_bases(const cv::Mat &img_, int n_octaves_);
+
+  void build_octaves();
+
+  void find_extrema(std::vector<cv::KeyPoint> &keypoints_);
+
+  // search one band of rows of one DoG layer
+  void find_extrema_band(int octave_, int layer_, int row_begin_, int row_end_, std::vector<cv::KeyPoint> &keypoints_);
+
+  // quadratic fit of the DoG around (r_, c_, layer_), rejects low contrast and edge responses
+  bool adjust_local_extrema(int octave_, int &layer_, int &r_, int &c_, cv::KeyPoint &kp_);
+
+  float calc_orientation_hist(const cv::Mat &img_, cv::Point pt_, int radius_, float sigma_, float *hist_, int n_);
+
+  void calc_descriptor(const cv::KeyPoint &kp_, float *desc_);
+
+  const cv::Mat &gauss(int octave_, int level_) const { return _gauss[octave_ * (_n_octave_layers + 3) + level_]; }
+  const cv::Mat &dog(int octave_, int level_) const { return _dog[octave_ * (_n_octave_layers + 2) + level_]; }
+
+ private:
+  int _n_features;
+  int _n_octave_layers;
+  double _contrast_threshold;
+  double _edge_threshold;
+  double _sigma;
+  int _descriptor_type;
+
+  int _n_octaves = 0;
+  std::vector<cv::Mat> _bases;
+  std::vector<cv::Mat> _gauss;
+  std::vector<cv::Mat> _dog;
+  // extra blur from level i - 1 to level i inside an octave
+  std::vector<double> _level_sigmas;
+};
+
+#endif
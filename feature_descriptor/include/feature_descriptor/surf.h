@@ -0,0 +1,52 @@
+
+
+#ifndef SURF_HPP_
+#define SURF_HPP_
+
+
+#include <cstdint>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+// speeded-up robust features (Bay et al. 2008). One integral image per frame serves every box
+// filter: all octaves grow the filter instead of shrinking the image, so each scale costs the
+// same and no pyramid is stored.
+class SURF
+{
+ public:
+  SURF(double hessian_threshold_ = 100, int n_octaves_ = 4, int n_octave_layers_ = 3, bool extended_ = false, bool upright_ = false);
+  ~SURF();
+
+  // class_id holds the sign of the laplacian; descriptors_ is a contiguous CV_32F N x 64 (128 if extended) matrix
+  void detect_and_compute(const cv::Mat &img_, std::vector<cv::KeyPoint> &keypoints_, cv::Mat &descriptors_);
+
+ private:
+  // (rows + 1) x (cols + 1) sums kept modulo 2^32; any box sum below 2^31 is still exact,
+  // which lets very large images use 32-bit sums
+  void build_integral(const cv::Mat &img_);
+
+  // determinant and trace of the box-filter hessian of every layer of every octave
+  void calc_responses();
+
+  void find_maxima(std::vector<cv::KeyPoint> &keypoints_);
+
+  void calc_orientation(cv::KeyPoint &kp_);
+
+  void calc_descriptor(const cv::KeyPoint &kp_, float *desc_);
+
+  int layer_size(int octave_, int layer_) const { return (9 + 6 * layer_) << octave_; }
+
+ private:
+  double _hessian_threshold;
+  int _n_octaves;
+  int _n_octave_layers;
+  bool _extended;
+  bool _upright;
+
+  cv::Mat _sum;
+  // _n_octaves x (_n_octave_layers + 2), sampled every 1 << octave pixels
+  std::vector<cv::Mat> _dets;
+  std::vector<cv::Mat> _traces;
+};
+
+#endif
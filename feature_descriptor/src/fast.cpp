@@ -0,0 +1,137 @@
+#include "feature_descriptor/fast.h"
+
+namespace
+{
+constexpr int kCircleSize = 16;
+constexpr int kArcLength  = 9;
+} // namespace
+
+Fast::Fast(int threshold_, bool nonmax_suppression_) :
+  _threshold(threshold_), _nonmax_suppression(nonmax_suppression_)
+{}
+Fast::~Fast()
+{}
+
+void Fast::detect(const cv::Mat &img_, std::vector<cv::KeyPoint> &keypoints_, int border_)
+{
+  CV_Assert(img_.type() == CV_8UC1);
+  keypoints_.clear();
+
+  border_ = std::max(border_, 3);
+  if (img_.rows <= 2 * border_ || img_.cols <= 2 * border_)
+  {
+    return;
+  }
+
+  int offsets[kCircleSize];
+  make_offsets(static_cast<int>(img_.step), offsets);
+
+  // score of every candidate, 0 elsewhere; only needed for non-maximum suppression
+  cv::Mat scores;
+  if (_nonmax_suppression)
+  {
+    scores = cv::Mat::zeros(img_.size(), CV_32SC1);
+  }
+
+  std::vector<cv::Point> candidates;
+  for (int r = border_; r < img_.rows - border_; ++r)
+  {
+    const uchar *row = img_.ptr<uchar>(r);
+    for (int c = border_; c < img_.cols - border_; ++c)
+    {
+      const uchar *p = row + c;
+      const int lo   = p[0] - _threshold;
+      const int hi   = p[0] + _threshold;
+
+      // an arc of 9 always covers at least two of the four compass pixels
+      const int v0 = p[offsets[0]], v4 = p[offsets[4]], v8 = p[offsets[8]], v12 = p[offsets[12]];
+      const int brighter = (v0 > hi) + (v4 > hi) + (v8 > hi) + (v12 > hi);
+      const int darker   = (v0 < lo) + (v4 < lo) + (v8 < lo) + (v12 < lo);
+      if (brighter < 2 && darker < 2)
+      {
+        continue;
+      }
+
+      const int score = corner_score(p, offsets);
+      if (score <= _threshold)
+      {
+        continue;
+      }
+      candidates.emplace_back(c, r);
+      if (_nonmax_suppression)
+      {
+        scores.at<int>(r, c) = score;
+      }
+    }
+  }
+
+  keypoints_.reserve(candidates.size());
+  for (const auto &pt : candidates)
+  {
+    int score = 0;
+    if (_nonmax_suppression)
+    {
+      score      = scores.at<int>(pt.y, pt.x);
+      bool local = true;
+      for (int dr = -1; dr <= 1 && local; ++dr)
+      {
+        const int *row = scores.ptr<int>(pt.y + dr);
+        for (int dc = -1; dc <= 1; ++dc)
+        {
+          // ties are broken towards the top-left neighbour so plateaus keep one point
+          if ((dr || dc) && (row[pt.x + dc] > score || (row[pt.x + dc] == score && (dr < 0 || (dr == 0 && dc < 0)))))
+          {
+            local = false;
+            break;
+          }
+        }
+      }
+      if (!local)
+      {
+        continue;
+      }
+    }
+    else
+    {
+      score = corner_score(img_.ptr<uchar>(pt.y) + pt.x, offsets);
+    }
+    keypoints_.emplace_back(cv::Point2f(pt), 7.f, -1.f, static_cast<float>(score));
+  }
+}
+
+int Fast::corner_score(const uchar *p_, const int *offsets_)
+{
+  int d[kCircleSize + kArcLength];
+  for (int k = 0; k < kCircleSize; ++k)
+  {
+    d[k] = p_[0] - p_[offsets_[k]];
+  }
+  for (int k = 0; k < kArcLength; ++k)
+  {
+    d[kCircleSize + k] = d[k];
+  }
+
+  // for each arc the weakest pixel bounds the threshold; the best arc gives the score
+  int best_dark = 0, best_bright = 0;
+  for (int k = 0; k < kCircleSize; ++k)
+  {
+    int min_dark = 255, min_bright = 255;
+    for (int j = k; j < k + kArcLength; ++j)
+    {
+      min_dark   = std::min(min_dark, d[j]);
+      min_bright = std::min(min_bright, -d[j]);
+    }
+    best_dark   = std::max(best_dark, min_dark);
+    best_bright = std::max(best_bright, min_bright);
+  }
+  return std::max(best_dark, best_bright);
+}
+
+void Fast::make_offsets(int step_, int *offsets_)
+{
+  static const int circle[kCircleSize][2] = {{0, -3}, {1, -3}, {2, -2}, {3, -1}, {3, 0}, {3, 1}, {2, 2}, {1, 3}, {0, 3}, {-1, 3}, {-2, 2}, {-3, 1}, {-3, 0}, {-3, -1}, {-2, -2}, {-1, -3}};
+  for (int k = 0; k < kCircleSize; ++k)
+  {
+    offsets_[k] = circle[k][0] + circle[k][1] * step_;
+  }
+}
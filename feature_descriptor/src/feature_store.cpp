@@ -0,0 +1,294 @@
+#include "feature_descriptor/feature_store.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+namespace
+{
+constexpr int kAlignment = 64;
+constexpr char kMagic[8] = {'B', 'S', 'F', 'E', 'A', 'T', 0, 0};
+
+// native byte order. keypoint_bytes guards against a cv::KeyPoint layout other than the writer's
+struct Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t keypoint_bytes;
+  uint64_t key;
+  uint64_t n_keypoints;
+  int32_t desc_rows;
+  int32_t desc_cols;
+  int32_t desc_type;
+  int32_t reserved;
+  uint64_t desc_step;
+  uint64_t keypoints;
+  uint64_t descriptors;
+  uint64_t total;
+};
+
+size_t align_up(size_t bytes_)
+{
+  return (bytes_ + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+constexpr uint64_t kPrime1 = 11400714785074694791ULL;
+constexpr uint64_t kPrime2 = 14029467366897019727ULL;
+constexpr uint64_t kPrime3 = 1609587929392839161ULL;
+constexpr uint64_t kPrime4 = 9650029242287828579ULL;
+constexpr uint64_t kPrime5 = 2870177450012600261ULL;
+
+inline uint64_t rotl(uint64_t x_, int r_)
+{
+  return (x_ << r_) | (x_ >> (64 - r_));
+}
+
+inline uint64_t read64(const uint8_t *p_)
+{
+  uint64_t v;
+  std::memcpy(&v, p_, 8);
+  return v;
+}
+
+inline uint64_t round64(uint64_t acc_, uint64_t input_)
+{
+  return rotl(acc_ + input_ * kPrime2, 31) * kPrime1;
+}
+
+inline uint64_t merge64(uint64_t acc_, uint64_t lane_)
+{
+  return (acc_ ^ round64(0, lane_)) * kPrime1 + kPrime4;
+}
+} // namespace
+
+uint64_t hash64(const void *data_, size_t size_, uint64_t seed_)
+{
+  const uint8_t *p   = static_cast<const uint8_t *>(data_);
+  const uint8_t *end = p + size_;
+  uint64_t h;
+  if (size_ >= 32)
+  {
+    uint64_t v1 = seed_ + kPrime1 + kPrime2;
+    uint64_t v2 = seed_ + kPrime2;
+    uint64_t v3 = seed_;
+    uint64_t v4 = seed_ - kPrime1;
+    for (; p + 32 <= end; p += 32)
+    {
+      v1 = round64(v1, read64(p));
+      v2 = round64(v2, read64(p + 8));
+      v3 = round64(v3, read64(p + 16));
+      v4 = round64(v4, read64(p + 24));
+    }
+    h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    h = merge64(merge64(merge64(merge64(h, v1), v2), v3), v4);
+  }
+  else
+  {
+    h = seed_ + kPrime5;
+  }
+  h += size_;
+
+  for (; p + 8 <= end; p += 8)
+  {
+    h = rotl(h ^ round64(0, read64(p)), 27) * kPrime1 + kPrime4;
+  }
+  if (p + 4 <= end)
+  {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    h = rotl(h ^ (v * kPrime1), 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; ++p)
+  {
+    h = rotl(h ^ (*p * kPrime5), 11) * kPrime1;
+  }
+
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+FeatureStore::FeatureStore()
+{}
+FeatureStore::~FeatureStore()
+{}
+
+void FeatureStore::write(const std::string &path_, uint64_t key_, const std::vector<cv::KeyPoint> &keypoints_, const cv::Mat &descriptors_)
+{
+  CV_Assert(descriptors_.empty() || (descriptors_.dims == 2 && static_cast<size_t>(descriptors_.rows) == keypoints_.size()));
+
+  Header h{};
+  std::memcpy(h.magic, kMagic, sizeof(kMagic));
+  h.version        = kVersion;
+  h.keypoint_bytes = sizeof(cv::KeyPoint);
+  h.key            = key_;
+  h.n_keypoints    = keypoints_.size();
+  h.desc_rows      = descriptors_.empty() ? 0 : descriptors_.rows;
+  h.desc_cols      = descriptors_.empty() ? 0 : descriptors_.cols;
+  h.desc_type      = descriptors_.empty() ? 0 : descriptors_.type();
+  h.desc_step      = descriptors_.empty() ? 0 : descriptors_.cols * descriptors_.elemSize();
+  h.keypoints      = align_up(sizeof(Header));
+  h.descriptors    = align_up(h.keypoints + keypoints_.size() * sizeof(cv::KeyPoint));
+  h.total          = h.descriptors + h.desc_rows * h.desc_step;
+
+  const std::string tmp = path_ + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    const char zeros[kAlignment] = {};
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    out.write(zeros, h.keypoints - sizeof(h));
+    out.write(reinterpret_cast<const char *>(keypoints_.data()), keypoints_.size() * sizeof(cv::KeyPoint));
+    out.write(zeros, h.descriptors - h.keypoints - keypoints_.size() * sizeof(cv::KeyPoint));
+    for (int r = 0; r < h.desc_rows; ++r)
+    {
+      out.write(reinterpret_cast<const char *>(descriptors_.ptr(r)), h.desc_step);
+    }
+    if (!out.good())
+    {
+      std::remove(tmp.c_str());
+      CV_Error(cv::Error::StsError, "FeatureStore: failed to write " + tmp);
+    }
+  }
+  if (std::rename(tmp.c_str(), path_.c_str()) != 0)
+  {
+    std::remove(tmp.c_str());
+    CV_Error(cv::Error::StsError, "FeatureStore: failed to rename " + tmp + " to " + path_);
+  }
+}
+
+bool FeatureStore::open(const std::string &path_)
+{
+  close();
+  int fd = ::open(path_.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header)))
+  {
+    ::close(fd);
+    return false;
+  }
+  const size_t size = static_cast<size_t>(st.st_size);
+  void *addr        = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED)
+  {
+    return false;
+  }
+  std::shared_ptr<const uint8_t> map(static_cast<const uint8_t *>(addr), [size](const uint8_t *p_) {
+    ::munmap(const_cast<uint8_t *>(p_), size);
+  });
+
+  Header h;
+  std::memcpy(&h, map.get(), sizeof(h));
+  bool ok = std::memcmp(h.magic, kMagic, sizeof(kMagic)) == 0 && h.version == kVersion
+            && h.keypoint_bytes == sizeof(cv::KeyPoint) && h.total <= size
+            && h.keypoints % kAlignment == 0 && h.descriptors % kAlignment == 0
+            && h.keypoints >= sizeof(Header) && h.keypoints <= h.descriptors && h.descriptors <= h.total
+            && h.desc_rows >= 0 && h.desc_cols >= 0 && h.desc_type >= 0 && h.desc_type <= CV_MAT_TYPE_MASK
+            && CV_MAT_DEPTH(h.desc_type) <= CV_64F
+            && (h.desc_rows == 0 || static_cast<uint64_t>(h.desc_rows) == h.n_keypoints);
+  // sections by division, so a huge count cannot wrap the end offset around
+  ok = ok && h.n_keypoints <= (h.descriptors - h.keypoints) / sizeof(cv::KeyPoint)
+       && h.desc_step >= static_cast<uint64_t>(h.desc_cols) * CV_ELEM_SIZE(h.desc_type)
+       && (h.desc_rows == 0 || h.desc_step <= (h.total - h.descriptors) / static_cast<uint64_t>(h.desc_rows));
+  if (!ok)
+  {
+    return false;
+  }
+
+  _map         = std::move(map);
+  _key         = h.key;
+  _n_keypoints = h.n_keypoints;
+  _keypoints   = reinterpret_cast<const cv::KeyPoint *>(_map.get() + h.keypoints);
+  if (h.desc_rows > 0)
+  {
+    _descriptors = cv::Mat(h.desc_rows, h.desc_cols, h.desc_type, const_cast<uint8_t *>(_map.get() + h.descriptors), h.desc_step);
+  }
+  return true;
+}
+
+void FeatureStore::close()
+{
+  _descriptors.release();
+  _keypoints   = nullptr;
+  _n_keypoints = 0;
+  _key         = 0;
+  _map.reset();
+}
+
+FeatureCache::FeatureCache(const std::string &dir_) :
+  _dir(dir_)
+{
+  if (::mkdir(_dir.c_str(), 0755) != 0 && errno != EEXIST)
+  {
+    CV_Error(cv::Error::StsError, "FeatureCache: cannot create " + _dir);
+  }
+}
+FeatureCache::~FeatureCache()
+{}
+
+uint64_t FeatureCache::key(const cv::Mat &img_, const std::string &params_)
+{
+  CV_Assert(img_.dims == 2);
+  const int32_t shape[3] = {img_.rows, img_.cols, img_.type()};
+  uint64_t h             = hash64(params_.data(), params_.size());
+  h                      = hash64(shape, sizeof(shape), h);
+  // row by row, so a submatrix and its clone get the same key
+  const size_t row_bytes = img_.cols * img_.elemSize();
+  for (int r = 0; r < img_.rows; ++r)
+  {
+    h = hash64(img_.ptr(r), row_bytes, h);
+  }
+  return h;
+}
+
+bool FeatureCache::lookup(uint64_t key_, FeatureStore &store_) const
+{
+  // the key is checked again in case two keys ever collide on a file name
+  return store_.open(path(key_)) && store_.key() == key_;
+}
+
+void FeatureCache::insert(uint64_t key_, const std::vector<cv::KeyPoint> &keypoints_, const cv::Mat &descriptors_) const
+{
+  FeatureStore::write(path(key_), key_, keypoints_, descriptors_);
+}
+
+FeatureStore FeatureCache::get(const cv::Mat &img_, const std::string &params_, const Detector &detector_)
+{
+  const uint64_t k = key(img_, params_);
+  FeatureStore store;
+  if (lookup(k, store))
+  {
+    ++_hits;
+    return store;
+  }
+  ++_misses;
+
+  std::vector<cv::KeyPoint> keypoints;
+  cv::Mat descriptors;
+  detector_(img_, keypoints, descriptors);
+  insert(k, keypoints, descriptors);
+  CV_Assert(lookup(k, store));
+  return store;
+}
+
+std::string FeatureCache::path(uint64_t key_) const
+{
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.feat", static_cast<unsigned long long>(key_));
+  return _dir + "/" + name;
+}
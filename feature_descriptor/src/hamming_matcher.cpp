@@ -0,0 +1,258 @@
+#include "feature_descriptor/hamming_matcher.h"
+
+#include <climits>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAMMING_HAVE_X86 1
+#endif
+
+namespace
+{
+constexpr int kBytes = BinaryDescriptors::kBytes;
+
+inline int popcount_row(const uint8_t *a_, const uint8_t *b_)
+{
+  uint64_t a[4], b[4];
+  std::memcpy(a, a_, kBytes);
+  std::memcpy(b, b_, kBytes);
+  return __builtin_popcountll(a[0] ^ b[0]) + __builtin_popcountll(a[1] ^ b[1])
+         + __builtin_popcountll(a[2] ^ b[2]) + __builtin_popcountll(a[3] ^ b[3]);
+}
+
+void distances_scalar(const uint8_t *query_, const uint8_t *train_, int n_, int *dist_)
+{
+  for (int i = 0; i < n_; ++i)
+  {
+    dist_[i] = popcount_row(query_, train_ + static_cast<size_t>(i) * kBytes);
+  }
+}
+
+#ifdef HAMMING_HAVE_X86
+// same loop, but __builtin_popcountll becomes a single popcnt instruction
+__attribute__((target("popcnt"))) void distances_popcnt(const uint8_t *query_, const uint8_t *train_, int n_, int *dist_)
+{
+  for (int i = 0; i < n_; ++i)
+  {
+    dist_[i] = popcount_row(query_, train_ + static_cast<size_t>(i) * kBytes);
+  }
+}
+
+// per-byte popcount through a nibble lookup (vpshufb), summed per 64-bit lane by vpsadbw
+__attribute__((target("avx2"))) inline __m256i popcount_sad(__m256i x_)
+{
+  const __m256i lut  = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  __m256i lo         = _mm256_shuffle_epi8(lut, _mm256_and_si256(x_, mask));
+  __m256i hi         = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x_, 4), mask));
+  return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2"))) void distances_avx2(const uint8_t *query_, const uint8_t *train_, int n_, int *dist_)
+{
+  const __m256i q = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(query_));
+  int i           = 0;
+  // four rows per step: pack the four partial sums of each row into 32-bit lanes and reduce them together
+  for (; i + 4 <= n_; i += 4)
+  {
+    const uint8_t *t = train_ + static_cast<size_t>(i) * kBytes;
+    __m256i s0       = popcount_sad(_mm256_xor_si256(q, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t))));
+    __m256i s1       = popcount_sad(_mm256_xor_si256(q, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t + kBytes))));
+    __m256i s2       = popcount_sad(_mm256_xor_si256(q, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t + 2 * kBytes))));
+    __m256i s3       = popcount_sad(_mm256_xor_si256(q, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t + 3 * kBytes))));
+    __m256i s01      = _mm256_or_si256(s0, _mm256_slli_epi64(s1, 32));
+    __m256i s23      = _mm256_or_si256(s2, _mm256_slli_epi64(s3, 32));
+    __m256i w        = _mm256_add_epi32(_mm256_unpacklo_epi64(s01, s23), _mm256_unpackhi_epi64(s01, s23));
+    __m128i r        = _mm_add_epi32(_mm256_castsi256_si128(w), _mm256_extracti128_si256(w, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dist_ + i), r);
+  }
+  for (; i < n_; ++i)
+  {
+    dist_[i] = popcount_row(query_, train_ + static_cast<size_t>(i) * kBytes);
+  }
+}
+
+// popcount_sad on two descriptors at once
+__attribute__((target("avx512f,avx512bw"))) inline __m512i popcount_sad512(__m512i x_)
+{
+  const __m512i lut  = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+  const __m512i mask = _mm512_set1_epi8(0x0f);
+  __m512i lo         = _mm512_shuffle_epi8(lut, _mm512_and_si512(x_, mask));
+  __m512i hi         = _mm512_shuffle_epi8(lut, _mm512_and_si512(_mm512_srli_epi16(x_, 4), mask));
+  return _mm512_sad_epu8(_mm512_add_epi8(lo, hi), _mm512_setzero_si512());
+}
+
+__attribute__((target("avx512f,avx512bw"))) void distances_avx512(const uint8_t *query_, const uint8_t *train_, int n_, int *dist_)
+{
+  // the query in both halves, every load covers two consecutive train rows
+  const __m512i q = _mm512_broadcast_i64x4(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(query_)));
+  int i           = 0;
+  for (; i + 4 <= n_; i += 4)
+  {
+    const uint8_t *t = train_ + static_cast<size_t>(i) * kBytes;
+    __m512i s01      = popcount_sad512(_mm512_xor_si512(q, _mm512_loadu_si512(t)));
+    __m512i s23      = popcount_sad512(_mm512_xor_si512(q, _mm512_loadu_si512(t + 2 * kBytes)));
+    // 64-bit lanes: rows 0 | 2 << 32 in the lower half, rows 1 | 3 << 32 in the upper half
+    __m512i p = _mm512_or_si512(s01, _mm512_slli_epi64(s23, 32));
+    __m256i a = _mm512_castsi512_si256(p);
+    __m256i b = _mm512_extracti64x4_epi64(p, 1);
+    __m256i w = _mm256_add_epi64(_mm256_unpacklo_epi64(a, b), _mm256_unpackhi_epi64(a, b));
+    __m128i r = _mm_add_epi64(_mm256_castsi256_si128(w), _mm256_extracti128_si256(w, 1));
+    // 32-bit lanes are rows 0, 2, 1, 3
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dist_ + i), _mm_shuffle_epi32(r, _MM_SHUFFLE(3, 1, 2, 0)));
+  }
+  for (; i < n_; ++i)
+  {
+    dist_[i] = popcount_row(query_, train_ + static_cast<size_t>(i) * kBytes);
+  }
+}
+#endif
+
+using feature_descriptor::CpuLevel;
+using DistanceFn = void (*)(const uint8_t *, const uint8_t *, int, int *);
+
+DistanceFn select_distances(CpuLevel level_)
+{
+#ifdef HAMMING_HAVE_X86
+  switch (level_)
+  {
+  case CpuLevel::avx512: return distances_avx512;
+  case CpuLevel::avx2: return distances_avx2;
+  case CpuLevel::sse42: return distances_popcnt;
+  default: break;
+  }
+#endif
+  return distances_scalar;
+}
+
+// sorted insertion into the k best of one query
+inline void push_best(int *dist_, int *idx_, int k_, int d_, int i_)
+{
+  if (d_ >= dist_[k_ - 1])
+  {
+    return;
+  }
+  int j = k_ - 1;
+  while (j > 0 && dist_[j - 1] > d_)
+  {
+    dist_[j] = dist_[j - 1];
+    idx_[j]  = idx_[j - 1];
+    --j;
+  }
+  dist_[j] = d_;
+  idx_[j]  = i_;
+}
+} // namespace
+
+int hamming_distance(const uint8_t *a_, const uint8_t *b_)
+{
+  return popcount_row(a_, b_);
+}
+
+void hamming_distances(const uint8_t *query_, const uint8_t *train_, int n_, int *dist_)
+{
+  static const DistanceFn fn = select_distances(feature_descriptor::cpu_level());
+  fn(query_, train_, n_, dist_);
+}
+
+void hamming_distances(const uint8_t *query_, const uint8_t *train_, int n_, int *dist_, feature_descriptor::CpuLevel level_)
+{
+  CV_Assert(level_ <= feature_descriptor::cpu_supported_level());
+  select_distances(level_)(query_, train_, n_, dist_);
+}
+
+HammingMatcher::HammingMatcher(float ratio_, bool cross_check_) :
+  _ratio(ratio_), _cross_check(cross_check_)
+{}
+HammingMatcher::~HammingMatcher()
+{}
+
+void HammingMatcher::knn_match(const BinaryDescriptors &query_, const BinaryDescriptors &train_, int k_, std::vector<std::vector<cv::DMatch>> &matches_)
+{
+  CV_Assert(k_ > 0);
+  const int n_query = static_cast<int>(query_.rows());
+  const int n_train = static_cast<int>(train_.rows());
+  matches_.assign(n_query, std::vector<cv::DMatch>());
+  if (n_query == 0 || n_train == 0)
+  {
+    return;
+  }
+  k_ = std::min(k_, n_train);
+
+  const int n_tiles = (n_query + _query_tile - 1) / _query_tile;
+  cv::parallel_for_(cv::Range(0, n_tiles), [&](const cv::Range &range) {
+    std::vector<int> dist(_train_tile);
+    std::vector<int> best_dist(static_cast<size_t>(_query_tile) * k_);
+    std::vector<int> best_idx(static_cast<size_t>(_query_tile) * k_);
+
+    for (int tile = range.start; tile < range.end; ++tile)
+    {
+      const int q0 = tile * _query_tile;
+      const int q1 = std::min(q0 + _query_tile, n_query);
+      std::fill(best_dist.begin(), best_dist.end(), INT_MAX);
+      std::fill(best_idx.begin(), best_idx.end(), -1);
+
+      // the train tile is reused by every query of the query tile while it is hot
+      for (int t0 = 0; t0 < n_train; t0 += _train_tile)
+      {
+        const int nt = std::min(_train_tile, n_train - t0);
+        for (int q = q0; q < q1; ++q)
+        {
+          hamming_distances(query_.row(q), train_.row(t0), nt, dist.data());
+          int *bd = &best_dist[static_cast<size_t>(q - q0) * k_];
+          int *bi = &best_idx[static_cast<size_t>(q - q0) * k_];
+          for (int j = 0; j < nt; ++j)
+          {
+            push_best(bd, bi, k_, dist[j], t0 + j);
+          }
+        }
+      }
+
+      for (int q = q0; q < q1; ++q)
+      {
+        const int *bd = &best_dist[static_cast<size_t>(q - q0) * k_];
+        const int *bi = &best_idx[static_cast<size_t>(q - q0) * k_];
+        auto &out     = matches_[q];
+        out.reserve(k_);
+        for (int j = 0; j < k_ && bi[j] >= 0; ++j)
+        {
+          out.emplace_back(q, bi[j], static_cast<float>(bd[j]));
+        }
+      }
+    }
+  });
+}
+
+void HammingMatcher::match(const BinaryDescriptors &query_, const BinaryDescriptors &train_, std::vector<cv::DMatch> &matches_)
+{
+  matches_.clear();
+  const bool ratio_test = _ratio < 1.f;
+
+  std::vector<std::vector<cv::DMatch>> knn;
+  knn_match(query_, train_, ratio_test ? 2 : 1, knn);
+
+  std::vector<std::vector<cv::DMatch>> reverse;
+  if (_cross_check)
+  {
+    knn_match(train_, query_, 1, reverse);
+  }
+
+  for (const auto &m : knn)
+  {
+    if (m.empty())
+    {
+      continue;
+    }
+    if (ratio_test && m.size() > 1 && m[0].distance >= _ratio * m[1].distance)
+    {
+      continue;
+    }
+    if (_cross_check && (reverse[m[0].trainIdx].empty() || reverse[m[0].trainIdx][0].trainIdx != m[0].queryIdx))
+    {
+      continue;
+    }
+    matches_.push_back(m[0]);
+  }
+}
@@ -1,5 +1,9 @@
 #include "feature_descriptor/harris.h"
 
+#include <algorithm>
+
+#include "feature_descriptor/cpu_dispatch.h"
+
 Harris::Harris()
 {}
 Harris::~Harris()
@@ -9,10 +13,14 @@ void Harris::detect(const cv::Mat &img_, std::vector<cv::Point> &corners_)
 {
   get_gradient(img_);
   cv::Mat kernel = gen_gaussion_kernel();
-  // multiply gradient of two direction and weighted sum by gaussion
-  Ixx = filter_float(Ixx, kernel);
-  Iyy = filter_float(Iyy, kernel);
-  Ixy = filter_float(Ixy, kernel);
+  // multiply gradient of two direction and weighted sum by gaussion; the result swaps with the
+  // scratch buffer, so repeated calls on one image size reuse the same memory
+  filter_float(Ixx, kernel, _scratch);
+  cv::swap(Ixx, _scratch);
+  filter_float(Iyy, kernel, _scratch);
+  cv::swap(Iyy, _scratch);
+  filter_float(Ixy, kernel, _scratch);
+  cv::swap(Ixy, _scratch);
   // response
   cv::Mat res  = score_img(img_);
   float thresh = 34 * abs(cv::mean(res)[0]);
@@ -20,6 +28,50 @@ void Harris::detect(const cv::Mat &img_, std::vector<cv::Point> &corners_)
   get_corners(res, thresh, corners_);
 }
 
+void Harris::score_points(const cv::Mat &img_, std::vector<cv::KeyPoint> &keypoints_, int block_size_)
+{
+  CV_Assert(img_.type() == CV_8UC1);
+  const int radius = block_size_ / 2;
+  const int step   = static_cast<int>(img_.step);
+  // normalise so the score does not depend on window size or intensity range
+  const float scale = 1.f / (4 * block_size_ * 255.f);
+
+  for (auto &kp : keypoints_)
+  {
+    const int x = cvRound(kp.pt.x);
+    const int y = cvRound(kp.pt.y);
+    if (x - radius - 1 < 0 || y - radius - 1 < 0 || x + radius + 1 >= img_.cols || y + radius + 1 >= img_.rows)
+    {
+      kp.response = 0.f;
+      continue;
+    }
+
+    float a = 0, b = 0, c = 0;
+    for (int r = y - radius; r <= y + radius; ++r)
+    {
+      const uchar *p = img_.ptr<uchar>(r);
+      for (int col = x - radius; col <= x + radius; ++col)
+      {
+        const uchar *q = p + col;
+        // same sobel kernels as get_gradient
+        float ix = (q[-step + 1] + 2 * q[1] + q[step + 1]) - (q[-step - 1] + 2 * q[-1] + q[step - 1]);
+        float iy = (q[step - 1] + 2 * q[step] + q[step + 1]) - (q[-step - 1] + 2 * q[-step] + q[-step + 1]);
+        ix *= scale;
+        iy *= scale;
+        a += ix * ix;
+        b += iy * iy;
+        c += ix * iy;
+      }
+    }
+    kp.response = a * b - c * c - alpha * (a + b) * (a + b);
+  }
+}
+
+std::string Harris::signature() const
+{
+  return "harris:" + std::to_string(_kernel_size) + ":" + std::to_string(_delta) + ":" + std::to_string(alpha);
+}
+
 void Harris::get_corners(const cv::Mat &res_, const float thresh_, std::vector<cv::Point> &corners_)
 {
   corners_.clear();
@@ -37,86 +89,138 @@ void Harris::get_corners(const cv::Mat &res_, const float thresh_, std::vector<c
 
 cv::Mat Harris::score_img(const cv::Mat &in_)
 {
-  cv::Mat res = cv::Mat::zeros(in_.size(), CV_32FC1);
-  for (int r = 0; r < in_.rows; r++)
-  {
-    for (int c = 0; c < in_.cols; c++)
-    {
-      cv::Mat M = (cv::Mat_<float>(2, 2) << Ixx.at<float>(r, c), Ixy.at<float>(r, c), Ixy.at<float>(r, c), Iyy.at<float>(r, c));
-      // response
-      float score         = cv::determinant(M) - alpha * cv::trace(M)[0] * cv::trace(M)[0];
-      res.at<float>(r, c) = score;
-    }
-  }
-  return res;
+  // every pixel is written below
+  _response.create(in_.size(), CV_32FC1);
+  const int cols = in_.cols;
+  const double a = alpha;
+  cv::parallel_for_(cv::Range(0, in_.rows), [&](const cv::Range &range) {
+    feature_descriptor::cpu_dispatch([&]() {
+      for (int r = range.start; r < range.end; ++r)
+      {
+        const float *xx = Ixx.ptr<float>(r);
+        const float *yy = Iyy.ptr<float>(r);
+        const float *xy = Ixy.ptr<float>(r);
+        float *res      = _response.ptr<float>(r);
+        for (int c = 0; c < cols; ++c)
+        {
+          // determinant and trace of {xx, xy; xy, yy} in double, as cv::determinant and cv::trace
+          const double det = static_cast<double>(xx[c]) * yy[c] - static_cast<double>(xy[c]) * xy[c];
+          const double tr  = static_cast<double>(xx[c]) + yy[c];
+          res[c]           = static_cast<float>(det - a * tr * tr);
+        }
+      }
+    });
+  });
+  return _response;
 }
-void Harris::get_gradient(const cv::Mat &in_)
+
+void Harris::gradient(const cv::Mat &img_, cv::Mat &ix_, cv::Mat &iy_)
 {
-  cv::Mat sobelx = (cv::Mat_<float>(3, 3) << -1, 0, 1, -2, 0, 2, -1, 0, 1);
-  cv::Mat sobely = (cv::Mat_<float>(3, 3) << -1, -2, -1, 0, 0, 0, 1, 2, 1);
-  cv::Mat Ix     = filter_uchar(in_, sobelx);
-  cv::Mat Iy     = filter_uchar(in_, sobely);
-  Ixx            = Ix.mul(Ix);
-  Iyy            = Iy.mul(Iy);
-  Ixy            = Ix.mul(Iy);
+  CV_Assert(img_.type() == CV_8UC1);
+  ix_.create(img_.size(), CV_32FC1);
+  iy_.create(img_.size(), CV_32FC1);
+  const int rows = img_.rows;
+  const int cols = img_.cols;
+  // stands in for the rows above and below the image
+  const std::vector<uchar> zero_row(cols, 0);
+
+  cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range &range) {
+    feature_descriptor::cpu_dispatch([&]() {
+      for (int r = range.start; r < range.end; ++r)
+      {
+        const uchar *u = r > 0 ? img_.ptr<uchar>(r - 1) : zero_row.data();
+        const uchar *m = img_.ptr<uchar>(r);
+        const uchar *d = r + 1 < rows ? img_.ptr<uchar>(r + 1) : zero_row.data();
+        float *gx      = ix_.ptr<float>(r);
+        float *gy      = iy_.ptr<float>(r);
+        // x = right - left columns, y = lower - upper rows
+        auto at = [cols](const uchar *p_, int c_) { return c_ >= 0 && c_ < cols ? int(p_[c_]) : 0; };
+        auto border = [&](int c_) {
+          gx[c_] = float((at(u, c_ + 1) + 2 * at(m, c_ + 1) + at(d, c_ + 1)) - (at(u, c_ - 1) + 2 * at(m, c_ - 1) + at(d, c_ - 1)));
+          gy[c_] = float((at(d, c_ - 1) + 2 * at(d, c_) + at(d, c_ + 1)) - (at(u, c_ - 1) + 2 * at(u, c_) + at(u, c_ + 1)));
+        };
+        border(0);
+        for (int c = 1; c < cols - 1; ++c)
+        {
+          gx[c] = float((u[c + 1] + 2 * m[c + 1] + d[c + 1]) - (u[c - 1] + 2 * m[c - 1] + d[c - 1]));
+          gy[c] = float((d[c - 1] + 2 * d[c] + d[c + 1]) - (u[c - 1] + 2 * u[c] + u[c + 1]));
+        }
+        if (cols > 1)
+        {
+          border(cols - 1);
+        }
+      }
+    });
+  });
 }
 
-cv::Mat Harris::filter_uchar(const cv::Mat &in_, const cv::Mat &kernel_)
+void Harris::get_gradient(const cv::Mat &in_)
 {
-  cv::Mat res     = cv::Mat::ones(in_.size(), CV_32FC1);
-  int kernel_size = kernel_.rows;
-  for (int r = 0; r < in_.rows; ++r)
-  {
-    for (int c = 0; c < in_.cols; ++c)
-    {
-      float v = 0;
-      // int cnt = 0;
-      for (int rk = -kernel_size / 2; rk < kernel_size / 2 + 1; ++rk)
+  cv::Mat &Ix = _ix, &Iy = _iy;
+  gradient(in_, Ix, Iy);
+  // the three products in one pass over Ix and Iy instead of one mul() each
+  Ixx.create(Ix.size(), CV_32FC1);
+  Iyy.create(Ix.size(), CV_32FC1);
+  Ixy.create(Ix.size(), CV_32FC1);
+  const int cols = Ix.cols;
+  cv::parallel_for_(cv::Range(0, Ix.rows), [&](const cv::Range &range) {
+    feature_descriptor::cpu_dispatch([&]() {
+      for (int r = range.start; r < range.end; ++r)
       {
-        for (int ck = -kernel_size / 2; ck < kernel_size / 2 + 1; ++ck)
+        const float *gx = Ix.ptr<float>(r);
+        const float *gy = Iy.ptr<float>(r);
+        float *xx       = Ixx.ptr<float>(r);
+        float *yy       = Iyy.ptr<float>(r);
+        float *xy       = Ixy.ptr<float>(r);
+        for (int c = 0; c < cols; ++c)
         {
-          // image border
-          if ((r + rk) < 0 || (r + rk) >= in_.rows || (c + ck) < 0 || (c + ck) >= in_.cols)
-          {
-            continue;
-          }
-          float kv = kernel_.at<float>(rk + kernel_size / 2, ck + kernel_size / 2);
-          v += float(in_.at<uchar>(r + rk, c + ck)) * kv;
+          xx[c] = gx[c] * gx[c];
+          yy[c] = gy[c] * gy[c];
+          xy[c] = gx[c] * gy[c];
         }
-      } // endfor: filter
-      res.at<float>(r, c) = v;
-    } // endfor: every column
-
-  } // endfor: every row
-  return res;
+      }
+    });
+  });
 }
 
-cv::Mat Harris::filter_float(const cv::Mat &in_, const cv::Mat &kernel_)
+void Harris::filter_float(const cv::Mat &in_, const cv::Mat &kernel_, cv::Mat &res)
 {
-  cv::Mat res     = cv::Mat::zeros(in_.size(), CV_32FC1);
-  int kernel_size = kernel_.rows;
-  for (int r = 0; r < in_.rows; ++r)
-  {
-    for (int c = 0; c < in_.cols; ++c)
-    {
-      float v = 0;
-      // int cnt = 0;
-      for (int rk = -kernel_size / 2; rk < kernel_size / 2 + 1; ++rk)
+  // every pixel is written below, out of range taps are skipped
+  res.create(in_.size(), CV_32FC1);
+  const int half = kernel_.rows / 2;
+  const int rows = in_.rows;
+  const int cols = in_.cols;
+  cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range &range) {
+    feature_descriptor::cpu_dispatch([&]() {
+      for (int r = range.start; r < range.end; ++r)
       {
-        for (int ck = -kernel_size / 2; ck < kernel_size / 2 + 1; ++ck)
+        float *out = res.ptr<float>(r);
+        std::fill(out, out + cols, 0.f);
+        // one tap at a time over the whole row, in the per-pixel order (kernel row, then column)
+        // so every sum rounds as before
+        for (int rk = -half; rk <= half; ++rk)
         {
-          if ((r + rk) < 0 || (r + rk) >= in_.rows || (c + ck) < 0 || (c + ck) >= in_.cols)
+          if (r + rk < 0 || r + rk >= rows)
           {
             continue;
           }
-          float kv = kernel_.at<float>(rk + kernel_size / 2, ck + kernel_size / 2);
-          v += in_.at<float>(r + rk, c + ck) * kv;
+          const float *in = in_.ptr<float>(r + rk);
+          const float *k  = kernel_.ptr<float>(rk + half) + half;
+          for (int ck = -half; ck <= half; ++ck)
+          {
+            const float kv = k[ck];
+            // the columns whose tap lies inside the image
+            const int c0 = std::max(0, -ck);
+            const int c1 = std::min(cols, cols - ck);
+            for (int c = c0; c < c1; ++c)
+            {
+              out[c] += in[c + ck] * kv;
+            }
+          }
         }
       }
-      res.at<float>(r, c) = v;
-    }
-  } // endfor: every row and col
-  return res;
+    });
+  });
 }
 
 float Harris::gaussion(int x, int y, float theta)
@@ -0,0 +1,583 @@
+#include "feature_descriptor/kd_forest.h"
+#include "feature_descriptor/cpu_dispatch.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KD_FOREST_HAVE_X86 1
+#endif
+
+namespace
+{
+constexpr int kAlignment = 64;
+constexpr int kBlock     = 16; // floats per 64-byte block, rows are padded to whole blocks
+// the split dimension is drawn from this many highest-variance dimensions ...
+constexpr int kRandomDims = 5;
+// ... estimated from at most this many rows of the node
+constexpr int kVarianceSamples = 100;
+
+constexpr char kMagic[8]   = {'K', 'D', 'F', 'O', 'R', 'E', 'S', 'T'};
+constexpr uint32_t kVersion = 1;
+
+// native byte order; every section offset is a multiple of kAlignment
+struct Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t dims;
+  uint32_t stride;
+  uint32_t n_trees;
+  uint32_t leaf_size;
+  uint32_t reserved;
+  uint64_t n_rows;
+  uint64_t n_nodes;
+  uint64_t roots;
+  uint64_t split_dim;
+  uint64_t split_val;
+  uint64_t left;
+  uint64_t right;
+  uint64_t ids;
+  uint64_t data;
+  uint64_t total;
+};
+
+size_t align_up(size_t bytes_)
+{
+  return (bytes_ + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// squared L2 over whole 16-float blocks, gives up once past bound_
+float l2_scalar(const float *a_, const float *b_, int stride_, float bound_)
+{
+  float d = 0;
+  for (int i = 0; i < stride_; i += kBlock)
+  {
+    for (int j = i; j < i + kBlock; ++j)
+    {
+      float t = a_[j] - b_[j];
+      d += t * t;
+    }
+    if (d > bound_)
+    {
+      break;
+    }
+  }
+  return d;
+}
+
+#ifdef KD_FOREST_HAVE_X86
+__attribute__((target("avx2,fma"))) inline float hsum(__m256 v_)
+{
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v_), _mm256_extractf128_ps(v_, 1));
+  s        = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s        = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+// the bound is only tested every 64 floats, a horizontal sum per block would cost more than it saves
+__attribute__((target("avx2,fma"))) float l2_avx2(const float *a_, const float *b_, int stride_, float bound_)
+{
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  for (int i = 0; i < stride_; i += kBlock)
+  {
+    __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a_ + i), _mm256_loadu_ps(b_ + i));
+    __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a_ + i + 8), _mm256_loadu_ps(b_ + i + 8));
+    acc0      = _mm256_fmadd_ps(d0, d0, acc0);
+    acc1      = _mm256_fmadd_ps(d1, d1, acc1);
+    if ((i + kBlock) % (4 * kBlock) == 0 && i + kBlock < stride_ && hsum(_mm256_add_ps(acc0, acc1)) > bound_)
+    {
+      break;
+    }
+  }
+  return hsum(_mm256_add_ps(acc0, acc1));
+}
+#endif
+
+using L2Fn = float (*)(const float *, const float *, int, float);
+
+L2Fn select_l2()
+{
+#ifdef KD_FOREST_HAVE_X86
+  // cpu_level() so that BS_IMAGE_ISA can switch this kernel off too
+  if (feature_descriptor::cpu_level() >= feature_descriptor::CpuLevel::avx2 && __builtin_cpu_supports("fma"))
+  {
+    return l2_avx2;
+  }
+#endif
+  return l2_scalar;
+}
+
+struct Branch
+{
+  float bound;
+  int32_t node;
+  bool operator>(const Branch &other_) const { return bound > other_.bound; }
+};
+
+// open-addressing set of the rows scored by one query; a query touches at most a few hundred
+// rows, so this stays in L1 where a per-row stamp array would be as large as the index
+class VisitedSet
+{
+ public:
+  explicit VisitedSet(size_t max_items_)
+  {
+    size_t capacity = 64;
+    while (capacity < 2 * max_items_)
+    {
+      capacity <<= 1;
+    }
+    _slots.assign(capacity, kEmpty);
+  }
+
+  void clear() { std::fill(_slots.begin(), _slots.end(), kEmpty); }
+
+  // false if id_ was already present, or if every slot is taken (which max_items_ rules out)
+  bool insert(uint32_t id_)
+  {
+    const size_t mask = _slots.size() - 1;
+    size_t s          = (id_ * 2654435761u) & mask;
+    for (size_t probes = 0; probes < _slots.size(); ++probes, s = (s + 1) & mask)
+    {
+      if (_slots[s] == id_)
+      {
+        return false;
+      }
+      if (_slots[s] == kEmpty)
+      {
+        _slots[s] = id_;
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  static constexpr uint32_t kEmpty = UINT32_MAX;
+  std::vector<uint32_t> _slots;
+};
+} // namespace
+
+KdForest::KdForest(int n_trees_, int leaf_size_) :
+  _n_trees(n_trees_), _leaf_size(leaf_size_)
+{
+  CV_Assert(n_trees_ > 0 && leaf_size_ > 0);
+}
+KdForest::~KdForest()
+{}
+
+void KdForest::build(const cv::Mat &train_)
+{
+  CV_Assert(train_.type() == CV_32F && train_.rows > 0 && train_.cols > 0);
+  CV_Assert(static_cast<uint64_t>(train_.rows) < UINT32_MAX);
+  const size_t n     = train_.rows;
+  const int dims     = train_.cols;
+  const int stride   = (dims + kBlock - 1) / kBlock * kBlock;
+  const int n_trees  = _n_trees;
+
+  std::vector<std::vector<uint32_t>> ids(n_trees);
+  std::vector<std::vector<int32_t>> split_dim(n_trees), left(n_trees), right(n_trees);
+  std::vector<std::vector<float>> split_val(n_trees);
+  cv::parallel_for_(cv::Range(0, n_trees), [&](const cv::Range &range) {
+    for (int t = range.start; t < range.end; ++t)
+    {
+      build_tree(train_, t, ids[t], split_dim[t], split_val[t], left[t], right[t]);
+    }
+  });
+
+  size_t n_nodes = 0;
+  for (int t = 0; t < n_trees; ++t)
+  {
+    n_nodes += split_dim[t].size();
+  }
+  CV_Assert(n_nodes < INT32_MAX && n * n_trees < INT32_MAX);
+
+  Header h{};
+  std::memcpy(h.magic, kMagic, sizeof(kMagic));
+  h.version   = kVersion;
+  h.dims      = dims;
+  h.stride    = stride;
+  h.n_trees   = n_trees;
+  h.leaf_size = _leaf_size;
+  h.n_rows    = n;
+  h.n_nodes   = n_nodes;
+  h.roots     = align_up(sizeof(Header));
+  h.split_dim = align_up(h.roots + n_trees * sizeof(int32_t));
+  h.split_val = align_up(h.split_dim + n_nodes * sizeof(int32_t));
+  h.left      = align_up(h.split_val + n_nodes * sizeof(float));
+  h.right     = align_up(h.left + n_nodes * sizeof(int32_t));
+  h.ids       = align_up(h.right + n_nodes * sizeof(int32_t));
+  h.data      = align_up(h.ids + n * n_trees * sizeof(uint32_t));
+  h.total     = align_up(h.data + n * stride * sizeof(float));
+
+  uint8_t *blob = static_cast<uint8_t *>(std::aligned_alloc(kAlignment, h.total));
+  CV_Assert(blob != nullptr);
+  std::shared_ptr<const uint8_t> owner(blob, [](const uint8_t *p_) { std::free(const_cast<uint8_t *>(p_)); });
+  std::memset(blob, 0, h.data);
+  std::memcpy(blob, &h, sizeof(h));
+
+  // concatenate the trees: child links are shifted by the nodes before the tree, leaf ranges by
+  // the ids before it
+  int32_t *roots_out = reinterpret_cast<int32_t *>(blob + h.roots);
+  int32_t *dim_out   = reinterpret_cast<int32_t *>(blob + h.split_dim);
+  float *val_out     = reinterpret_cast<float *>(blob + h.split_val);
+  int32_t *left_out  = reinterpret_cast<int32_t *>(blob + h.left);
+  int32_t *right_out = reinterpret_cast<int32_t *>(blob + h.right);
+  uint32_t *ids_out  = reinterpret_cast<uint32_t *>(blob + h.ids);
+  int32_t node_base  = 0;
+  for (int t = 0; t < n_trees; ++t)
+  {
+    const int32_t id_base = static_cast<int32_t>(t * n);
+    roots_out[t]          = node_base;
+    for (size_t i = 0; i < split_dim[t].size(); ++i)
+    {
+      const int32_t base = split_dim[t][i] < 0 ? id_base : node_base;
+      dim_out[node_base + i]   = split_dim[t][i];
+      val_out[node_base + i]   = split_val[t][i];
+      left_out[node_base + i]  = left[t][i] + base;
+      right_out[node_base + i] = right[t][i] + base;
+    }
+    std::memcpy(ids_out + id_base, ids[t].data(), n * sizeof(uint32_t));
+    node_base += static_cast<int32_t>(split_dim[t].size());
+  }
+
+  float *data_out = reinterpret_cast<float *>(blob + h.data);
+  cv::parallel_for_(cv::Range(0, static_cast<int>(n)), [&](const cv::Range &range) {
+    for (int i = range.start; i < range.end; ++i)
+    {
+      float *row = data_out + static_cast<size_t>(i) * stride;
+      std::memcpy(row, train_.ptr<float>(i), dims * sizeof(float));
+      std::fill(row + dims, row + stride, 0.f);
+    }
+  });
+  std::memset(blob + h.data + n * stride * sizeof(float), 0, h.total - h.data - n * stride * sizeof(float));
+
+  attach(owner, h.total);
+}
+
+void KdForest::build_tree(const cv::Mat &train_, int tree_, std::vector<uint32_t> &ids_, std::vector<int32_t> &split_dim_,
+                          std::vector<float> &split_val_, std::vector<int32_t> &left_, std::vector<int32_t> &right_)
+{
+  const int n    = train_.rows;
+  const int dims = train_.cols;
+  std::mt19937 rng(0x6b64 + tree_);
+
+  // shuffled once, so the first rows of any node are a random sample of it
+  ids_.resize(n);
+  std::iota(ids_.begin(), ids_.end(), 0u);
+  std::shuffle(ids_.begin(), ids_.end(), rng);
+
+  auto new_node = [&]() {
+    split_dim_.push_back(-1);
+    split_val_.push_back(0.f);
+    left_.push_back(0);
+    right_.push_back(0);
+    return static_cast<int32_t>(split_dim_.size() - 1);
+  };
+  auto value = [&](uint32_t id_, int d_) { return train_.ptr<float>(id_)[d_]; };
+
+  struct Task
+  {
+    int32_t node;
+    int begin;
+    int end;
+  };
+  std::vector<Task> tasks;
+  tasks.push_back({new_node(), 0, n});
+  std::vector<double> mean(dims), var(dims);
+  std::vector<int> order(dims);
+
+  while (!tasks.empty())
+  {
+    const Task task = tasks.back();
+    tasks.pop_back();
+    const int count = task.end - task.begin;
+    if (count <= _leaf_size)
+    {
+      left_[task.node]  = task.begin;
+      right_[task.node] = task.end;
+      continue;
+    }
+
+    const int n_samples = std::min(count, kVarianceSamples);
+    std::fill(mean.begin(), mean.end(), 0.0);
+    std::fill(var.begin(), var.end(), 0.0);
+    for (int s = 0; s < n_samples; ++s)
+    {
+      const float *row = train_.ptr<float>(ids_[task.begin + s]);
+      for (int d = 0; d < dims; ++d)
+      {
+        mean[d] += row[d];
+        var[d] += double(row[d]) * row[d];
+      }
+    }
+    for (int d = 0; d < dims; ++d)
+    {
+      mean[d] /= n_samples;
+      var[d] = var[d] / n_samples - mean[d] * mean[d];
+    }
+    std::iota(order.begin(), order.end(), 0);
+    const int n_top = std::min(kRandomDims, dims);
+    std::partial_sort(order.begin(), order.begin() + n_top, order.end(), [&](int a_, int b_) { return var[a_] > var[b_]; });
+    const int dim = order[rng() % n_top];
+
+    float val = static_cast<float>(mean[dim]);
+    auto begin = ids_.begin() + task.begin;
+    auto end   = ids_.begin() + task.end;
+    int mid    = static_cast<int>(std::partition(begin, end, [&](uint32_t id_) { return value(id_, dim) < val; }) - ids_.begin());
+    if (mid == task.begin || mid == task.end)
+    {
+      // constant along dim in the sample: halve by count, left stays <= val <= right
+      mid = task.begin + count / 2;
+      std::nth_element(begin, ids_.begin() + mid, end, [&](uint32_t a_, uint32_t b_) { return value(a_, dim) < value(b_, dim); });
+      val = value(ids_[mid], dim);
+    }
+
+    const int32_t l         = new_node();
+    const int32_t r         = new_node();
+    split_dim_[task.node]   = dim;
+    split_val_[task.node]   = val;
+    left_[task.node]        = l;
+    right_[task.node]       = r;
+    tasks.push_back({l, task.begin, mid});
+    tasks.push_back({r, mid, task.end});
+  }
+}
+
+void KdForest::knn_match(const cv::Mat &query_, int k_, std::vector<std::vector<cv::DMatch>> &matches_, int checks_) const
+{
+  CV_Assert(k_ > 0 && checks_ > 0);
+  const int n_query = query_.rows;
+  matches_.assign(n_query, std::vector<cv::DMatch>());
+  if (n_query == 0 || _n_rows == 0)
+  {
+    return;
+  }
+  CV_Assert(query_.type() == CV_32F && query_.cols == _dims);
+
+  static const L2Fn l2 = select_l2();
+  // the first descent of every tree is not bounded by checks_, and a leaf is always scored whole
+  const size_t max_visited = static_cast<size_t>(checks_) + static_cast<size_t>(_n_trees + 1) * _leaf_size;
+
+  cv::parallel_for_(cv::Range(0, n_query), [&](const cv::Range &range) {
+    std::vector<float> q(_stride, 0.f);
+    std::vector<Branch> heap;
+    VisitedSet visited(max_visited);
+    std::vector<float> best_dist(k_);
+    std::vector<int> best_idx(k_);
+
+    for (int qi = range.start; qi < range.end; ++qi)
+    {
+      std::memcpy(q.data(), query_.ptr<float>(qi), _dims * sizeof(float));
+      std::fill(best_dist.begin(), best_dist.end(), FLT_MAX);
+      std::fill(best_idx.begin(), best_idx.end(), -1);
+      heap.clear();
+      visited.clear();
+      int checks = 0;
+
+      // follow the near side to a leaf, queueing every far side with the distance to its split plane
+      auto descend = [&](int32_t node_, float bound_) {
+        while (_split_dim[node_] >= 0)
+        {
+          const float diff  = q[_split_dim[node_]] - _split_val[node_];
+          const int32_t near = diff < 0 ? _left[node_] : _right[node_];
+          const int32_t far  = diff < 0 ? _right[node_] : _left[node_];
+          const float far_bound = bound_ + diff * diff;
+          if (far_bound < best_dist[k_ - 1])
+          {
+            heap.push_back({far_bound, far});
+            std::push_heap(heap.begin(), heap.end(), std::greater<Branch>());
+          }
+          node_ = near;
+        }
+        for (int32_t j = _left[node_]; j < _right[node_]; ++j)
+        {
+          const uint32_t id = _ids[j];
+          if (!visited.insert(id))
+          {
+            continue;
+          }
+          ++checks;
+          const float d = l2(q.data(), _data + static_cast<size_t>(id) * _stride, _stride, best_dist[k_ - 1]);
+          if (d >= best_dist[k_ - 1])
+          {
+            continue;
+          }
+          int s = k_ - 1;
+          while (s > 0 && best_dist[s - 1] > d)
+          {
+            best_dist[s] = best_dist[s - 1];
+            best_idx[s]  = best_idx[s - 1];
+            --s;
+          }
+          best_dist[s] = d;
+          best_idx[s]  = static_cast<int>(id);
+        }
+      };
+
+      for (int t = 0; t < _n_trees; ++t)
+      {
+        descend(_roots[t], 0.f);
+      }
+      while (!heap.empty() && checks < checks_)
+      {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<Branch>());
+        const Branch b = heap.back();
+        heap.pop_back();
+        if (b.bound >= best_dist[k_ - 1])
+        {
+          break;
+        }
+        descend(b.node, b.bound);
+      }
+
+      auto &out = matches_[qi];
+      for (int s = 0; s < k_ && best_idx[s] >= 0; ++s)
+      {
+        out.emplace_back(qi, best_idx[s], std::sqrt(best_dist[s]));
+      }
+    }
+  }, cv::getNumThreads());
+}
+
+void KdForest::save(const std::string &path_) const
+{
+  CV_Assert(_blob != nullptr);
+  std::ofstream out(path_, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char *>(_blob.get()), static_cast<std::streamsize>(_blob_size));
+  if (!out.good())
+  {
+    CV_Error(cv::Error::StsError, "KdForest: failed to write " + path_);
+  }
+}
+
+bool KdForest::load(const std::string &path_)
+{
+  int fd = ::open(path_.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header)))
+  {
+    ::close(fd);
+    return false;
+  }
+  const size_t size = static_cast<size_t>(st.st_size);
+  void *addr        = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED)
+  {
+    return false;
+  }
+  std::shared_ptr<const uint8_t> owner(static_cast<const uint8_t *>(addr), [size](const uint8_t *p_) {
+    ::munmap(const_cast<uint8_t *>(p_), size);
+  });
+  return attach(owner, size);
+}
+
+bool KdForest::attach(std::shared_ptr<const uint8_t> blob_, size_t blob_size_)
+{
+  if (blob_size_ < sizeof(Header))
+  {
+    return false;
+  }
+  Header h;
+  std::memcpy(&h, blob_.get(), sizeof(h));
+  bool ok = std::memcmp(h.magic, kMagic, sizeof(kMagic)) == 0 && h.version == kVersion && h.total <= blob_size_
+            && h.n_trees > 0 && h.leaf_size > 0 && h.leaf_size <= INT_MAX && h.dims > 0 && h.stride >= h.dims && h.stride % kBlock == 0;
+  // counts small enough that the section sizes below cannot overflow
+  ok = ok && h.n_nodes <= h.total / sizeof(int32_t) && h.n_rows <= h.total / (sizeof(uint32_t) * h.n_trees)
+       && h.n_rows <= h.total / (sizeof(float) * h.stride);
+  if (!ok)
+  {
+    return false;
+  }
+  // every section in the order build writes them, each one ending before the next begins
+  const uint64_t sections[][2] = {
+    {h.roots, h.n_trees * sizeof(int32_t)},
+    {h.split_dim, h.n_nodes * sizeof(int32_t)},
+    {h.split_val, h.n_nodes * sizeof(float)},
+    {h.left, h.n_nodes * sizeof(int32_t)},
+    {h.right, h.n_nodes * sizeof(int32_t)},
+    {h.ids, h.n_rows * h.n_trees * sizeof(uint32_t)},
+    {h.data, h.n_rows * h.stride * sizeof(float)},
+  };
+  uint64_t end = sizeof(Header);
+  for (const auto &section : sections)
+  {
+    ok = ok && section[0] % kAlignment == 0 && section[0] >= end && section[0] <= h.total
+         && section[1] <= h.total - section[0];
+    end = section[0] + section[1];
+  }
+  if (!ok)
+  {
+    return false;
+  }
+
+  // links: roots and children point at nodes, a child always after its parent (so a search
+  // cannot cycle), leaves hold at most leaf_size ids (knn_match sizes its visited set by it),
+  // ids name rows
+  const uint8_t *p         = blob_.get();
+  const int32_t *roots     = reinterpret_cast<const int32_t *>(p + h.roots);
+  const int32_t *split_dim = reinterpret_cast<const int32_t *>(p + h.split_dim);
+  const int32_t *left      = reinterpret_cast<const int32_t *>(p + h.left);
+  const int32_t *right     = reinterpret_cast<const int32_t *>(p + h.right);
+  const uint32_t *ids      = reinterpret_cast<const uint32_t *>(p + h.ids);
+  const int64_t n_nodes    = static_cast<int64_t>(h.n_nodes);
+  const int64_t n_ids      = static_cast<int64_t>(h.n_rows * h.n_trees);
+  for (uint32_t t = 0; ok && t < h.n_trees; ++t)
+  {
+    ok = roots[t] >= 0 && roots[t] < n_nodes;
+  }
+  for (int64_t i = 0; ok && i < n_nodes; ++i)
+  {
+    if (split_dim[i] >= 0)
+    {
+      ok = split_dim[i] < static_cast<int64_t>(h.dims) && left[i] > i && left[i] < n_nodes && right[i] > i && right[i] < n_nodes;
+    }
+    else
+    {
+      ok = left[i] >= 0 && left[i] <= right[i] && right[i] <= n_ids && right[i] - left[i] <= static_cast<int64_t>(h.leaf_size);
+    }
+  }
+  for (int64_t i = 0; ok && i < n_ids; ++i)
+  {
+    ok = ids[i] < h.n_rows;
+  }
+  if (!ok)
+  {
+    return false;
+  }
+
+  const uint8_t *base = blob_.get();
+  _blob               = std::move(blob_);
+  _blob_size          = blob_size_;
+  _n_trees            = static_cast<int>(h.n_trees);
+  _leaf_size          = static_cast<int>(h.leaf_size);
+  _n_rows             = h.n_rows;
+  _dims               = static_cast<int>(h.dims);
+  _stride             = static_cast<int>(h.stride);
+  _roots              = reinterpret_cast<const int32_t *>(base + h.roots);
+  _split_dim          = reinterpret_cast<const int32_t *>(base + h.split_dim);
+  _split_val          = reinterpret_cast<const float *>(base + h.split_val);
+  _left               = reinterpret_cast<const int32_t *>(base + h.left);
+  _right              = reinterpret_cast<const int32_t *>(base + h.right);
+  _ids                = reinterpret_cast<const uint32_t *>(base + h.ids);
+  _data               = reinterpret_cast<const float *>(base + h.data);
+  return true;
+}
@@ -0,0 +1,387 @@
+#include "feature_descriptor/klt_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// Harris::gradient returns 8x the derivative
+constexpr float kGradScale = 1.f / 8;
+// harris k and window of the cell re-detection
+constexpr float kHarrisK = 0.05f;
+constexpr int kBlock     = 5;
+
+// win_ x win_ window of a CV_32F image with top-left corner at (x_, y_), bilinear. The fraction is
+// the same for every pixel, so an interior window is four weighted row loads per output row.
+void sample_window(const cv::Mat &img_, float x_, float y_, int win_, float *out_)
+{
+  const int x0   = cvFloor(x_);
+  const int y0   = cvFloor(y_);
+  const float ax = x_ - x0;
+  const float ay = y_ - y0;
+  const float w00 = (1 - ax) * (1 - ay), w01 = ax * (1 - ay), w10 = (1 - ax) * ay, w11 = ax * ay;
+
+  if (x0 >= 0 && y0 >= 0 && x0 + win_ < img_.cols && y0 + win_ < img_.rows)
+  {
+#ifdef __SSE2__
+    const __m128 v00 = _mm_set1_ps(w00), v01 = _mm_set1_ps(w01), v10 = _mm_set1_ps(w10), v11 = _mm_set1_ps(w11);
+#endif
+    for (int r = 0; r < win_; ++r)
+    {
+      const float *a = img_.ptr<float>(y0 + r) + x0;
+      const float *b = img_.ptr<float>(y0 + r + 1) + x0;
+      float *o       = out_ + r * win_;
+      int c          = 0;
+#ifdef __SSE2__
+      for (; c + 4 <= win_; c += 4)
+      {
+        __m128 s = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + c), v00), _mm_mul_ps(_mm_loadu_ps(a + c + 1), v01));
+        s        = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(b + c), v10));
+        s        = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(b + c + 1), v11));
+        _mm_storeu_ps(o + c, s);
+      }
+#endif
+      for (; c < win_; ++c)
+      {
+        o[c] = a[c] * w00 + a[c + 1] * w01 + b[c] * w10 + b[c + 1] * w11;
+      }
+    }
+    return;
+  }
+
+  // window crossing the border: replicate the edge pixels
+  auto at = [&](int r_, int c_) {
+    r_ = std::min(std::max(r_, 0), img_.rows - 1);
+    c_ = std::min(std::max(c_, 0), img_.cols - 1);
+    return img_.at<float>(r_, c_);
+  };
+  for (int r = 0; r < win_; ++r)
+  {
+    for (int c = 0; c < win_; ++c)
+    {
+      out_[r * win_ + c] = at(y0 + r, x0 + c) * w00 + at(y0 + r, x0 + c + 1) * w01 + at(y0 + r + 1, x0 + c) * w10
+                           + at(y0 + r + 1, x0 + c + 1) * w11;
+    }
+  }
+}
+} // namespace
+
+KltTracker::KltTracker(int win_size_, int n_levels_, int cell_size_, float min_response_, int max_iterations_, float epsilon_) :
+  _win_size(win_size_), _n_levels(n_levels_), _cell_size(cell_size_), _min_response(min_response_),
+  _max_iterations(max_iterations_), _epsilon(epsilon_)
+{
+  CV_Assert(win_size_ >= 3 && n_levels_ >= 1 && cell_size_ > 0 && max_iterations_ > 0);
+}
+KltTracker::~KltTracker()
+{}
+
+void KltTracker::reset()
+{
+  _prev.clear();
+  _curr.clear();
+  _features.clear();
+}
+
+void KltTracker::process(const cv::Mat &img_, std::vector<cv::KeyPoint> &features_)
+{
+  CV_Assert(img_.type() == CV_8UC1);
+  if (!_prev.empty() && _prev[0].img.size() != img_.size())
+  {
+    reset();
+  }
+  build_pyramid(img_);
+
+  if (!_prev.empty() && !_features.empty())
+  {
+    std::vector<uchar> alive(_features.size(), 0);
+    cv::parallel_for_(cv::Range(0, static_cast<int>(_features.size())), [&](const cv::Range &range) {
+      for (int i = range.start; i < range.end; ++i)
+      {
+        alive[i] = track_feature(_features[i].pt);
+      }
+    });
+    size_t n = 0;
+    for (size_t i = 0; i < _features.size(); ++i)
+    {
+      if (alive[i])
+      {
+        _features[n++] = _features[i];
+      }
+    }
+    _features.resize(n);
+  }
+  else
+  {
+    _features.clear();
+  }
+
+  refill(_features);
+  features_ = _features;
+  std::swap(_prev, _curr);
+}
+
+void KltTracker::build_pyramid(const cv::Mat &img_)
+{
+  _curr.resize(_n_levels);
+  cv::Mat level = img_;
+  for (int l = 0; l < _n_levels; ++l)
+  {
+    if (l > 0)
+    {
+      cv::Mat down;
+      cv::pyrDown(level, down);
+      level = down;
+    }
+    level.convertTo(_curr[l].img, CV_32F);
+    Harris::gradient(level, _curr[l].dx, _curr[l].dy);
+  }
+}
+
+bool KltTracker::track_feature(cv::Point2f &pt_) const
+{
+  const int win  = _win_size;
+  const int n    = win * win;
+  const float hw = (win - 1) * 0.5f;
+  std::vector<float> buf(4 * n);
+  float *iwin  = buf.data();
+  float *dxwin = iwin + n;
+  float *dywin = dxwin + n;
+  float *jwin  = dywin + n;
+
+  cv::Point2f guess(0.f, 0.f);
+  for (int l = _n_levels - 1; l >= 0; --l)
+  {
+    const Level &prev = _prev[l];
+    const Level &curr = _curr[l];
+    const float scale = 1.f / (1 << l);
+    const cv::Point2f p(pt_.x * scale, pt_.y * scale);
+
+    sample_window(prev.img, p.x - hw, p.y - hw, win, iwin);
+    sample_window(prev.dx, p.x - hw, p.y - hw, win, dxwin);
+    sample_window(prev.dy, p.x - hw, p.y - hw, win, dywin);
+
+    double sxx = 0, sxy = 0, syy = 0;
+    for (int i = 0; i < n; ++i)
+    {
+      sxx += dxwin[i] * dxwin[i];
+      sxy += dxwin[i] * dywin[i];
+      syy += dywin[i] * dywin[i];
+    }
+    const double g2 = kGradScale * kGradScale;
+    sxx *= g2;
+    sxy *= g2;
+    syy *= g2;
+    const double det       = sxx * syy - sxy * sxy;
+    const double min_eigen = (sxx + syy - std::sqrt((sxx - syy) * (sxx - syy) + 4 * sxy * sxy)) * 0.5 / n;
+    if (min_eigen < _min_eigen || det < 1e-9)
+    {
+      return false;
+    }
+
+    cv::Point2f v(0.f, 0.f);
+    for (int it = 0; it < _max_iterations; ++it)
+    {
+      const cv::Point2f q = p + guess + v;
+      sample_window(curr.img, q.x - hw, q.y - hw, win, jwin);
+      double bx = 0, by = 0;
+      for (int i = 0; i < n; ++i)
+      {
+        const float diff = iwin[i] - jwin[i];
+        bx += diff * dxwin[i];
+        by += diff * dywin[i];
+      }
+      bx *= kGradScale;
+      by *= kGradScale;
+      const cv::Point2f delta(static_cast<float>((syy * bx - sxy * by) / det), static_cast<float>((sxx * by - sxy * bx) / det));
+      v = v + delta;
+      if (delta.x * delta.x + delta.y * delta.y < _epsilon * _epsilon)
+      {
+        break;
+      }
+    }
+
+    if (l > 0)
+    {
+      guess = (guess + v) * 2.f;
+      continue;
+    }
+
+    const cv::Point2f q = p + guess + v;
+    if (q.x < 0 || q.y < 0 || q.x > curr.img.cols - 1 || q.y > curr.img.rows - 1)
+    {
+      return false;
+    }
+    sample_window(curr.img, q.x - hw, q.y - hw, win, jwin);
+    float residual = 0;
+    for (int i = 0; i < n; ++i)
+    {
+      residual += std::abs(iwin[i] - jwin[i]);
+    }
+    if (residual / n > _max_residual)
+    {
+      return false;
+    }
+    pt_ = q;
+  }
+  return true;
+}
+
+void KltTracker::refill(std::vector<cv::KeyPoint> &features_)
+{
+  const cv::Size size = _curr[0].img.size();
+  const int grid_w    = (size.width + _cell_size - 1) / _cell_size;
+  const int grid_h    = (size.height + _cell_size - 1) / _cell_size;
+  // features per cell, so the distance test below only looks at the 3x3 neighbouring cells
+  std::vector<std::vector<cv::Point2f>> cells(grid_w * grid_h);
+  const float min_dist2 = 0.25f * _cell_size * _cell_size;
+  auto cell_of = [&](const cv::Point2f &pt_) {
+    const int cx = std::min(std::max(static_cast<int>(pt_.x) / _cell_size, 0), grid_w - 1);
+    const int cy = std::min(std::max(static_cast<int>(pt_.y) / _cell_size, 0), grid_h - 1);
+    return cy * grid_w + cx;
+  };
+  auto crowded = [&](const cv::Point2f &pt_) {
+    const int c = cell_of(pt_);
+    for (int y = std::max(c / grid_w - 1, 0); y <= std::min(c / grid_w + 1, grid_h - 1); ++y)
+    {
+      for (int x = std::max(c % grid_w - 1, 0); x <= std::min(c % grid_w + 1, grid_w - 1); ++x)
+      {
+        for (const auto &q : cells[y * grid_w + x])
+        {
+          const cv::Point2f d = q - pt_;
+          if (d.x * d.x + d.y * d.y < min_dist2)
+          {
+            return true;
+          }
+        }
+      }
+    }
+    return false;
+  };
+
+  // tracks converging within half a cell: the oldest survives, features are kept in creation order
+  size_t n = 0;
+  for (size_t i = 0; i < features_.size(); ++i)
+  {
+    if (!crowded(features_[i].pt))
+    {
+      cells[cell_of(features_[i].pt)].push_back(features_[i].pt);
+      features_[n++] = features_[i];
+    }
+  }
+  features_.resize(n);
+
+  std::vector<int> empty;
+  for (int c = 0; c < grid_w * grid_h; ++c)
+  {
+    if (cells[c].empty())
+    {
+      empty.push_back(c);
+    }
+  }
+  std::vector<cv::KeyPoint> found(empty.size());
+  std::vector<uchar> ok(empty.size(), 0);
+  cv::parallel_for_(cv::Range(0, static_cast<int>(empty.size())), [&](const cv::Range &range) {
+    for (int i = range.start; i < range.end; ++i)
+    {
+      ok[i] = detect_cell(empty[i] % grid_w, empty[i] / grid_w, found[i]);
+    }
+  });
+  for (size_t i = 0; i < empty.size(); ++i)
+  {
+    if (ok[i] && !crowded(found[i].pt))
+    {
+      found[i].class_id = _next_id++;
+      cells[cell_of(found[i].pt)].push_back(found[i].pt);
+      features_.push_back(found[i]);
+    }
+  }
+}
+
+bool KltTracker::detect_cell(int cell_x_, int cell_y_, cv::KeyPoint &kp_) const
+{
+  const cv::Mat &dx = _curr[0].dx;
+  const cv::Mat &dy = _curr[0].dy;
+  // corners closer to the border than half a window cannot be tracked reliably
+  const int margin = std::max(_win_size / 2, kBlock / 2 + 1);
+  const int x0     = std::max(cell_x_ * _cell_size, margin);
+  const int y0     = std::max(cell_y_ * _cell_size, margin);
+  const int x1     = std::min((cell_x_ + 1) * _cell_size, dx.cols - margin);
+  const int y1     = std::min((cell_y_ + 1) * _cell_size, dx.rows - margin);
+  if (x0 >= x1 || y0 >= y1)
+  {
+    return false;
+  }
+
+  // structure tensor products of the cell plus the block radius, then separable block sums
+  const int h  = kBlock / 2;
+  const int w  = x1 - x0 + 2 * h;
+  const int ht = y1 - y0 + 2 * h;
+  std::vector<float> xx(w * ht), yy(w * ht), xy(w * ht);
+  for (int r = 0; r < ht; ++r)
+  {
+    const float *gx = dx.ptr<float>(y0 - h + r) + x0 - h;
+    const float *gy = dy.ptr<float>(y0 - h + r) + x0 - h;
+    for (int c = 0; c < w; ++c)
+    {
+      const float ix = gx[c] * kGradScale;
+      const float iy = gy[c] * kGradScale;
+      xx[r * w + c]  = ix * ix;
+      yy[r * w + c]  = iy * iy;
+      xy[r * w + c]  = ix * iy;
+    }
+  }
+  auto box = [&](std::vector<float> &m_) {
+    // vertical then horizontal sums, in place with a row buffer
+    std::vector<float> col(w);
+    for (int r = 0; r + kBlock <= ht; ++r)
+    {
+      std::fill(col.begin(), col.end(), 0.f);
+      for (int k = 0; k < kBlock; ++k)
+      {
+        for (int c = 0; c < w; ++c)
+        {
+          col[c] += m_[(r + k) * w + c];
+        }
+      }
+      for (int c = 0; c + kBlock <= w; ++c)
+      {
+        float s = 0;
+        for (int k = 0; k < kBlock; ++k)
+        {
+          s += col[c + k];
+        }
+        m_[r * w + c] = s * (1.f / (kBlock * kBlock));
+      }
+    }
+  };
+  box(xx);
+  box(yy);
+  box(xy);
+
+  float best = _min_response;
+  int best_r = -1, best_c = -1;
+  for (int r = 0; r < y1 - y0; ++r)
+  {
+    for (int c = 0; c < x1 - x0; ++c)
+    {
+      const float a = xx[r * w + c], b = yy[r * w + c], d = xy[r * w + c];
+      const float response = a * b - d * d - kHarrisK * (a + b) * (a + b);
+      if (response > best)
+      {
+        best   = response;
+        best_r = r;
+        best_c = c;
+      }
+    }
+  }
+  if (best_r < 0)
+  {
+    return false;
+  }
+  kp_ = cv::KeyPoint(cv::Point2f(static_cast<float>(x0 + best_c), static_cast<float>(y0 + best_r)), static_cast<float>(_win_size), -1, best);
+  return true;
+}
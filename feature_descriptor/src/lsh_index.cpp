@@ -0,0 +1,167 @@
+#include "feature_descriptor/lsh_index.h"
+
+#include <climits>
+#include <numeric>
+#include <random>
+
+#include "feature_descriptor/hamming_matcher.h"
+
+LshIndex::LshIndex(int n_tables_, int key_bits_, int probe_level_) :
+  _n_tables(n_tables_), _key_bits(key_bits_), _probe_level(probe_level_)
+{
+  CV_Assert(n_tables_ > 0 && key_bits_ > 0 && key_bits_ <= 24 && probe_level_ >= 0 && probe_level_ <= 2);
+
+  // distinct bit positions inside a table, independent between tables
+  std::mt19937 rng(0x4c5348);
+  std::vector<int> all(BinaryDescriptors::kBytes * 8);
+  std::iota(all.begin(), all.end(), 0);
+  _bits.reserve(static_cast<size_t>(_n_tables) * _key_bits);
+  for (int t = 0; t < _n_tables; ++t)
+  {
+    for (int b = 0; b < _key_bits; ++b)
+    {
+      std::swap(all[b], all[b + rng() % (all.size() - b)]);
+      _bits.push_back(all[b]);
+    }
+  }
+}
+LshIndex::~LshIndex()
+{}
+
+void LshIndex::build(const BinaryDescriptors &train_)
+{
+  CV_Assert(train_.rows() < UINT32_MAX);
+  _train           = train_;
+  const size_t n   = _train.rows();
+  const size_t n_b = size_t(1) << _key_bits;
+
+  _offsets.assign(_n_tables, std::vector<uint32_t>());
+  _ids.assign(_n_tables, std::vector<uint32_t>());
+
+  // counting sort per table: bucket sizes, prefix sum, scatter
+  cv::parallel_for_(cv::Range(0, _n_tables), [&](const cv::Range &range) {
+    std::vector<uint32_t> keys(n);
+    for (int t = range.start; t < range.end; ++t)
+    {
+      auto &offsets = _offsets[t];
+      auto &ids     = _ids[t];
+      offsets.assign(n_b + 1, 0);
+      for (size_t i = 0; i < n; ++i)
+      {
+        keys[i] = hash(_train.row(i), t);
+        ++offsets[keys[i] + 1];
+      }
+      for (size_t b = 0; b < n_b; ++b)
+      {
+        offsets[b + 1] += offsets[b];
+      }
+      ids.resize(n);
+      std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+      for (size_t i = 0; i < n; ++i)
+      {
+        ids[fill[keys[i]]++] = static_cast<uint32_t>(i);
+      }
+    }
+  });
+}
+
+void LshIndex::knn_match(const BinaryDescriptors &query_, int k_, std::vector<std::vector<cv::DMatch>> &matches_) const
+{
+  CV_Assert(k_ > 0);
+  const int n_query = static_cast<int>(query_.rows());
+  matches_.assign(n_query, std::vector<cv::DMatch>());
+  if (n_query == 0 || _train.empty())
+  {
+    return;
+  }
+
+  // one stripe per thread, the visited stamps are as large as the index
+  cv::parallel_for_(cv::Range(0, n_query), [&](const cv::Range &range) {
+    // stamp per train row so a candidate found in several tables is scored once
+    std::vector<uint32_t> visited(_train.rows(), 0);
+    uint32_t stamp = 0;
+    std::vector<uint32_t> keys;
+    std::vector<int> best_dist(k_), best_idx(k_);
+
+    for (int q = range.start; q < range.end; ++q)
+    {
+      const uint8_t *desc = query_.row(q);
+      ++stamp;
+      std::fill(best_dist.begin(), best_dist.end(), INT_MAX);
+      std::fill(best_idx.begin(), best_idx.end(), -1);
+
+      for (int t = 0; t < _n_tables; ++t)
+      {
+        probe_keys(hash(desc, t), keys);
+        for (uint32_t key : keys)
+        {
+          for (uint32_t j = _offsets[t][key]; j < _offsets[t][key + 1]; ++j)
+          {
+            const uint32_t id = _ids[t][j];
+            if (visited[id] == stamp)
+            {
+              continue;
+            }
+            visited[id] = stamp;
+
+            int d = 0;
+            hamming_distances(desc, _train.row(id), 1, &d);
+            if (d >= best_dist[k_ - 1])
+            {
+              continue;
+            }
+            int s = k_ - 1;
+            while (s > 0 && best_dist[s - 1] > d)
+            {
+              best_dist[s] = best_dist[s - 1];
+              best_idx[s]  = best_idx[s - 1];
+              --s;
+            }
+            best_dist[s] = d;
+            best_idx[s]  = static_cast<int>(id);
+          }
+        }
+      }
+
+      auto &out = matches_[q];
+      for (int s = 0; s < k_ && best_idx[s] >= 0; ++s)
+      {
+        out.emplace_back(q, best_idx[s], static_cast<float>(best_dist[s]));
+      }
+    }
+  }, cv::getNumThreads());
+}
+
+uint32_t LshIndex::hash(const uint8_t *desc_, int table_) const
+{
+  const int *bits = &_bits[static_cast<size_t>(table_) * _key_bits];
+  uint32_t key    = 0;
+  for (int b = 0; b < _key_bits; ++b)
+  {
+    key |= static_cast<uint32_t>((desc_[bits[b] >> 3] >> (bits[b] & 7)) & 1) << b;
+  }
+  return key;
+}
+
+void LshIndex::probe_keys(uint32_t key_, std::vector<uint32_t> &keys_) const
+{
+  keys_.clear();
+  keys_.push_back(key_);
+  if (_probe_level >= 1)
+  {
+    for (int i = 0; i < _key_bits; ++i)
+    {
+      keys_.push_back(key_ ^ (1u << i));
+    }
+  }
+  if (_probe_level >= 2)
+  {
+    for (int i = 0; i < _key_bits; ++i)
+    {
+      for (int j = i + 1; j < _key_bits; ++j)
+      {
+        keys_.push_back(key_ ^ (1u << i) ^ (1u << j));
+      }
+    }
+  }
+}
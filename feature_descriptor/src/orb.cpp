@@ -0,0 +1,305 @@
+#include "feature_descriptor/orb.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace
+{
+constexpr int kPairs = BinaryDescriptors::kBytes * 8;
+
+size_t aligned_bytes(size_t rows_)
+{
+  size_t bytes = rows_ * BinaryDescriptors::kBytes;
+  return (bytes + BinaryDescriptors::kAlignment - 1) / BinaryDescriptors::kAlignment * BinaryDescriptors::kAlignment;
+}
+
+bool by_response(const cv::KeyPoint &a_, const cv::KeyPoint &b_)
+{
+  return a_.response > b_.response;
+}
+
+void retain_best(std::vector<cv::KeyPoint> &keypoints_, int n_)
+{
+  if (n_ >= 0 && keypoints_.size() > static_cast<size_t>(n_))
+  {
+    std::nth_element(keypoints_.begin(), keypoints_.begin() + n_, keypoints_.end(), by_response);
+    keypoints_.resize(n_);
+  }
+}
+} // namespace
+
+BinaryDescriptors::BinaryDescriptors()
+{}
+
+BinaryDescriptors::BinaryDescriptors(size_t rows_)
+{
+  resize(rows_);
+}
+
+BinaryDescriptors::BinaryDescriptors(const BinaryDescriptors &other_)
+{
+  resize(other_._rows);
+  if (_rows > 0)
+  {
+    std::memcpy(_data, other_._data, _rows * kBytes);
+  }
+}
+
+BinaryDescriptors::BinaryDescriptors(BinaryDescriptors &&other_) noexcept :
+  _data(other_._data), _rows(other_._rows), _capacity(other_._capacity)
+{
+  other_._data     = nullptr;
+  other_._rows     = 0;
+  other_._capacity = 0;
+}
+
+BinaryDescriptors &BinaryDescriptors::operator=(BinaryDescriptors other_) noexcept
+{
+  std::swap(_data, other_._data);
+  std::swap(_rows, other_._rows);
+  std::swap(_capacity, other_._capacity);
+  return *this;
+}
+
+BinaryDescriptors::~BinaryDescriptors()
+{
+  std::free(_data);
+}
+
+void BinaryDescriptors::resize(size_t rows_)
+{
+  if (rows_ > _capacity)
+  {
+    size_t capacity = std::max(rows_, _capacity * 2);
+    auto *data      = static_cast<uint8_t *>(std::aligned_alloc(kAlignment, aligned_bytes(capacity)));
+    if (data == nullptr)
+    {
+      throw std::bad_alloc();
+    }
+    if (_rows > 0)
+    {
+      std::memcpy(data, _data, _rows * kBytes);
+    }
+    std::free(_data);
+    _data     = data;
+    _capacity = capacity;
+  }
+  _rows = rows_;
+}
+
+cv::Mat BinaryDescriptors::mat() const
+{
+  if (_rows == 0)
+  {
+    return cv::Mat(0, kBytes, CV_8UC1);
+  }
+  return cv::Mat(static_cast<int>(_rows), kBytes, CV_8UC1, const_cast<uint8_t *>(_data));
+}
+
+ORB::ORB(int n_features_, float scale_factor_, int n_levels_, int fast_threshold_) :
+  _n_features(n_features_), _scale_factor(scale_factor_), _n_levels(n_levels_), _fast(fast_threshold_, true)
+{
+  CV_Assert(n_levels_ >= 1 && (n_levels_ == 1 || scale_factor_ > 1.f));
+
+  _scales.resize(_n_levels);
+  _scales[0] = 1.f;
+  for (int l = 1; l < _n_levels; ++l)
+  {
+    _scales[l] = _scales[l - 1] * _scale_factor;
+  }
+
+  _umax.resize(_half_patch + 1);
+  for (int v = 0; v <= _half_patch; ++v)
+  {
+    _umax[v] = cvFloor(std::sqrt(static_cast<double>(_half_patch * _half_patch - v * v)));
+  }
+
+  gen_rotated_patterns();
+}
+ORB::~ORB()
+{}
+
+void ORB::detect_and_compute(const cv::Mat &img_, std::vector<cv::KeyPoint> &keypoints_, BinaryDescriptors &descriptors_)
+{
+  CV_Assert(img_.type() == CV_8UC1);
+  keypoints_.clear();
+  descriptors_.clear();
+
+  build_pyramid(img_);
+
+  // spread the feature budget geometrically over the levels, like the area of each level
+  std::vector<int> n_per_level(_n_levels);
+  const float factor = 1.f / _scale_factor;
+  float n_desired    = _n_levels == 1 ? _n_features : _n_features * (1 - factor) / (1 - std::pow(factor, static_cast<float>(_n_levels)));
+  int sum            = 0;
+  for (int l = 0; l < _n_levels - 1; ++l)
+  {
+    n_per_level[l] = cvRound(n_desired);
+    sum += n_per_level[l];
+    n_desired *= factor;
+  }
+  n_per_level[_n_levels - 1] = std::max(_n_features - sum, 0);
+
+  std::vector<std::vector<cv::KeyPoint>> level_keypoints(_n_levels);
+  size_t total = 0;
+  for (int l = 0; l < _n_levels; ++l)
+  {
+    detect_level(l, n_per_level[l], level_keypoints[l]);
+    total += level_keypoints[l].size();
+  }
+
+  // one allocation for all rows, each level then writes its own contiguous block
+  keypoints_.reserve(total);
+  descriptors_.resize(total);
+  size_t row = 0;
+  cv::Mat blurred;
+  for (int l = 0; l < _n_levels; ++l)
+  {
+    if (level_keypoints[l].empty())
+    {
+      continue;
+    }
+    cv::GaussianBlur(_pyramid[l], blurred, cv::Size(7, 7), 2, 2, cv::BORDER_REFLECT_101);
+    for (auto &kp : level_keypoints[l])
+    {
+      compute_descriptor(blurred, kp, descriptors_.row(row++));
+      kp.pt.x *= _scales[l];
+      kp.pt.y *= _scales[l];
+      kp.size = _patch_size * _scales[l];
+      keypoints_.push_back(kp);
+    }
+  }
+}
+
+void ORB::build_pyramid(const cv::Mat &img_)
+{
+  _pyramid.resize(_n_levels);
+  _pyramid[0] = img_;
+  for (int l = 1; l < _n_levels; ++l)
+  {
+    cv::Size sz(cvRound(img_.cols / _scales[l]), cvRound(img_.rows / _scales[l]));
+    cv::resize(_pyramid[l - 1], _pyramid[l], sz, 0, 0, cv::INTER_LINEAR);
+  }
+}
+
+void ORB::detect_level(int level_, int n_, std::vector<cv::KeyPoint> &keypoints_)
+{
+  const cv::Mat &img = _pyramid[level_];
+  _fast.detect(img, keypoints_, _edge);
+
+  // cheap FAST score first, then the more stable Harris score on the survivors
+  retain_best(keypoints_, 2 * n_);
+  _harris.score_points(img, keypoints_, 7);
+  retain_best(keypoints_, n_);
+
+  for (auto &kp : keypoints_)
+  {
+    kp.angle  = ic_angle(img, cv::Point(cvRound(kp.pt.x), cvRound(kp.pt.y)));
+    kp.octave = level_;
+  }
+}
+
+float ORB::ic_angle(const cv::Mat &img_, const cv::Point &pt_)
+{
+  const uchar *center = img_.ptr<uchar>(pt_.y) + pt_.x;
+  const int step      = static_cast<int>(img_.step);
+
+  int m_01 = 0, m_10 = 0;
+  for (int u = -_half_patch; u <= _half_patch; ++u)
+  {
+    m_10 += u * center[u];
+  }
+  // rows v and -v share u, so each pair contributes to m_10 once and to m_01 with their difference
+  for (int v = 1; v <= _half_patch; ++v)
+  {
+    int v_sum = 0;
+    const int d = _umax[v];
+    for (int u = -d; u <= d; ++u)
+    {
+      const int plus  = center[u + v * step];
+      const int minus = center[u - v * step];
+      v_sum += plus - minus;
+      m_10 += u * (plus + minus);
+    }
+    m_01 += v * v_sum;
+  }
+
+  float angle = static_cast<float>(std::atan2(static_cast<double>(m_01), static_cast<double>(m_10)) * 180.0 / CV_PI);
+  return angle < 0 ? angle + 360.f : angle;
+}
+
+void ORB::compute_descriptor(const cv::Mat &blurred_, const cv::KeyPoint &kp_, uint8_t *desc_)
+{
+  const int bin       = cvRound(kp_.angle * _angle_bins / 360.f) % _angle_bins;
+  const int8_t *pat   = &_rotated_pattern[static_cast<size_t>(bin) * kPairs * 4];
+  const uchar *center = blurred_.ptr<uchar>(cvRound(kp_.pt.y)) + cvRound(kp_.pt.x);
+  const int step      = static_cast<int>(blurred_.step);
+
+  for (int i = 0; i < BinaryDescriptors::kBytes; ++i)
+  {
+    uint8_t byte = 0;
+    for (int b = 0; b < 8; ++b, pat += 4)
+    {
+      const int t0 = center[pat[1] * step + pat[0]];
+      const int t1 = center[pat[3] * step + pat[2]];
+      byte |= static_cast<uint8_t>(t0 < t1) << b;
+    }
+    desc_[i] = byte;
+  }
+}
+
+void ORB::gen_pattern(std::vector<cv::Point> &pattern_)
+{
+  // isotropic gaussian sampling (BRIEF G II), sigma = patch_size / 5; mt19937 output is
+  // identical on every platform, the box-muller transform is done by hand for the same reason
+  std::mt19937 rng(0x4f5242);
+  const double sigma = _patch_size / 5.0;
+  auto uniform       = [&rng]() { return (rng() + 0.5) / 4294967296.0; };
+  auto sample        = [&]() {
+    while (true)
+    {
+      const double rad = sigma * std::sqrt(-2.0 * std::log(uniform()));
+      const double phi = 2 * CV_PI * uniform();
+      cv::Point p(cvRound(rad * std::cos(phi)), cvRound(rad * std::sin(phi)));
+      if (p.x * p.x + p.y * p.y <= _pattern_max * _pattern_max)
+      {
+        return p;
+      }
+    }
+  };
+
+  pattern_.clear();
+  pattern_.reserve(2 * kPairs);
+  for (int i = 0; i < kPairs; ++i)
+  {
+    cv::Point p1 = sample();
+    cv::Point p2 = sample();
+    while (p2 == p1)
+    {
+      p2 = sample();
+    }
+    pattern_.push_back(p1);
+    pattern_.push_back(p2);
+  }
+}
+
+void ORB::gen_rotated_patterns()
+{
+  std::vector<cv::Point> pattern;
+  gen_pattern(pattern);
+
+  _rotated_pattern.resize(static_cast<size_t>(_angle_bins) * kPairs * 4);
+  int8_t *out = _rotated_pattern.data();
+  for (int bin = 0; bin < _angle_bins; ++bin)
+  {
+    const double theta = bin * 2 * CV_PI / _angle_bins;
+    const double cs = std::cos(theta), sn = std::sin(theta);
+    for (const auto &p : pattern)
+    {
+      *out++ = static_cast<int8_t>(cvRound(p.x * cs - p.y * sn));
+      *out++ = static_cast<int8_t>(cvRound(p.x * sn + p.y * cs));
+    }
+  }
+}
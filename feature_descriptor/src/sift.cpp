@@ -0,0 +1,568 @@
+#include "feature_descriptor/sift.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+constexpr int kImgBorder        = 5;
+constexpr int kMaxInterpSteps   = 5;
+constexpr int kOriHistBins      = 36;
+constexpr float kOriSigFactor   = 1.5f;
+constexpr float kOriRadius      = 3 * kOriSigFactor;
+constexpr float kOriPeakRatio   = 0.8f;
+constexpr int kDescrWidth       = 4;
+constexpr int kDescrHistBins    = 8;
+constexpr int kDescrSize        = kDescrWidth * kDescrWidth * kDescrHistBins;
+constexpr float kDescrSclFactor = 3.f;
+constexpr float kDescrMagThr    = 0.2f;
+constexpr float kIntDescrFactor = 512.f;
+constexpr float kInitSigma      = 0.5f;
+constexpr int kBandRows         = 32;
+
+// DoG values are kept in the 0..255 range of the input
+constexpr float kImgScale = 1.f / 255.f;
+
+inline int unpack_octave(const cv::KeyPoint &kp_)
+{
+  return kp_.octave & 255;
+}
+
+inline int unpack_layer(const cv::KeyPoint &kp_)
+{
+  return (kp_.octave >> 8) & 255;
+}
+} // namespace
+
+SIFT::SIFT(int n_features_, int n_octave_layers_, double contrast_threshold_, double edge_threshold_, double sigma_, int descriptor_type_) :
+  _n_features(n_features_), _n_octave_layers(n_octave_layers_), _contrast_threshold(contrast_threshold_),
+  _edge_threshold(edge_threshold_), _sigma(sigma_), _descriptor_type(descriptor_type_)
+{
+  CV_Assert(n_octave_layers_ > 0 && sigma_ > kInitSigma);
+  CV_Assert(descriptor_type_ == CV_32F || descriptor_type_ == CV_8U);
+
+  // level i has sigma * k^i, blurring level i - 1 by level_sigmas[i] gets there
+  const int n_levels = _n_octave_layers + 3;
+  const double k     = std::pow(2., 1. / _n_octave_layers);
+  _level_sigmas.resize(n_levels);
+  _level_sigmas[0] = _sigma;
+  for (int i = 1; i < n_levels; ++i)
+  {
+    double prev      = std::pow(k, static_cast<double>(i - 1)) * _sigma;
+    double total     = prev * k;
+    _level_sigmas[i] = std::sqrt(total * total - prev * prev);
+  }
+}
+SIFT::~SIFT()
+{}
+
+void SIFT::detect_and_compute(const cv::Mat &img_, std::vector<cv::KeyPoint> &keypoints_, cv::Mat &descriptors_)
+{
+  CV_Assert(img_.type() == CV_8UC1);
+  keypoints_.clear();
+
+  const int min_side = std::min(img_.rows, img_.cols);
+  const int n_octaves = std::max(1, cvRound(std::log2(static_cast<double>(min_side))) - 3);
+  build_octave_bases(img_, n_octaves);
+  build_octaves();
+  find_extrema(keypoints_);
+
+  if (_n_features > 0 && keypoints_.size() > static_cast<size_t>(_n_features))
+  {
+    std::nth_element(keypoints_.begin(), keypoints_.begin() + _n_features, keypoints_.end(),
+                     [](const cv::KeyPoint &a, const cv::KeyPoint &b) { return a.response > b.response; });
+    keypoints_.resize(_n_features);
+  }
+
+  const int n = static_cast<int>(keypoints_.size());
+  descriptors_.create(n, kDescrSize, _descriptor_type);
+  cv::parallel_for_(cv::Range(0, n), [&](const cv::Range &range) {
+    float desc[kDescrSize];
+    for (int i = range.start; i < range.end; ++i)
+    {
+      calc_descriptor(keypoints_[i], desc);
+      if (_descriptor_type == CV_32F)
+      {
+        std::copy(desc, desc + kDescrSize, descriptors_.ptr<float>(i));
+      }
+      else
+      {
+        uchar *out = descriptors_.ptr<uchar>(i);
+        for (int k = 0; k < kDescrSize; ++k)
+        {
+          out[k] = cv::saturate_cast<uchar>(desc[k] * kIntDescrFactor);
+        }
+      }
+    }
+  });
+
+  // keypoints were found in octave coordinates
+  for (auto &kp : keypoints_)
+  {
+    const float scale = static_cast<float>(1 << unpack_octave(kp));
+    kp.pt.x *= scale;
+    kp.pt.y *= scale;
+    kp.size *= scale;
+  }
+}
+
+void SIFT::build_octave_bases(const cv::Mat &img_, int n_octaves_)
+{
+  _n_octaves = n_octaves_;
+  _bases.resize(_n_octaves);
+
+  cv::Mat img_f;
+  img_.convertTo(img_f, CV_32F);
+  // the camera already blurred by about kInitSigma
+  const double sig_diff = std::sqrt(std::max(_sigma * _sigma - kInitSigma * kInitSigma, 0.01));
+  cv::GaussianBlur(img_f, _bases[0], cv::Size(), sig_diff, sig_diff);
+
+  // level n_octave_layers of an octave is at 2 * sigma, one blur by sigma * sqrt(3) reaches it
+  // from the base directly, so the chain of bases only costs one blur per octave
+  const double to_next = _sigma * std::sqrt(3.);
+  cv::Mat blurred;
+  for (int o = 1; o < _n_octaves; ++o)
+  {
+    cv::GaussianBlur(_bases[o - 1], blurred, cv::Size(), to_next, to_next);
+    cv::resize(blurred, _bases[o], cv::Size(blurred.cols / 2, blurred.rows / 2), 0, 0, cv::INTER_NEAREST);
+  }
+}
+
+void SIFT::build_octaves()
+{
+  const int n_levels = _n_octave_layers + 3;
+  _gauss.resize(static_cast<size_t>(_n_octaves) * n_levels);
+  _dog.resize(static_cast<size_t>(_n_octaves) * (n_levels - 1));
+
+  cv::parallel_for_(cv::Range(0, _n_octaves), [&](const cv::Range &range) {
+    for (int o = range.start; o < range.end; ++o)
+    {
+      cv::Mat *gauss = &_gauss[static_cast<size_t>(o) * n_levels];
+      cv::Mat *dog   = &_dog[static_cast<size_t>(o) * (n_levels - 1)];
+      gauss[0]       = _bases[o];
+      for (int i = 1; i < n_levels; ++i)
+      {
+        cv::GaussianBlur(gauss[i - 1], gauss[i], cv::Size(), _level_sigmas[i], _level_sigmas[i]);
+        dog[i - 1] = gauss[i] - gauss[i - 1];
+      }
+    }
+  }, _n_octaves);
+}
+
+void SIFT::find_extrema(std::vector<cv::KeyPoint> &keypoints_)
+{
+  // one task per band of rows of every DoG layer that has a layer above and below
+  struct Task
+  {
+    int octave, layer, row_begin, row_end;
+  };
+  std::vector<Task> tasks;
+  for (int o = 0; o < _n_octaves; ++o)
+  {
+    const int rows = dog(o, 0).rows;
+    for (int layer = 1; layer <= _n_octave_layers; ++layer)
+    {
+      for (int r = kImgBorder; r < rows - kImgBorder; r += kBandRows)
+      {
+        tasks.push_back({o, layer, r, std::min(r + kBandRows, rows - kImgBorder)});
+      }
+    }
+  }
+
+  std::vector<std::vector<cv::KeyPoint>> found(tasks.size());
+  cv::parallel_for_(cv::Range(0, static_cast<int>(tasks.size())), [&](const cv::Range &range) {
+    for (int t = range.start; t < range.end; ++t)
+    {
+      find_extrema_band(tasks[t].octave, tasks[t].layer, tasks[t].row_begin, tasks[t].row_end, found[t]);
+    }
+  });
+
+  // concatenating in task order keeps the result independent of scheduling
+  for (const auto &f : found)
+  {
+    keypoints_.insert(keypoints_.end(), f.begin(), f.end());
+  }
+}
+
+void SIFT::find_extrema_band(int octave_, int layer_, int row_begin_, int row_end_, std::vector<cv::KeyPoint> &keypoints_)
+{
+  const float threshold = static_cast<float>(std::floor(0.5 * _contrast_threshold / _n_octave_layers * 255));
+  const cv::Mat &prev   = dog(octave_, layer_ - 1);
+  const cv::Mat &img    = dog(octave_, layer_);
+  const cv::Mat &next   = dog(octave_, layer_ + 1);
+  const int cols        = img.cols;
+  const int step        = static_cast<int>(img.step / sizeof(float));
+  float hist[kOriHistBins];
+
+  auto add_candidate = [&](int r, int c) {
+    int layer = layer_, rr = r, cc = c;
+    cv::KeyPoint kp;
+    if (!adjust_local_extrema(octave_, layer, rr, cc, kp))
+    {
+      return;
+    }
+    // orientation from the gaussian level the extremum settled in
+    const float scl_octv = kp.size * 0.5f;
+    const float omax     = calc_orientation_hist(gauss(octave_, layer), cv::Point(cc, rr), cvRound(kOriRadius * scl_octv),
+                                                 kOriSigFactor * scl_octv, hist, kOriHistBins);
+    const float mag_thr  = omax * kOriPeakRatio;
+    for (int j = 0; j < kOriHistBins; ++j)
+    {
+      const int l = j > 0 ? j - 1 : kOriHistBins - 1;
+      const int r2 = j < kOriHistBins - 1 ? j + 1 : 0;
+      if (hist[j] > hist[l] && hist[j] > hist[r2] && hist[j] >= mag_thr)
+      {
+        float bin = j + 0.5f * (hist[l] - hist[r2]) / (hist[l] - 2 * hist[j] + hist[r2]);
+        bin       = bin < 0 ? kOriHistBins + bin : bin >= kOriHistBins ? bin - kOriHistBins : bin;
+        kp.angle  = 360.f - (360.f / kOriHistBins) * bin;
+        if (std::abs(kp.angle - 360.f) < FLT_EPSILON)
+        {
+          kp.angle = 0.f;
+        }
+        keypoints_.push_back(kp);
+      }
+    }
+  };
+
+  for (int r = row_begin_; r < row_end_; ++r)
+  {
+    const float *cur = img.ptr<float>(r);
+    const float *pre = prev.ptr<float>(r);
+    const float *nxt = next.ptr<float>(r);
+    int c            = kImgBorder;
+#ifdef __SSE2__
+    // four columns at a time: max and min over the 26 neighbours, then one compare per side
+    const __m128 thr_pos = _mm_set1_ps(threshold);
+    const __m128 thr_neg = _mm_set1_ps(-threshold);
+    for (; c + 4 <= cols - kImgBorder; c += 4)
+    {
+      const __m128 v = _mm_loadu_ps(cur + c);
+      const int any  = _mm_movemask_ps(_mm_or_ps(_mm_cmpgt_ps(v, thr_pos), _mm_cmplt_ps(v, thr_neg)));
+      if (!any)
+      {
+        continue;
+      }
+      __m128 vmax = _mm_loadu_ps(cur + c - 1);
+      __m128 vmin = vmax;
+      auto acc    = [&](const float *p) {
+        const __m128 x = _mm_loadu_ps(p);
+        vmax           = _mm_max_ps(vmax, x);
+        vmin           = _mm_min_ps(vmin, x);
+      };
+      acc(cur + c + 1);
+      for (int dc = -1; dc <= 1; ++dc)
+      {
+        acc(cur + c - step + dc);
+        acc(cur + c + step + dc);
+        for (const float *layer : {pre, nxt})
+        {
+          acc(layer + c - step + dc);
+          acc(layer + c + dc);
+          acc(layer + c + step + dc);
+        }
+      }
+      const __m128 is_max = _mm_and_ps(_mm_cmpgt_ps(v, thr_pos), _mm_cmpge_ps(v, vmax));
+      const __m128 is_min = _mm_and_ps(_mm_cmplt_ps(v, thr_neg), _mm_cmple_ps(v, vmin));
+      int mask            = _mm_movemask_ps(_mm_or_ps(is_max, is_min));
+      while (mask)
+      {
+        const int k = __builtin_ctz(mask);
+        mask &= mask - 1;
+        add_candidate(r, c + k);
+      }
+    }
+#endif
+    for (; c < cols - kImgBorder; ++c)
+    {
+      const float v = cur[c];
+      if (std::abs(v) <= threshold)
+      {
+        continue;
+      }
+      float vmax = -FLT_MAX, vmin = FLT_MAX;
+      for (int dr = -1; dr <= 1; ++dr)
+      {
+        for (int dc = -1; dc <= 1; ++dc)
+        {
+          const int o = dr * step + dc;
+          if (o != 0)
+          {
+            vmax = std::max(vmax, cur[c + o]);
+            vmin = std::min(vmin, cur[c + o]);
+          }
+          vmax = std::max(vmax, std::max(pre[c + o], nxt[c + o]));
+          vmin = std::min(vmin, std::min(pre[c + o], nxt[c + o]));
+        }
+      }
+      if ((v > 0 && v >= vmax) || (v < 0 && v <= vmin))
+      {
+        add_candidate(r, c);
+      }
+    }
+  }
+}
+
+bool SIFT::adjust_local_extrema(int octave_, int &layer_, int &r_, int &c_, cv::KeyPoint &kp_)
+{
+  const float deriv_scale        = kImgScale * 0.5f;
+  const float second_deriv_scale = kImgScale;
+  const float cross_deriv_scale  = kImgScale * 0.25f;
+
+  double xi = 0, xr = 0, xc = 0;
+  double dD[3] = {0, 0, 0};
+  double dxx = 0, dyy = 0, dxy = 0;
+  int i      = 0;
+  for (; i < kMaxInterpSteps; ++i)
+  {
+    const cv::Mat &img  = dog(octave_, layer_);
+    const cv::Mat &prev = dog(octave_, layer_ - 1);
+    const cv::Mat &next = dog(octave_, layer_ + 1);
+    auto I              = [&](int dr, int dc) { return img.at<float>(r_ + dr, c_ + dc); };
+    auto P              = [&](int dr, int dc) { return prev.at<float>(r_ + dr, c_ + dc); };
+    auto N              = [&](int dr, int dc) { return next.at<float>(r_ + dr, c_ + dc); };
+
+    dD[0] = (I(0, 1) - I(0, -1)) * deriv_scale;
+    dD[1] = (I(1, 0) - I(-1, 0)) * deriv_scale;
+    dD[2] = (N(0, 0) - P(0, 0)) * deriv_scale;
+
+    const float v2   = I(0, 0) * 2;
+    dxx              = (I(0, 1) + I(0, -1) - v2) * second_deriv_scale;
+    dyy              = (I(1, 0) + I(-1, 0) - v2) * second_deriv_scale;
+    const double dss = (N(0, 0) + P(0, 0) - v2) * second_deriv_scale;
+    dxy              = (I(1, 1) - I(1, -1) - I(-1, 1) + I(-1, -1)) * cross_deriv_scale;
+    const double dxs = (N(0, 1) - N(0, -1) - P(0, 1) + P(0, -1)) * cross_deriv_scale;
+    const double dys = (N(1, 0) - N(-1, 0) - P(1, 0) + P(-1, 0)) * cross_deriv_scale;
+
+    // X = -H^-1 * dD by cramer's rule
+    const double a = dxx, b = dxy, c = dxs, d = dyy, e = dys, f = dss;
+    const double det = a * (d * f - e * e) - b * (b * f - e * c) + c * (b * e - d * c);
+    if (det == 0)
+    {
+      return false;
+    }
+    const double inv = 1. / det;
+    xc               = -inv * (dD[0] * (d * f - e * e) - b * (dD[1] * f - e * dD[2]) + c * (dD[1] * e - d * dD[2]));
+    xr               = -inv * (a * (dD[1] * f - e * dD[2]) - dD[0] * (b * f - e * c) + c * (b * dD[2] - dD[1] * c));
+    xi               = -inv * (a * (d * dD[2] - dD[1] * e) - b * (b * dD[2] - dD[1] * c) + dD[0] * (b * e - d * c));
+
+    if (std::abs(xi) < 0.5 && std::abs(xr) < 0.5 && std::abs(xc) < 0.5)
+    {
+      break;
+    }
+    if (std::abs(xi) > INT_MAX / 3 || std::abs(xr) > INT_MAX / 3 || std::abs(xc) > INT_MAX / 3)
+    {
+      return false;
+    }
+
+    c_ += cvRound(xc);
+    r_ += cvRound(xr);
+    layer_ += cvRound(xi);
+    if (layer_ < 1 || layer_ > _n_octave_layers || c_ < kImgBorder || c_ >= img.cols - kImgBorder || r_ < kImgBorder || r_ >= img.rows - kImgBorder)
+    {
+      return false;
+    }
+  }
+  if (i >= kMaxInterpSteps)
+  {
+    return false;
+  }
+
+  const double t     = dD[0] * xc + dD[1] * xr + dD[2] * xi;
+  const double contr = dog(octave_, layer_).at<float>(r_, c_) * kImgScale + t * 0.5;
+  if (std::abs(contr) * _n_octave_layers < _contrast_threshold)
+  {
+    return false;
+  }
+
+  // principal curvature ratio, Lowe section 4.1
+  const double tr  = dxx + dyy;
+  const double det = dxx * dyy - dxy * dxy;
+  if (det <= 0 || tr * tr * _edge_threshold >= (_edge_threshold + 1) * (_edge_threshold + 1) * det)
+  {
+    return false;
+  }
+
+  // octave coordinates until detect_and_compute rescales
+  kp_.pt.x     = static_cast<float>(c_ + xc);
+  kp_.pt.y     = static_cast<float>(r_ + xr);
+  kp_.octave   = octave_ + (layer_ << 8) + (cvRound((xi + 0.5) * 255) << 16);
+  kp_.size     = static_cast<float>(_sigma * std::pow(2., (layer_ + xi) / _n_octave_layers) * 2);
+  kp_.response = static_cast<float>(std::abs(contr));
+  return true;
+}
+
+float SIFT::calc_orientation_hist(const cv::Mat &img_, cv::Point pt_, int radius_, float sigma_, float *hist_, int n_)
+{
+  const float expf_scale = -1.f / (2.f * sigma_ * sigma_);
+  std::vector<float> temp(n_ + 4, 0.f);
+  float *temphist = temp.data() + 2;
+
+  for (int i = -radius_; i <= radius_; ++i)
+  {
+    const int y = pt_.y + i;
+    if (y <= 0 || y >= img_.rows - 1)
+    {
+      continue;
+    }
+    const float *row = img_.ptr<float>(y);
+    const float *up  = img_.ptr<float>(y - 1);
+    const float *dn  = img_.ptr<float>(y + 1);
+    for (int j = -radius_; j <= radius_; ++j)
+    {
+      const int x = pt_.x + j;
+      if (x <= 0 || x >= img_.cols - 1)
+      {
+        continue;
+      }
+      const float dx  = row[x + 1] - row[x - 1];
+      const float dy  = up[x] - dn[x];
+      const float w   = std::exp((i * i + j * j) * expf_scale);
+      const float ori = static_cast<float>(std::atan2(dy, dx) * 180. / CV_PI);
+      const float mag = std::sqrt(dx * dx + dy * dy);
+      int bin         = cvRound((n_ / 360.f) * ori);
+      bin             = bin >= n_ ? bin - n_ : bin < 0 ? bin + n_ : bin;
+      temphist[bin] += w * mag;
+    }
+  }
+
+  // circular [1 4 6 4 1] / 16 smoothing
+  temphist[-1] = temphist[n_ - 1];
+  temphist[-2] = temphist[n_ - 2];
+  temphist[n_]     = temphist[0];
+  temphist[n_ + 1] = temphist[1];
+  float maxval     = 0.f;
+  for (int i = 0; i < n_; ++i)
+  {
+    hist_[i] = (temphist[i - 2] + temphist[i + 2]) * (1.f / 16.f) + (temphist[i - 1] + temphist[i + 1]) * (4.f / 16.f) + temphist[i] * (6.f / 16.f);
+    maxval   = std::max(maxval, hist_[i]);
+  }
+  return maxval;
+}
+
+void SIFT::calc_descriptor(const cv::KeyPoint &kp_, float *desc_)
+{
+  const int octave  = unpack_octave(kp_);
+  const int layer   = unpack_layer(kp_);
+  const cv::Mat &img = gauss(octave, layer);
+
+  const cv::Point pt(cvRound(kp_.pt.x), cvRound(kp_.pt.y));
+  float ori = 360.f - kp_.angle;
+  if (std::abs(ori - 360.f) < FLT_EPSILON)
+  {
+    ori = 0.f;
+  }
+  const float scl          = kp_.size * 0.5f;
+  const int d              = kDescrWidth;
+  const int n              = kDescrHistBins;
+  const float bins_per_deg = n / 360.f;
+  const float exp_scale    = -1.f / (d * d * 0.5f);
+  const float hist_width   = kDescrSclFactor * scl;
+  int radius               = cvRound(hist_width * 1.4142135623730951f * (d + 1) * 0.5f);
+  radius                   = std::min(radius, static_cast<int>(std::sqrt(static_cast<double>(img.cols) * img.cols + static_cast<double>(img.rows) * img.rows)));
+  const float cos_t        = std::cos(ori * static_cast<float>(CV_PI / 180)) / hist_width;
+  const float sin_t        = std::sin(ori * static_cast<float>(CV_PI / 180)) / hist_width;
+
+  // (d + 2) x (d + 2) x (n + 2) with a guard ring so interpolation never needs bounds checks
+  float hist[(kDescrWidth + 2) * (kDescrWidth + 2) * (kDescrHistBins + 2)] = {0};
+
+  for (int i = -radius; i <= radius; ++i)
+  {
+    const int r = pt.y + i;
+    if (r <= 0 || r >= img.rows - 1)
+    {
+      continue;
+    }
+    const float *row = img.ptr<float>(r);
+    const float *up  = img.ptr<float>(r - 1);
+    const float *dn  = img.ptr<float>(r + 1);
+    for (int j = -radius; j <= radius; ++j)
+    {
+      const int c = pt.x + j;
+      if (c <= 0 || c >= img.cols - 1)
+      {
+        continue;
+      }
+      const float c_rot = j * cos_t - i * sin_t;
+      const float r_rot = j * sin_t + i * cos_t;
+      float rbin        = r_rot + d / 2 - 0.5f;
+      float cbin        = c_rot + d / 2 - 0.5f;
+      if (rbin <= -1 || rbin >= d || cbin <= -1 || cbin >= d)
+      {
+        continue;
+      }
+
+      const float dx  = row[c + 1] - row[c - 1];
+      const float dy  = up[c] - dn[c];
+      const float w   = std::exp((c_rot * c_rot + r_rot * r_rot) * exp_scale);
+      const float ang = static_cast<float>(std::atan2(dy, dx) * 180. / CV_PI);
+      float obin      = (ang - ori) * bins_per_deg;
+      const float mag = std::sqrt(dx * dx + dy * dy) * w;
+
+      int r0 = cvFloor(rbin);
+      int c0 = cvFloor(cbin);
+      int o0 = cvFloor(obin);
+      rbin -= r0;
+      cbin -= c0;
+      obin -= o0;
+      o0 = ((o0 % n) + n) % n;
+
+      // trilinear split over the 8 neighbouring (row, col, orientation) bins
+      const float v_r1 = mag * rbin, v_r0 = mag - v_r1;
+      const float v_rc11 = v_r1 * cbin, v_rc10 = v_r1 - v_rc11;
+      const float v_rc01 = v_r0 * cbin, v_rc00 = v_r0 - v_rc01;
+      const float v_rco111 = v_rc11 * obin, v_rco110 = v_rc11 - v_rco111;
+      const float v_rco101 = v_rc10 * obin, v_rco100 = v_rc10 - v_rco101;
+      const float v_rco011 = v_rc01 * obin, v_rco010 = v_rc01 - v_rco011;
+      const float v_rco001 = v_rc00 * obin, v_rco000 = v_rc00 - v_rco001;
+
+      const int idx = ((r0 + 1) * (d + 2) + c0 + 1) * (n + 2) + o0;
+      hist[idx] += v_rco000;
+      hist[idx + 1] += v_rco001;
+      hist[idx + (n + 2)] += v_rco010;
+      hist[idx + (n + 3)] += v_rco011;
+      hist[idx + (d + 2) * (n + 2)] += v_rco100;
+      hist[idx + (d + 2) * (n + 2) + 1] += v_rco101;
+      hist[idx + (d + 3) * (n + 2)] += v_rco110;
+      hist[idx + (d + 3) * (n + 2) + 1] += v_rco111;
+    }
+  }
+
+  // fold the orientation guard bins back and drop the spatial guard ring
+  for (int i = 0; i < d; ++i)
+  {
+    for (int j = 0; j < d; ++j)
+    {
+      const int idx = ((i + 1) * (d + 2) + (j + 1)) * (n + 2);
+      hist[idx] += hist[idx + n];
+      hist[idx + 1] += hist[idx + n + 1];
+      for (int k = 0; k < n; ++k)
+      {
+        desc_[(i * d + j) * n + k] = hist[idx + k];
+      }
+    }
+  }
+
+  // normalise, clip large gradients against illumination changes, normalise again
+  float nrm2 = 0;
+  for (int k = 0; k < kDescrSize; ++k)
+  {
+    nrm2 += desc_[k] * desc_[k];
+  }
+  const float thr = std::sqrt(nrm2) * kDescrMagThr;
+  nrm2            = 0;
+  for (int k = 0; k < kDescrSize; ++k)
+  {
+    desc_[k] = std::min(desc_[k], thr);
+    nrm2 += desc_[k] * desc_[k];
+  }
+  const float scale = 1.f / std::max(std::sqrt(nrm2), FLT_EPSILON);
+  for (int k = 0; k < kDescrSize; ++k)
+  {
+    desc_[k] *= scale;
+  }
+}
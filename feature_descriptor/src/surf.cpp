@@ -0,0 +1,512 @@
+#include "feature_descriptor/surf.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace
+{
+constexpr int kBandRows      = 16;
+constexpr int kOriRadius     = 6;
+constexpr int kOriWin        = 60;
+constexpr int kOriSearchInc  = 5;
+constexpr float kOriSigma    = 2.5f;
+constexpr int kPatchSamples  = 20; // 20 x 20 samples of spacing s, grouped in 4 x 4 subregions
+constexpr int kSubSamples    = 5;
+constexpr float kDescSigma   = 3.3f;
+constexpr float kScaleFactor = 1.2f / 9.f; // 9 x 9 filter <=> sigma 1.2
+
+// box pattern: (x1, y1, x2, y2, weight) in a base window of the given size
+const int kDx[3][5]     = {{0, 2, 3, 7, 1}, {3, 2, 6, 7, -2}, {6, 2, 9, 7, 1}};
+const int kDy[3][5]     = {{2, 0, 7, 3, 1}, {2, 3, 7, 6, -2}, {2, 6, 7, 9, 1}};
+const int kDxy[4][5]    = {{1, 1, 4, 4, 1}, {5, 1, 8, 4, -1}, {1, 5, 4, 8, -1}, {5, 5, 8, 8, 1}};
+const int kHaarX[2][5]  = {{0, 0, 2, 4, -1}, {2, 0, 4, 4, 1}};
+const int kHaarY[2][5]  = {{0, 0, 4, 2, 1}, {0, 2, 4, 4, -1}};
+
+// corners of one box relative to the window origin in the integral image, weight divided by area
+struct HaarBox
+{
+  int p0, p1, p2, p3;
+  float w;
+};
+
+void resize_haar(const int src_[][5], HaarBox *dst_, int n_, int old_size_, int new_size_, int width_step_)
+{
+  const float ratio = static_cast<float>(new_size_) / old_size_;
+  for (int k = 0; k < n_; ++k)
+  {
+    const int x1 = cvRound(ratio * src_[k][0]);
+    const int y1 = cvRound(ratio * src_[k][1]);
+    const int x2 = cvRound(ratio * src_[k][2]);
+    const int y2 = cvRound(ratio * src_[k][3]);
+    dst_[k].p0   = y1 * width_step_ + x1;
+    dst_[k].p1   = y1 * width_step_ + x2;
+    dst_[k].p2   = y2 * width_step_ + x1;
+    dst_[k].p3   = y2 * width_step_ + x2;
+    dst_[k].w    = src_[k][4] / static_cast<float>((x2 - x1) * (y2 - y1));
+  }
+}
+
+inline float calc_haar(const uint32_t *origin_, const HaarBox *f_, int n_)
+{
+  float d = 0;
+  for (int k = 0; k < n_; ++k)
+  {
+    // wrap-around arithmetic: the difference is exact even if the corners overflowed
+    const uint32_t s = origin_[f_[k].p0] - origin_[f_[k].p1] - origin_[f_[k].p2] + origin_[f_[k].p3];
+    d += static_cast<int32_t>(s) * f_[k].w;
+  }
+  return d;
+}
+
+// 3 x 3 x 3 quadratic fit of the determinant around a maximum, updates position and size
+bool interpolate_keypoint(const float n9_[3][9], int dx_, int dy_, int ds_, cv::KeyPoint &kp_)
+{
+  const double b[3] = {-(n9_[1][5] - n9_[1][3]) / 2., -(n9_[1][7] - n9_[1][1]) / 2., -(n9_[2][4] - n9_[0][4]) / 2.};
+  const double a    = n9_[1][3] - 2 * n9_[1][4] + n9_[1][5];
+  const double bb   = (n9_[1][8] - n9_[1][6] - n9_[1][2] + n9_[1][0]) / 4.;
+  const double c    = (n9_[2][5] - n9_[2][3] - n9_[0][5] + n9_[0][3]) / 4.;
+  const double d    = n9_[1][1] - 2 * n9_[1][4] + n9_[1][7];
+  const double e    = (n9_[2][7] - n9_[2][1] - n9_[0][7] + n9_[0][1]) / 4.;
+  const double f    = n9_[0][4] - 2 * n9_[1][4] + n9_[2][4];
+
+  const double det = a * (d * f - e * e) - bb * (bb * f - e * c) + c * (bb * e - d * c);
+  if (det == 0)
+  {
+    return false;
+  }
+  const double x0 = (b[0] * (d * f - e * e) - bb * (b[1] * f - e * b[2]) + c * (b[1] * e - d * b[2])) / det;
+  const double x1 = (a * (b[1] * f - e * b[2]) - b[0] * (bb * f - e * c) + c * (bb * b[2] - b[1] * c)) / det;
+  const double x2 = (a * (d * b[2] - b[1] * e) - bb * (bb * b[2] - b[1] * c) + b[0] * (bb * e - d * c)) / det;
+
+  if ((x0 == 0 && x1 == 0 && x2 == 0) || std::abs(x0) > 1 || std::abs(x1) > 1 || std::abs(x2) > 1)
+  {
+    return false;
+  }
+  kp_.pt.x += static_cast<float>(x0 * dx_);
+  kp_.pt.y += static_cast<float>(x1 * dy_);
+  kp_.size = static_cast<float>(cvRound(kp_.size + x2 * ds_));
+  return true;
+}
+} // namespace
+
+SURF::SURF(double hessian_threshold_, int n_octaves_, int n_octave_layers_, bool extended_, bool upright_) :
+  _hessian_threshold(hessian_threshold_), _n_octaves(n_octaves_), _n_octave_layers(n_octave_layers_),
+  _extended(extended_), _upright(upright_)
+{
+  CV_Assert(n_octaves_ > 0 && n_octave_layers_ > 0);
+}
+SURF::~SURF()
+{}
+
+void SURF::detect_and_compute(const cv::Mat &img_, std::vector<cv::KeyPoint> &keypoints_, cv::Mat &descriptors_)
+{
+  CV_Assert(img_.type() == CV_8UC1);
+  keypoints_.clear();
+
+  build_integral(img_);
+  calc_responses();
+  find_maxima(keypoints_);
+
+  const int n         = static_cast<int>(keypoints_.size());
+  const int desc_size = _extended ? 128 : 64;
+  descriptors_.create(n, desc_size, CV_32F);
+  cv::parallel_for_(cv::Range(0, n), [&](const cv::Range &range) {
+    for (int i = range.start; i < range.end; ++i)
+    {
+      if (!_upright)
+      {
+        calc_orientation(keypoints_[i]);
+      }
+      calc_descriptor(keypoints_[i], descriptors_.ptr<float>(i));
+    }
+  });
+}
+
+void SURF::build_integral(const cv::Mat &img_)
+{
+  _sum.create(img_.rows + 1, img_.cols + 1, CV_32SC1);
+  uint32_t *prev = reinterpret_cast<uint32_t *>(_sum.ptr<int>(0));
+  std::fill(prev, prev + _sum.cols, 0u);
+  for (int r = 0; r < img_.rows; ++r)
+  {
+    const uchar *src = img_.ptr<uchar>(r);
+    uint32_t *cur    = reinterpret_cast<uint32_t *>(_sum.ptr<int>(r + 1));
+    uint32_t row_sum = 0;
+    cur[0]           = 0;
+    for (int c = 0; c < img_.cols; ++c)
+    {
+      row_sum += src[c];
+      cur[c + 1] = prev[c + 1] + row_sum;
+    }
+    prev = cur;
+  }
+}
+
+void SURF::calc_responses()
+{
+  const int n_layers = _n_octave_layers + 2;
+  const int img_rows = _sum.rows - 1;
+  const int img_cols = _sum.cols - 1;
+  const int ws       = static_cast<int>(_sum.step / sizeof(uint32_t));
+  _dets.resize(static_cast<size_t>(_n_octaves) * n_layers);
+  _traces.resize(_dets.size());
+
+  // one task per band of sample rows of every (octave, layer), all read the same integral image
+  struct Task
+  {
+    int map, row_begin, row_end;
+  };
+  std::vector<Task> tasks;
+  for (int o = 0; o < _n_octaves; ++o)
+  {
+    const int step = 1 << o;
+    for (int l = 0; l < n_layers; ++l)
+    {
+      const int m = o * n_layers + l;
+      _dets[m]    = cv::Mat::zeros(img_rows / step, img_cols / step, CV_32F);
+      _traces[m]  = cv::Mat::zeros(img_rows / step, img_cols / step, CV_32F);
+      const int size = layer_size(o, l);
+      if (size > img_rows - 1 || size > img_cols - 1)
+      {
+        continue;
+      }
+      const int samples_i = 1 + (img_rows - 1 - size) / step;
+      for (int i = 0; i < samples_i; i += kBandRows)
+      {
+        tasks.push_back({m, i, std::min(i + kBandRows, samples_i)});
+      }
+    }
+  }
+
+  cv::parallel_for_(cv::Range(0, static_cast<int>(tasks.size())), [&](const cv::Range &range) {
+    HaarBox dx[3], dy[3], dxy[4];
+    int resized_for = -1;
+    for (int t = range.start; t < range.end; ++t)
+    {
+      const int m    = tasks[t].map;
+      const int o    = m / n_layers;
+      const int size = layer_size(o, m % n_layers);
+      const int step = 1 << o;
+      if (resized_for != size)
+      {
+        resize_haar(kDx, dx, 3, 9, size, ws);
+        resize_haar(kDy, dy, 3, 9, size, ws);
+        resize_haar(kDxy, dxy, 4, 9, size, ws);
+        resized_for = size;
+      }
+      const int samples_j = 1 + (img_cols - 1 - size) / step;
+      const int margin    = (size / 2) / step;
+      const uint32_t *sum = reinterpret_cast<const uint32_t *>(_sum.ptr<int>(0));
+
+      for (int i = tasks[t].row_begin; i < tasks[t].row_end; ++i)
+      {
+        const uint32_t *origin = sum + static_cast<size_t>(i) * step * ws;
+        float *det             = _dets[m].ptr<float>(i + margin) + margin;
+        float *trace           = _traces[m].ptr<float>(i + margin) + margin;
+        for (int j = 0; j < samples_j; ++j, origin += step)
+        {
+          const float vx  = calc_haar(origin, dx, 3);
+          const float vy  = calc_haar(origin, dy, 3);
+          const float vxy = calc_haar(origin, dxy, 4);
+          det[j]          = vx * vy - 0.81f * vxy * vxy;
+          trace[j]        = vx + vy;
+        }
+      }
+    }
+  });
+}
+
+void SURF::find_maxima(std::vector<cv::KeyPoint> &keypoints_)
+{
+  const int n_layers = _n_octave_layers + 2;
+  const int img_rows = _sum.rows - 1;
+  const int img_cols = _sum.cols - 1;
+
+  struct Task
+  {
+    int octave, layer, row_begin, row_end;
+  };
+  std::vector<Task> tasks;
+  for (int o = 0; o < _n_octaves; ++o)
+  {
+    for (int l = 1; l <= _n_octave_layers; ++l)
+    {
+      // the largest filter of the neighbourhood must fit in the image
+      if (layer_size(o, l + 1) > std::min(img_rows, img_cols) - 1)
+      {
+        continue;
+      }
+      const int step   = 1 << o;
+      const int margin = (layer_size(o, l + 1) / 2) / step + 1;
+      const int rows   = _dets[o * n_layers + l].rows;
+      for (int i = margin; i < rows - margin; i += kBandRows)
+      {
+        tasks.push_back({o, l, i, std::min(i + kBandRows, rows - margin)});
+      }
+    }
+  }
+
+  std::vector<std::vector<cv::KeyPoint>> found(tasks.size());
+  cv::parallel_for_(cv::Range(0, static_cast<int>(tasks.size())), [&](const cv::Range &range) {
+    for (int t = range.start; t < range.end; ++t)
+    {
+      const int o       = tasks[t].octave;
+      const int l       = tasks[t].layer;
+      const int step    = 1 << o;
+      const int size    = layer_size(o, l);
+      const cv::Mat &d0 = _dets[o * n_layers + l - 1];
+      const cv::Mat &d1 = _dets[o * n_layers + l];
+      const cv::Mat &d2 = _dets[o * n_layers + l + 1];
+      const cv::Mat &tr = _traces[o * n_layers + l];
+      const int margin  = (layer_size(o, l + 1) / 2) / step + 1;
+
+      for (int i = tasks[t].row_begin; i < tasks[t].row_end; ++i)
+      {
+        const float *row = d1.ptr<float>(i);
+        for (int j = margin; j < d1.cols - margin; ++j)
+        {
+          const float val0 = row[j];
+          if (val0 <= _hessian_threshold)
+          {
+            continue;
+          }
+
+          float n9[3][9];
+          bool is_max = true;
+          const cv::Mat *layers[3] = {&d0, &d1, &d2};
+          for (int s = 0; s < 3 && is_max; ++s)
+          {
+            for (int di = -1; di <= 1; ++di)
+            {
+              const float *p = layers[s]->ptr<float>(i + di) + j;
+              for (int dj = -1; dj <= 1; ++dj)
+              {
+                n9[s][(di + 1) * 3 + dj + 1] = p[dj];
+              }
+            }
+            for (int k = 0; k < 9; ++k)
+            {
+              if ((s != 1 || k != 4) && n9[s][k] >= val0)
+              {
+                is_max = false;
+                break;
+              }
+            }
+          }
+          if (!is_max)
+          {
+            continue;
+          }
+
+          // top-left corner of the filter window in image coordinates
+          const int sum_i  = step * (i - (size / 2) / step);
+          const int sum_j  = step * (j - (size / 2) / step);
+          const float trv  = tr.at<float>(i, j);
+          cv::KeyPoint kp(sum_j + (size - 1) * 0.5f, sum_i + (size - 1) * 0.5f, static_cast<float>(size), -1, val0, o,
+                          (trv > 0) - (trv < 0));
+          if (interpolate_keypoint(n9, step, step, size - layer_size(o, l - 1), kp))
+          {
+            found[t].push_back(kp);
+          }
+        }
+      }
+    }
+  });
+
+  for (const auto &f : found)
+  {
+    keypoints_.insert(keypoints_.end(), f.begin(), f.end());
+  }
+}
+
+void SURF::calc_orientation(cv::KeyPoint &kp_)
+{
+  // sample offsets of the circular neighbourhood and their gaussian weights, shared by all keypoints
+  static const std::vector<cv::Point> apt = [] {
+    std::vector<cv::Point> pts;
+    for (int i = -kOriRadius; i <= kOriRadius; ++i)
+    {
+      for (int j = -kOriRadius; j <= kOriRadius; ++j)
+      {
+        if (i * i + j * j <= kOriRadius * kOriRadius)
+        {
+          pts.emplace_back(j, i);
+        }
+      }
+    }
+    return pts;
+  }();
+
+  const int ws            = static_cast<int>(_sum.step / sizeof(uint32_t));
+  const uint32_t *sum     = reinterpret_cast<const uint32_t *>(_sum.ptr<int>(0));
+  const float s           = kp_.size * kScaleFactor;
+  const int grad_wav_size = 2 * cvRound(2 * s);
+  kp_.angle               = 0.f;
+  if (_sum.rows - 1 < grad_wav_size || _sum.cols - 1 < grad_wav_size)
+  {
+    return;
+  }
+
+  HaarBox hx[2], hy[2];
+  resize_haar(kHaarX, hx, 2, 4, grad_wav_size, ws);
+  resize_haar(kHaarY, hy, 2, 4, grad_wav_size, ws);
+
+  const size_t n_max = apt.size();
+  std::vector<float> X(n_max), Y(n_max), angle(n_max);
+  int n = 0;
+  for (const auto &p : apt)
+  {
+    const int x = cvRound(kp_.pt.x + p.x * s - (grad_wav_size - 1) * 0.5f);
+    const int y = cvRound(kp_.pt.y + p.y * s - (grad_wav_size - 1) * 0.5f);
+    if (y < 0 || y >= _sum.rows - grad_wav_size || x < 0 || x >= _sum.cols - grad_wav_size)
+    {
+      continue;
+    }
+    const float w     = std::exp(-(p.x * p.x + p.y * p.y) / (2 * kOriSigma * kOriSigma));
+    const uint32_t *o = sum + static_cast<size_t>(y) * ws + x;
+    X[n]              = calc_haar(o, hx, 2) * w;
+    Y[n]              = calc_haar(o, hy, 2) * w;
+    float a           = static_cast<float>(std::atan2(Y[n], X[n]) * 180. / CV_PI);
+    angle[n]          = a < 0 ? a + 360.f : a;
+    ++n;
+  }
+
+  // sliding 60 degree window, the longest summed response gives the orientation
+  float best = 0, bestx = 0, besty = 0;
+  for (int i = 0; i < 360; i += kOriSearchInc)
+  {
+    float sumx = 0, sumy = 0;
+    for (int j = 0; j < n; ++j)
+    {
+      const int d = std::abs(cvRound(angle[j]) - i);
+      if (d < kOriWin / 2 || d > 360 - kOriWin / 2)
+      {
+        sumx += X[j];
+        sumy += Y[j];
+      }
+    }
+    const float temp = sumx * sumx + sumy * sumy;
+    if (temp > best)
+    {
+      best  = temp;
+      bestx = sumx;
+      besty = sumy;
+    }
+  }
+  const float a = static_cast<float>(std::atan2(besty, bestx) * 180. / CV_PI);
+  kp_.angle     = a < 0 ? a + 360.f : a;
+}
+
+void SURF::calc_descriptor(const cv::KeyPoint &kp_, float *desc_)
+{
+  constexpr int n_samples = kPatchSamples * kPatchSamples;
+  // gaussian weight of each sample, in units of the keypoint scale
+  static const std::vector<float> weights = [] {
+    std::vector<float> w(n_samples);
+    for (int k = 0; k < kPatchSamples; ++k)
+    {
+      for (int l = 0; l < kPatchSamples; ++l)
+      {
+        const float u            = l - (kPatchSamples - 1) * 0.5f;
+        const float v            = k - (kPatchSamples - 1) * 0.5f;
+        w[k * kPatchSamples + l] = std::exp(-(u * u + v * v) / (2 * kDescSigma * kDescSigma));
+      }
+    }
+    return w;
+  }();
+
+  const int ws        = static_cast<int>(_sum.step / sizeof(uint32_t));
+  const uint32_t *sum = reinterpret_cast<const uint32_t *>(_sum.ptr<int>(0));
+  const float s       = kp_.size * kScaleFactor;
+  const int haar_size = std::max(2, 2 * cvRound(s));
+  const float rad     = _upright ? 0.f : kp_.angle * static_cast<float>(CV_PI / 180);
+  const float cos_t   = std::cos(rad);
+  const float sin_t   = std::sin(rad);
+
+  HaarBox hx[2], hy[2];
+  resize_haar(kHaarX, hx, 2, 4, haar_size, ws);
+  resize_haar(kHaarY, hy, 2, 4, haar_size, ws);
+
+  // batched pass: all sample responses of the 20 x 20 rotated grid, then the subregion sums
+  float rx[n_samples], ry[n_samples];
+  for (int k = 0; k < kPatchSamples; ++k)
+  {
+    const float v = (k - (kPatchSamples - 1) * 0.5f) * s;
+    for (int l = 0; l < kPatchSamples; ++l)
+    {
+      const float u  = (l - (kPatchSamples - 1) * 0.5f) * s;
+      const float px = kp_.pt.x + u * cos_t - v * sin_t;
+      const float py = kp_.pt.y + u * sin_t + v * cos_t;
+      const int x    = cvRound(px - haar_size * 0.5f);
+      const int y    = cvRound(py - haar_size * 0.5f);
+      const int idx  = k * kPatchSamples + l;
+      if (y < 0 || y >= _sum.rows - haar_size || x < 0 || x >= _sum.cols - haar_size)
+      {
+        rx[idx] = ry[idx] = 0.f;
+        continue;
+      }
+      const uint32_t *o = sum + static_cast<size_t>(y) * ws + x;
+      const float dx    = calc_haar(o, hx, 2) * weights[idx];
+      const float dy    = calc_haar(o, hy, 2) * weights[idx];
+      // responses in the keypoint frame
+      rx[idx] = dx * cos_t + dy * sin_t;
+      ry[idx] = -dx * sin_t + dy * cos_t;
+    }
+  }
+
+  const int per_region = _extended ? 8 : 4;
+  const int n_regions  = kPatchSamples / kSubSamples;
+  std::fill(desc_, desc_ + n_regions * n_regions * per_region, 0.f);
+  for (int k = 0; k < kPatchSamples; ++k)
+  {
+    for (int l = 0; l < kPatchSamples; ++l)
+    {
+      const int idx = k * kPatchSamples + l;
+      float *v      = desc_ + ((k / kSubSamples) * n_regions + l / kSubSamples) * per_region;
+      const float x = rx[idx], y = ry[idx];
+      if (!_extended)
+      {
+        v[0] += x;
+        v[1] += y;
+        v[2] += std::abs(x);
+        v[3] += std::abs(y);
+      }
+      else
+      {
+        // split by the sign of the other component
+        if (y >= 0)
+        {
+          v[0] += x;
+          v[1] += std::abs(x);
+        }
+        else
+        {
+          v[2] += x;
+          v[3] += std::abs(x);
+        }
+        if (x >= 0)
+        {
+          v[4] += y;
+          v[5] += std::abs(y);
+        }
+        else
+        {
+          v[6] += y;
+          v[7] += std::abs(y);
+        }
+      }
+    }
+  }
+
+  const int desc_size = n_regions * n_regions * per_region;
+  float nrm2          = 0;
+  for (int k = 0; k < desc_size; ++k)
+  {
+    nrm2 += desc_[k] * desc_[k];
+  }
+  const float scale = 1.f / std::max(std::sqrt(nrm2), FLT_EPSILON);
+  for (int k = 0; k < desc_size; ++k)
+  {
+    desc_[k] *= scale;
+  }
+}
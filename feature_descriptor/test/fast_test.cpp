@@ -3,12 +3,32 @@
 
 #include "feature_descriptor/fast.h"
 
-TEST(Test, test1)
+TEST(FastTest, test1)
 {
+  // bright square on dark background: corners only at the four square corners
+  cv::Mat img = cv::Mat::zeros(64, 64, CV_8UC1);
+  img(cv::Rect(20, 20, 24, 24)).setTo(cv::Scalar(200));
+
+  Fast fast(20, true);
+  std::vector<cv::KeyPoint> keypoints;
+  fast.detect(img, keypoints);
+
+  std::cout << "keypoint size:" << keypoints.size() << std::endl;
+  ASSERT_FALSE(keypoints.empty());
+  for (const auto &kp : keypoints)
+  {
+    EXPECT_GT(kp.response, 20.f);
+    bool near_corner = false;
+    for (const auto &c : {cv::Point2f(20, 20), cv::Point2f(43, 20), cv::Point2f(20, 43), cv::Point2f(43, 43)})
+    {
+      near_corner |= std::abs(kp.pt.x - c.x) <= 2 && std::abs(kp.pt.y - c.y) <= 2;
+    }
+    EXPECT_TRUE(near_corner);
+  }
 }
 
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
@@ -0,0 +1,123 @@
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+
+#include "feature_descriptor/feature_store.h"
+#include "feature_descriptor/harris.h"
+
+TEST(FeatureStoreTest, test1)
+{
+  std::string path = "../../assets/";
+
+  cv::Mat img = cv::imread(path + "1.pgm", cv::IMREAD_GRAYSCALE);
+  if (img.empty())
+  {
+    printf("读取图像文件失败");
+    return;
+  }
+
+  Harris harris;
+  int n_detect                  = 0;
+  FeatureCache::Detector detect = [&](const cv::Mat &img_, std::vector<cv::KeyPoint> &keypoints_, cv::Mat &descriptors_) {
+    ++n_detect;
+    std::vector<cv::Point> corners;
+    harris.detect(img_, corners);
+    keypoints_.clear();
+    for (const auto &c : corners)
+    {
+      keypoints_.emplace_back(cv::Point2f(c.x, c.y), 7.f);
+    }
+    harris.score_points(img_, keypoints_);
+    // one row per keypoint so the descriptor section is exercised too
+    descriptors_.create(static_cast<int>(keypoints_.size()), 2, CV_32F);
+    for (int i = 0; i < descriptors_.rows; ++i)
+    {
+      descriptors_.at<float>(i, 0) = keypoints_[i].pt.x;
+      descriptors_.at<float>(i, 1) = keypoints_[i].response;
+    }
+  };
+
+  FeatureCache cache("feature_store_test.cache");
+  const uint64_t key = FeatureCache::key(img, harris.signature());
+  std::remove(("feature_store_test.cache/" + cv::format("%016llx.feat", static_cast<unsigned long long>(key))).c_str());
+
+  FeatureStore first = cache.get(img, harris.signature(), detect);
+  FeatureStore again = cache.get(img, harris.signature(), detect);
+  EXPECT_EQ(n_detect, 1);
+  EXPECT_EQ(cache.misses(), 1u);
+  EXPECT_EQ(cache.hits(), 1u);
+  std::cout << "keypoint size:" << again.size() << std::endl;
+
+  ASSERT_FALSE(first.size() == 0);
+  ASSERT_EQ(again.size(), first.size());
+  EXPECT_EQ(again.key(), key);
+  ASSERT_EQ(again.descriptors().rows, static_cast<int>(again.size()));
+  for (size_t i = 0; i < again.size(); ++i)
+  {
+    EXPECT_EQ(again.keypoints()[i].pt.x, first.keypoints()[i].pt.x);
+    EXPECT_EQ(again.keypoints()[i].response, first.keypoints()[i].response);
+    EXPECT_EQ(again.descriptors().at<float>(static_cast<int>(i), 1), again.keypoints()[i].response);
+  }
+
+  // any changed pixel or parameter is a different entry
+  cv::Mat changed = img.clone();
+  changed.at<uchar>(0, 0) ^= 1;
+  EXPECT_NE(FeatureCache::key(changed, harris.signature()), key);
+  EXPECT_NE(FeatureCache::key(img, harris.signature() + "x"), key);
+  EXPECT_EQ(FeatureCache::key(img(cv::Rect(0, 0, 100, 100)), "p"), FeatureCache::key(img(cv::Rect(0, 0, 100, 100)).clone(), "p"));
+}
+
+TEST(FeatureStoreTest, damaged)
+{
+  std::vector<cv::KeyPoint> keypoints;
+  for (int i = 0; i < 10; ++i)
+  {
+    keypoints.emplace_back(cv::Point2f(i, 2.f * i), 7.f);
+  }
+  cv::Mat descriptors(10, 32, CV_8U, cv::Scalar(5));
+  const std::string path = "feature_store_test_damaged.feat";
+  FeatureStore::write(path, 42, keypoints, descriptors);
+
+  std::vector<char> bytes;
+  {
+    std::ifstream in(path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  auto open_modified = [&](const std::function<void(std::vector<char> &)> &modify_) {
+    std::vector<char> copy = bytes;
+    modify_(copy);
+    std::ofstream(path, std::ios::binary).write(copy.data(), copy.size());
+    FeatureStore store;
+    return store.open(path);
+  };
+  // header: 8 byte magic, 2 uint32, key, n_keypoints, 4 int32 (desc_rows, desc_cols, desc_type, reserved),
+  // desc_step, keypoints, descriptors, total
+  auto u64 = [](std::vector<char> &b_, size_t offset_) { return reinterpret_cast<uint64_t *>(b_.data() + offset_); };
+  auto i32 = [](std::vector<char> &b_, size_t offset_) { return reinterpret_cast<int32_t *>(b_.data() + offset_); };
+  EXPECT_TRUE(open_modified([](std::vector<char> &) {}));
+  // a keypoint count whose section size wraps past 2^64 back to a small end offset
+  EXPECT_FALSE(open_modified([&](std::vector<char> &b_) {
+    *u64(b_, 24) = (UINT64_MAX / sizeof(cv::KeyPoint)) + 2;
+    *i32(b_, 32) = 0;
+  }));
+  // a descriptor step that wraps the same way
+  EXPECT_FALSE(open_modified([&](std::vector<char> &b_) { *u64(b_, 48) = UINT64_MAX / 10 + 1; }));
+  // rows shorter than desc_cols elements
+  EXPECT_FALSE(open_modified([&](std::vector<char> &b_) { *i32(b_, 40) = CV_32F; }));
+  EXPECT_FALSE(open_modified([&](std::vector<char> &b_) { *i32(b_, 36) = 33; }));
+  // types that are no cv::Mat type
+  EXPECT_FALSE(open_modified([&](std::vector<char> &b_) { *i32(b_, 40) = -1; }));
+  EXPECT_FALSE(open_modified([&](std::vector<char> &b_) { *i32(b_, 40) = CV_MAT_TYPE_MASK + 1; }));
+  std::remove(path.c_str());
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,73 @@
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+
+#include "feature_descriptor/hamming_matcher.h"
+
+TEST(HammingMatcherTest, test1)
+{
+  std::mt19937 rng(1);
+  BinaryDescriptors train(1003), query(50);
+  for (size_t i = 0; i < train.rows() * BinaryDescriptors::kBytes; ++i)
+  {
+    train.data()[i] = static_cast<uint8_t>(rng());
+  }
+  // every query is a train row with two bits flipped
+  for (size_t i = 0; i < query.rows(); ++i)
+  {
+    std::memcpy(query.row(i), train.row(i * 17), BinaryDescriptors::kBytes);
+    query.row(i)[3] ^= 0x5;
+  }
+
+  std::vector<int> dist(train.rows());
+  for (size_t i = 0; i < query.rows(); ++i)
+  {
+    hamming_distances(query.row(i), train.row(0), static_cast<int>(train.rows()), dist.data());
+    for (size_t j = 0; j < train.rows(); ++j)
+    {
+      ASSERT_EQ(dist[j], hamming_distance(query.row(i), train.row(j)));
+    }
+  }
+
+  // every kernel this cpu can run agrees with the scalar one
+  std::vector<int> ref(train.rows());
+  hamming_distances(query.row(0), train.row(0), static_cast<int>(train.rows()), ref.data(), feature_descriptor::CpuLevel::baseline);
+  using feature_descriptor::CpuLevel;
+  for (CpuLevel level : {CpuLevel::sse42, CpuLevel::avx2, CpuLevel::avx512})
+  {
+    if (level > feature_descriptor::cpu_supported_level())
+    {
+      break;
+    }
+    std::fill(dist.begin(), dist.end(), -1);
+    hamming_distances(query.row(0), train.row(0), static_cast<int>(train.rows()), dist.data(), level);
+    ASSERT_EQ(dist, ref) << feature_descriptor::cpu_level_name(level);
+  }
+
+  HammingMatcher matcher(0.8f, true);
+  std::vector<cv::DMatch> matches;
+  matcher.match(query, train, matches);
+  ASSERT_EQ(matches.size(), query.rows());
+  for (const auto &m : matches)
+  {
+    EXPECT_EQ(m.trainIdx, m.queryIdx * 17);
+    EXPECT_EQ(m.distance, 2.f);
+  }
+
+  std::vector<std::vector<cv::DMatch>> knn;
+  matcher.knn_match(query, train, 3, knn);
+  for (const auto &m : knn)
+  {
+    ASSERT_EQ(m.size(), 3u);
+    EXPECT_LE(m[0].distance, m[1].distance);
+    EXPECT_LE(m[1].distance, m[2].distance);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
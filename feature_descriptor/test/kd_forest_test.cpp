@@ -0,0 +1,118 @@
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <random>
+
+#include "feature_descriptor/kd_forest.h"
+
+TEST(KdForestTest, test1)
+{
+  std::mt19937 rng(3);
+  std::normal_distribution<float> gauss(0.f, 1.f);
+  cv::Mat train(20000, 64, CV_32F), query(200, 64, CV_32F);
+  for (int i = 0; i < train.rows; ++i)
+  {
+    for (int d = 0; d < train.cols; ++d)
+    {
+      train.at<float>(i, d) = gauss(rng);
+    }
+  }
+  // noisy copies of train rows
+  for (int i = 0; i < query.rows; ++i)
+  {
+    for (int d = 0; d < query.cols; ++d)
+    {
+      query.at<float>(i, d) = train.at<float>(i * 97, d) + 0.05f * gauss(rng);
+    }
+  }
+
+  KdForest index(4, 16);
+  index.build(train);
+  EXPECT_EQ(index.size(), static_cast<size_t>(train.rows));
+  EXPECT_EQ(index.dims(), train.cols);
+
+  std::vector<std::vector<cv::DMatch>> knn;
+  index.knn_match(query, 2, knn, 128);
+  ASSERT_EQ(knn.size(), static_cast<size_t>(query.rows));
+  int found = 0;
+  for (const auto &m : knn)
+  {
+    found += !m.empty() && m[0].trainIdx == m[0].queryIdx * 97;
+    if (m.size() == 2)
+    {
+      EXPECT_LE(m[0].distance, m[1].distance);
+    }
+  }
+  std::cout << "recall:" << found / double(query.rows) << std::endl;
+  EXPECT_GE(found, static_cast<int>(query.rows * 0.95));
+
+  // the mapped index answers exactly like the built one
+  const std::string path = "kd_forest_test.idx";
+  index.save(path);
+  KdForest mapped;
+  ASSERT_TRUE(mapped.load(path));
+  EXPECT_EQ(mapped.size(), index.size());
+  std::vector<std::vector<cv::DMatch>> knn_mapped;
+  mapped.knn_match(query, 2, knn_mapped, 128);
+  ASSERT_EQ(knn_mapped.size(), knn.size());
+  for (size_t i = 0; i < knn.size(); ++i)
+  {
+    ASSERT_EQ(knn_mapped[i].size(), knn[i].size());
+    for (size_t j = 0; j < knn[i].size(); ++j)
+    {
+      EXPECT_EQ(knn_mapped[i][j].trainIdx, knn[i][j].trainIdx);
+      EXPECT_FLOAT_EQ(knn_mapped[i][j].distance, knn[i][j].distance);
+    }
+  }
+
+  // a damaged file is refused instead of read out of bounds
+  std::vector<char> bytes;
+  {
+    std::ifstream in(path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  auto load_modified = [&](const std::function<void(std::vector<char> &)> &modify_) {
+    std::vector<char> copy = bytes;
+    modify_(copy);
+    std::ofstream(path, std::ios::binary).write(copy.data(), copy.size());
+    KdForest damaged;
+    return damaged.load(path);
+  };
+  // header: 8 byte magic, 6 uint32, then n_rows, n_nodes, roots, split_dim, split_val, left, ...
+  auto field = [](std::vector<char> &b_, int index_) { return reinterpret_cast<uint64_t *>(b_.data() + 32) + index_; };
+  EXPECT_TRUE(load_modified([](std::vector<char> &) {}));
+  EXPECT_FALSE(load_modified([](std::vector<char> &b_) { b_.resize(b_.size() / 2); }));
+  EXPECT_FALSE(load_modified([&](std::vector<char> &b_) { *field(b_, 1) *= 4; }));
+  EXPECT_FALSE(load_modified([&](std::vector<char> &b_) {
+    // left child of the first root far out of range
+    int32_t *left = reinterpret_cast<int32_t *>(b_.data() + *field(b_, 5));
+    left[0]       = 1 << 30;
+  }));
+  EXPECT_FALSE(load_modified([&](std::vector<char> &b_) {
+    // left child of the first root pointing back at itself
+    int32_t *left = reinterpret_cast<int32_t *>(b_.data() + *field(b_, 5));
+    left[0]       = 0;
+  }));
+  EXPECT_FALSE(load_modified([&](std::vector<char> &b_) {
+    // leaves larger than the leaf size in the header
+    *reinterpret_cast<uint32_t *>(b_.data() + 24) = 1;
+  }));
+  EXPECT_FALSE(load_modified([&](std::vector<char> &b_) {
+    // an id past the last row
+    uint32_t *ids = reinterpret_cast<uint32_t *>(b_.data() + *field(b_, 7));
+    ids[3]        = static_cast<uint32_t>(*field(b_, 0));
+  }));
+
+  std::remove(path.c_str());
+  EXPECT_FALSE(mapped.load(path));
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,57 @@
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+
+#include "feature_descriptor/klt_tracker.h"
+
+TEST(KltTrackerTest, test1)
+{
+  std::string path = "../../assets/";
+
+  cv::Mat img = cv::imread(path + "1.pgm", cv::IMREAD_GRAYSCALE);
+  if (img.empty())
+  {
+    printf("读取图像文件失败");
+    return;
+  }
+
+  // the second frame is the scene moved by (-3, -2) pixels
+  const cv::Size size(img.cols - 16, img.rows - 16);
+  cv::Mat frame0 = img(cv::Rect(cv::Point(0, 0), size)).clone();
+  cv::Mat frame1 = img(cv::Rect(cv::Point(3, 2), size)).clone();
+
+  KltTracker tracker;
+  std::vector<cv::KeyPoint> features0, features1;
+  tracker.process(frame0, features0);
+  tracker.process(frame1, features1);
+  std::cout << "feature size:" << features0.size() << " -> " << features1.size() << std::endl;
+  ASSERT_FALSE(features0.empty());
+
+  std::map<int, cv::Point2f> start;
+  for (const auto &f : features0)
+  {
+    start[f.class_id] = f.pt;
+  }
+  int tracked = 0, accurate = 0;
+  for (const auto &f : features1)
+  {
+    auto it = start.find(f.class_id);
+    if (it == start.end())
+    {
+      continue;
+    }
+    ++tracked;
+    accurate += std::abs(f.pt.x - it->second.x + 3) < 0.2f && std::abs(f.pt.y - it->second.y + 2) < 0.2f;
+  }
+  std::cout << "tracked:" << tracked << " accurate:" << accurate << std::endl;
+  EXPECT_GE(tracked, static_cast<int>(features0.size() * 0.8));
+  EXPECT_GE(accurate, static_cast<int>(tracked * 0.9));
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
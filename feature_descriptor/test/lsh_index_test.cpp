@@ -0,0 +1,48 @@
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+
+#include "feature_descriptor/lsh_index.h"
+
+TEST(LshIndexTest, test1)
+{
+  std::mt19937 rng(2);
+  BinaryDescriptors train(20000), query(200);
+  for (size_t i = 0; i < train.rows() * BinaryDescriptors::kBytes; ++i)
+  {
+    train.data()[i] = static_cast<uint8_t>(rng());
+  }
+  // near duplicates of train rows, a few random bits flipped
+  for (size_t i = 0; i < query.rows(); ++i)
+  {
+    std::memcpy(query.row(i), train.row(i * 97), BinaryDescriptors::kBytes);
+    for (int f = 0; f < 8; ++f)
+    {
+      int bit = rng() % (BinaryDescriptors::kBytes * 8);
+      query.row(i)[bit >> 3] ^= 1 << (bit & 7);
+    }
+  }
+
+  LshIndex index(8, 16, 1);
+  index.build(train);
+  EXPECT_EQ(index.size(), train.rows());
+
+  std::vector<std::vector<cv::DMatch>> knn;
+  index.knn_match(query, 2, knn);
+  ASSERT_EQ(knn.size(), query.rows());
+  int found = 0;
+  for (const auto &m : knn)
+  {
+    found += !m.empty() && m[0].trainIdx == m[0].queryIdx * 97;
+  }
+  std::cout << "recall:" << found / double(query.rows()) << std::endl;
+  EXPECT_GE(found, static_cast<int>(query.rows() * 0.95));
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
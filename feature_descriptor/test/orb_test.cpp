@@ -1,12 +1,47 @@
 
 #include <gtest/gtest.h>
 
-TEST(Test, test1)
+#include <cstring>
+#include <string>
+
+#include "feature_descriptor/orb.h"
+
+TEST(OrbTest, test1)
 {
+  std::string path = "../../assets/";
+
+  cv::Mat img = cv::imread(path + "1.pgm", cv::IMREAD_GRAYSCALE);
+  if (img.empty())
+  {
+    printf("读取图像文件失败");
+    return;
+  }
+
+  ORB orb(500);
+  std::vector<cv::KeyPoint> keypoints;
+  BinaryDescriptors descriptors;
+  orb.detect_and_compute(img, keypoints, descriptors);
+  std::cout << "keypoint size:" << keypoints.size() << std::endl;
+
+  ASSERT_FALSE(keypoints.empty());
+  EXPECT_LE(keypoints.size(), 500u);
+  ASSERT_EQ(descriptors.rows(), keypoints.size());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(descriptors.data()) % BinaryDescriptors::kAlignment, 0u);
+
+  cv::Mat mat = descriptors.mat();
+  EXPECT_EQ(mat.cols, BinaryDescriptors::kBytes);
+  EXPECT_EQ(mat.data, descriptors.data());
+
+  // same input gives the same descriptors
+  std::vector<cv::KeyPoint> keypoints2;
+  BinaryDescriptors descriptors2;
+  orb.detect_and_compute(img, keypoints2, descriptors2);
+  ASSERT_EQ(descriptors2.rows(), descriptors.rows());
+  EXPECT_EQ(std::memcmp(descriptors.data(), descriptors2.data(), descriptors.rows() * BinaryDescriptors::kBytes), 0);
 }
 
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
@@ -1,12 +1,55 @@
 
 #include <gtest/gtest.h>
 
-TEST(Test, test1)
+#include <string>
+
+#include "feature_descriptor/sift.h"
+
+TEST(SiftTest, test1)
 {
+  std::string path = "../../assets/";
+
+  cv::Mat img = cv::imread(path + "1.pgm", cv::IMREAD_GRAYSCALE);
+  if (img.empty())
+  {
+    printf("读取图像文件失败");
+    return;
+  }
+
+  SIFT sift;
+  std::vector<cv::KeyPoint> keypoints;
+  cv::Mat descriptors;
+  sift.detect_and_compute(img, keypoints, descriptors);
+  std::cout << "keypoint size:" << keypoints.size() << std::endl;
+
+  ASSERT_FALSE(keypoints.empty());
+  ASSERT_EQ(descriptors.rows, static_cast<int>(keypoints.size()));
+  EXPECT_EQ(descriptors.cols, 128);
+  EXPECT_EQ(descriptors.type(), CV_32F);
+  EXPECT_TRUE(descriptors.isContinuous());
+  for (int i = 0; i < descriptors.rows; ++i)
+  {
+    EXPECT_NEAR(cv::norm(descriptors.row(i)), 1.0, 1e-3);
+  }
+  for (const auto &kp : keypoints)
+  {
+    EXPECT_GE(kp.pt.x, 0.f);
+    EXPECT_LT(kp.pt.x, img.cols);
+    EXPECT_GE(kp.pt.y, 0.f);
+    EXPECT_LT(kp.pt.y, img.rows);
+  }
+
+  // byte descriptors come from the same keypoints
+  SIFT sift_u8(0, 3, 0.04, 10, 1.6, CV_8U);
+  std::vector<cv::KeyPoint> keypoints_u8;
+  cv::Mat descriptors_u8;
+  sift_u8.detect_and_compute(img, keypoints_u8, descriptors_u8);
+  EXPECT_EQ(keypoints_u8.size(), keypoints.size());
+  EXPECT_EQ(descriptors_u8.type(), CV_8U);
 }
 
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
@@ -1,12 +1,51 @@
 
 #include <gtest/gtest.h>
 
-TEST(Test, test1)
+#include <string>
+
+#include "feature_descriptor/surf.h"
+
+TEST(SurfTest, test1)
 {
+  std::string path = "../../assets/";
+
+  cv::Mat img = cv::imread(path + "1.pgm", cv::IMREAD_GRAYSCALE);
+  if (img.empty())
+  {
+    printf("读取图像文件失败");
+    return;
+  }
+
+  SURF surf(100);
+  std::vector<cv::KeyPoint> keypoints;
+  cv::Mat descriptors;
+  surf.detect_and_compute(img, keypoints, descriptors);
+  std::cout << "keypoint size:" << keypoints.size() << std::endl;
+
+  ASSERT_FALSE(keypoints.empty());
+  ASSERT_EQ(descriptors.rows, static_cast<int>(keypoints.size()));
+  EXPECT_EQ(descriptors.cols, 64);
+  EXPECT_EQ(descriptors.type(), CV_32F);
+  for (int i = 0; i < descriptors.rows; ++i)
+  {
+    EXPECT_NEAR(cv::norm(descriptors.row(i)), 1.0, 1e-3);
+  }
+  for (const auto &kp : keypoints)
+  {
+    EXPECT_GE(kp.angle, 0.f);
+    EXPECT_LT(kp.angle, 360.f);
+  }
+
+  SURF surf_ext(100, 4, 3, true);
+  std::vector<cv::KeyPoint> keypoints_ext;
+  cv::Mat descriptors_ext;
+  surf_ext.detect_and_compute(img, keypoints_ext, descriptors_ext);
+  EXPECT_EQ(keypoints_ext.size(), keypoints.size());
+  EXPECT_EQ(descriptors_ext.cols, 128);
 }
 
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
@@ -0,0 +1,63 @@
+#ifndef IMAGE_ANALYSIS_BATCH_RUNNER_H_
+#define IMAGE_ANALYSIS_BATCH_RUNNER_H_
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// image in, image out; may throw any std::exception, the image then counts as failed. The decoded
+// image is replaced by the result and used nowhere else, so an operator may write into its pixels
+using BatchOperator = std::function<cv::Mat(const cv::Mat &)>;
+
+struct BatchOptions
+{
+  int decodeThreads  = 4;
+  int computeThreads = 2;
+  int encodeThreads  = 2;
+  // images in flight between two stages
+  size_t queueCapacity = 16;
+  // flags of cv::imdecode
+  int readFlags = cv::IMREAD_COLOR;
+  // outputs go to outputDir under the input file name
+  std::string outputDir = ".";
+  // output format such as ".png", empty keeps the extension of the input
+  std::string extension;
+  std::vector<int> writeParams;
+};
+
+struct BatchStageStats
+{
+  int threads     = 0;
+  uint64_t items  = 0;
+  uint64_t bytes  = 0;
+  // time spent working, summed over the threads of the stage (waiting on queues excluded)
+  double busySeconds = 0.0;
+};
+
+struct BatchStats
+{
+  uint64_t written = 0;
+  std::vector<std::string> failed;
+  double seconds = 0.0;
+  BatchStageStats decode, compute, encode;
+
+  double imagesPerSecond() const { return seconds > 0.0 ? written / seconds : 0.0; }
+};
+
+/**
+ * @brief Runs op over every input as a three-stage pipeline: read + decode, op, encode + write.
+ *
+ * Every stage has its own worker threads and hands images to the next stage through a bounded
+ * lock-free queue, so decoding on some cores overlaps compute and encoding on others while at
+ * most queueCapacity images wait between two stages. Outputs are written in completion order;
+ * inputs sharing a file name overwrite each other. The busy time of each stage shows which one
+ * limits throughput.
+ */
+BatchStats runBatch(const std::vector<std::string> &inputs, const BatchOperator &op, const BatchOptions &options);
+
+// one path per line, blank lines and lines starting with '#' skipped
+std::vector<std::string> readFileList(const std::string &listPath);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef IMAGE_ANALYSIS_BLUR_H_
+#define IMAGE_ANALYSIS_BLUR_H_
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @brief High-frequency share of the spectrum magnitude, lower means blurrier.
+ *
+ * The image is padded (mirrored) to an even DFT-friendly size and transformed as real input, so
+ * only half of the Hermitian spectrum is read. Frequencies are indexed in place instead of
+ * shifting quadrants, and the low-frequency disc comes from a cached per-row cutoff table.
+ *
+ * @param gray Input grayscale image (CV_8UC1)
+ * @param radiusRatio Frequencies within radiusRatio * half the spectrum diagonal count as low
+ * @return double Ratio in [0, 1]
+ */
+double computeBlurFFT(const cv::Mat &gray, double radiusRatio = 0.1);
+
+// variance of the 3x3 Laplacian (aperture 1), higher means sharper
+double laplacianVariance(const cv::Mat &gray);
+
+// mean of Gx^2 + Gy^2 over the 3x3 Sobel gradients, higher means sharper
+double tenengrad(const cv::Mat &gray);
+
+/**
+ * @brief Local focus map: Tenengrad and Laplacian variance per tile.
+ *
+ * Both scores come from one pass over the 3x3 neighbourhoods of a tile, tiles run in parallel and
+ * no gradient image is stored. Borders are reflected (BORDER_REFLECT_101) as in cv::Sobel and
+ * cv::Laplacian, so the tile scores add up to tenengrad() and laplacianVariance().
+ *
+ * @param gray Input grayscale image (CV_8UC1)
+ * @param tenengradMap CV_32F, ceil(rows / tileSize) x ceil(cols / tileSize), edge tiles may be partial
+ * @param laplacianMap CV_32F, same size
+ * @param tileSize Tile side in pixels
+ */
+void computeBlurMap(const cv::Mat &gray, cv::Mat &tenengradMap, cv::Mat &laplacianMap, int tileSize = 64);
+
+enum class FocusMetric
+{
+  Laplacian, // laplacianVariance
+  Tenengrad, // tenengrad
+  FFT        // computeBlurFFT with the default radius
+};
+
+const char *focusMetricName(FocusMetric metric);
+
+double focusScore(const cv::Mat &gray, FocusMetric metric);
+
+/**
+ * @brief One step of a blur cascade.
+ *
+ * The score is computed on the image reduced by `reduction` (1, 2, 4 or 8). Below threshold / band
+ * the image is blurry, above threshold * band it is sharp, in between the next stage decides. The
+ * last stage compares against threshold alone. Thresholds depend on camera and scene, tune them.
+ */
+struct BlurCascadeStage
+{
+  FocusMetric metric;
+  int reduction;
+  double threshold;
+  double band;
+};
+
+// thumbnail Laplacian (1/4), full-resolution Laplacian, then FFT ratio
+std::vector<BlurCascadeStage> defaultBlurCascade();
+
+struct BlurDecision
+{
+  bool blurry = false;
+  double score = 0.0;
+  int stage = -1;  // index of the stage that decided
+  FocusMetric metric = FocusMetric::Laplacian;
+  int reduction = 1;
+};
+
+/**
+ * @brief Cascaded blur judgement with early exit.
+ *
+ * Reduced levels are downsampled from gray with INTER_AREA, once per level and only when a stage
+ * reaches them.
+ */
+BlurDecision judgeBlurCascade(const cv::Mat &gray, const std::vector<BlurCascadeStage> &stages = defaultBlurCascade());
+
+/**
+ * @brief Same cascade straight from a file.
+ *
+ * Reduced levels are decoded with IMREAD_REDUCED_GRAYSCALE_*, so for JPEG an image that is decided
+ * on the thumbnail is never decoded at full resolution. A reduced level the decoder cannot produce
+ * is downsampled from the full-resolution image with INTER_AREA, as in the cv::Mat overload.
+ *
+ * @return false if the image cannot be read at all
+ */
+bool judgeBlurCascade(const std::string &path, BlurDecision &decision,
+                      const std::vector<BlurCascadeStage> &stages = defaultBlurCascade());
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef IMAGE_ANALYSIS_BOUNDED_QUEUE_H_
+#define IMAGE_ANALYSIS_BOUNDED_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @brief Fixed-capacity lock-free queue for any number of producers and consumers.
+ *
+ * A ring of cells, each with a sequence number telling whether it is free for the push of ticket
+ * pos (sequence == pos) or holds the value for the pop of ticket pos (sequence == pos + 1). Push and
+ * pop claim a ticket with one compare-exchange and never block: a full or empty queue returns
+ * false and the caller decides how to wait.
+ */
+template <class T>
+class BoundedQueue
+{
+ public:
+  // capacity is rounded up to a power of two
+  explicit BoundedQueue(size_t capacity)
+  {
+    size_t size = 2;
+    while (size < capacity)
+    {
+      size <<= 1;
+    }
+    mask_  = size - 1;
+    cells_ = std::unique_ptr<Cell[]>(new Cell[size]);
+    for (size_t i = 0; i < size; ++i)
+    {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  BoundedQueue(const BoundedQueue &)            = delete;
+  BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // value is moved from only when the push succeeds
+  bool tryPush(T &&value)
+  {
+    size_t pos = enqueue_.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;)
+    {
+      cell                = &cells_[pos & mask_];
+      const size_t seq    = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0)
+      {
+        if (enqueue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if (diff < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = enqueue_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryPop(T &value)
+  {
+    size_t pos = dequeue_.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;)
+    {
+      cell                = &cells_[pos & mask_];
+      const size_t seq    = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0)
+      {
+        if (dequeue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if (diff < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = dequeue_.load(std::memory_order_relaxed);
+      }
+    }
+    value = std::move(cell->value);
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_ = 0;
+  // producers and consumers touch separate cache lines
+  alignas(64) std::atomic<size_t> enqueue_{0};
+  alignas(64) std::atomic<size_t> dequeue_{0};
+};
+
+#endif
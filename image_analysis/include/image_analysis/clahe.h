@@ -0,0 +1,32 @@
+#ifndef IMAGE_ANALYSIS_CLAHE_H_
+#define IMAGE_ANALYSIS_CLAHE_H_
+
+#include <opencv2/opencv.hpp>
+
+/**
+ * @brief Contrast limited adaptive histogram equalization of an 8-bit gray image.
+ *
+ * Same algorithm and parameters as cv::CLAHE: tile histograms are clipped and turned into lookup
+ * tables in parallel, then every pixel is mapped through the bilinear blend of its four nearest
+ * tile tables in one row-parallel pass. Sizes that do not divide into the grid are handled by
+ * reading reflected borders, not by padding a copy.
+ *
+ * @param src CV_8UC1
+ * @param dst CV_8UC1, may be src
+ * @param clipLimit Contrast limit per tile, relative to a flat histogram
+ * @param tileGridSize Number of tiles in x and y
+ */
+void claheGray(const cv::Mat &src, cv::Mat &dst, double clipLimit = 2.0, cv::Size tileGridSize = {8, 8});
+
+/**
+ * @brief CLAHE on the luma of a BGR image, chroma kept.
+ *
+ * Luma is BT.601 (as COLOR_BGR2GRAY), computed on the fly both for the tile histograms and for the
+ * mapping pass; each pixel is then scaled by mapped / original luma, so hue and saturation stay
+ * and no Lab round trip or channel split is needed.
+ *
+ * @param bgr CV_8UC3, modified in place
+ */
+void claheColorInPlace(cv::Mat &bgr, double clipLimit = 2.0, cv::Size tileGridSize = {8, 8});
+
+#endif
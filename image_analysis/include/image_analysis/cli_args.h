@@ -0,0 +1,41 @@
+#ifndef IMAGE_ANALYSIS_CLI_ARGS_H_
+#define IMAGE_ANALYSIS_CLI_ARGS_H_
+
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+
+/**
+ * @brief Parse a whole command-line argument as a finite number.
+ *
+ * Unlike std::stod / std::stoi these never throw: empty text, trailing characters, out-of-range
+ * values and (for double) inf / nan return false, and the tools print their usage instead.
+ */
+inline bool parseArg(const char *text, double &value)
+{
+  char *end = nullptr;
+  errno     = 0;
+  const double v = std::strtod(text, &end);
+  if (end == text || *end != '\0' || errno == ERANGE || !std::isfinite(v))
+  {
+    return false;
+  }
+  value = v;
+  return true;
+}
+
+inline bool parseArg(const char *text, int &value)
+{
+  char *end = nullptr;
+  errno     = 0;
+  const long v = std::strtol(text, &end, 10);
+  if (end == text || *end != '\0' || errno == ERANGE || v < INT_MIN || v > INT_MAX)
+  {
+    return false;
+  }
+  value = static_cast<int>(v);
+  return true;
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef IMAGE_ANALYSIS_COLOR_LUT_H_
+#define IMAGE_ANALYSIS_COLOR_LUT_H_
+
+#include <opencv2/opencv.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 3D color lookup table with tetrahedral interpolation.
+ *
+ * Any per-pixel color transform, however many steps it chains, is baked once into a size^3 grid
+ * (17 or 33 are the usual sizes) and then costs one interpolated lookup per pixel. Colors are RGB in
+ * [0, 1] with red varying fastest, the layout of .cube files.
+ */
+class ColorLut3D
+{
+ public:
+  // RGB in [0, 1] -> RGB, the output is clamped to [0, 1] when baked
+  using Transform = std::function<cv::Vec3f(const cv::Vec3f &rgb)>;
+
+  // identity table of size^3 entries
+  explicit ColorLut3D(int size = 33);
+
+  int size() const { return size_; }
+  const std::string &title() const { return title_; }
+  void setTitle(const std::string &title) { title_ = title; }
+
+  // evaluates transform at every grid point, from several threads
+  void bake(const Transform &transform);
+
+  // RGB of one grid point
+  cv::Vec3f at(int r, int g, int b) const;
+
+  // interpolated RGB of an arbitrary color, e.g. to bake a chain of tables into one
+  cv::Vec3f sample(const cv::Vec3f &rgb) const;
+
+  /**
+   * @brief Maps every pixel through the table, rows in parallel.
+   *
+   * @param srcBGR8 CV_8UC3, BGR order
+   * @param dst CV_8UC3, BGR order; may be srcBGR8 itself
+   */
+  void apply(const cv::Mat &srcBGR8, cv::Mat &dst) const;
+
+  /**
+   * @brief Reads an Adobe/Resolve .cube with LUT_3D_SIZE and the default domain [0, 1].
+   *
+   * Returns false, leaving the table unchanged, if the file is unreadable, has the wrong number of
+   * entries, an entry outside [0, 1], or any keyword besides TITLE, LUT_3D_SIZE, DOMAIN_MIN,
+   * DOMAIN_MAX and LUT_3D_INPUT_RANGE.
+   */
+  bool load(const std::string &path);
+  bool save(const std::string &path) const;
+
+ private:
+  int size_;
+  std::string title_;
+  // RGB plus one padding float per grid point, so a vertex is one 4-float load
+  std::vector<cv::Vec4f> data_;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef IMAGE_ANALYSIS_GRADIENT_MAGNITUDE_H_
+#define IMAGE_ANALYSIS_GRADIENT_MAGNITUDE_H_
+
+#include <opencv2/opencv.hpp>
+
+enum class GradientKernel
+{
+  Sobel, // 3x3, {1, 2, 1} smoothing
+  Scharr // 3x3, {3, 10, 3} smoothing
+};
+
+/**
+ * @brief 8-bit gradient magnitude sqrt(Gx^2 + Gy^2) of a CV_8UC1 image.
+ *
+ * Both derivatives and the magnitude come from one pass over the 3x3 neighbourhoods in integers,
+ * borders reflected as in cv::Sobel / cv::Scharr. With range > 0 the magnitude is scaled by
+ * 255 / range and saturated in that single pass. Otherwise the result is min-max normalized to
+ * [0, 255] (as cv::normalize with NORM_MINMAX): a first pass only tracks the extremes and the
+ * output pass recomputes the gradients, so no float image is ever stored.
+ *
+ * The magnitude is the float one of cv::magnitude and the scaling follows cv::normalize and
+ * convertTo step by step, so the output equals the CV_32F Sobel / Scharr + magnitude + normalize
+ * chain. Only an OpenCV build that fuses the final multiply-add (FMA) can round a value that lies
+ * within float precision of a half level to the other neighbour.
+ *
+ * @param gray Input grayscale image (CV_8UC1)
+ * @param dst CV_8UC1, must not share memory with gray
+ * @param kernel Derivative operator
+ * @param range Magnitude mapped to 255, 0 for min-max normalization
+ */
+void gradientMagnitude(const cv::Mat &gray, cv::Mat &dst, GradientKernel kernel = GradientKernel::Sobel, double range = 0.0);
+
+#endif
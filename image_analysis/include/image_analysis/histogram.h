@@ -0,0 +1,63 @@
+#ifndef IMAGE_ANALYSIS_HISTOGRAM_H_
+#define IMAGE_ANALYSIS_HISTOGRAM_H_
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Value histogram of a single-channel image with its cumulative counts.
+ *
+ * 256 bins for CV_8U and 65536 bins for CV_16U images; cdf[v] counts the pixels with value <= v.
+ */
+struct Histogram
+{
+  std::vector<uint64_t> counts;
+  std::vector<uint64_t> cdf;
+  uint64_t total = 0;
+};
+
+/**
+ * @brief Count the pixel values of a CV_8UC1 or CV_16UC1 image and build the CDF.
+ *
+ * Rows are split over threads; every thread counts into private sub-histograms (four interleaved
+ * ones for 8-bit, so runs of equal pixels do not serialize on one counter) that are summed at the end.
+ *
+ * @param img Input image (CV_8UC1 or CV_16UC1)
+ * @param hist Output histogram, its buffers are reused between calls
+ * @param sample_step Count every sample_step-th pixel of each row, the phase shifting by one per row
+ */
+void computeHistogram(const cv::Mat &img, Histogram &hist, int sample_step = 1);
+
+// recompute hist.cdf and hist.total from hist.counts
+void buildCdf(Histogram &hist);
+
+/**
+ * @brief Smallest value v whose cumulative count reaches p * total, found by binary search on the CDF.
+ *
+ * @param p Fraction in [0, 1], e.g. 0.2 for the 20th percentile
+ * @return int Pixel value, 0 for an empty histogram
+ */
+int histogramPercentile(const Histogram &hist, double p);
+
+/**
+ * @brief Percentile interpolated linearly between the two nearest order statistics, the default of
+ * numpy.percentile.
+ *
+ * @param p Fraction in [0, 1]
+ * @return double 0 for an empty histogram
+ */
+double histogramQuantile(const Histogram &hist, double p);
+
+double histogramMean(const Histogram &hist);
+
+/**
+ * @brief Rank error of percentiles estimated from n sampled pixels (Dvoretzky-Kiefer-Wolfowitz).
+ *
+ * With the given confidence, the estimated p-th percentile lies between the true (p - e)-th and
+ * (p + e)-th percentiles of the full image. Treats the samples as independent, which a regular
+ * pixel grid only approximates.
+ */
+double percentileErrorBound(double n, double confidence = 0.95);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef IMAGE_ANALYSIS_IMAGE_PROFILE_H_
+#define IMAGE_ANALYSIS_IMAGE_PROFILE_H_
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+
+#include "image_analysis/histogram.h"
+
+/**
+ * @brief Ingestion quality metrics of one image, the ones of script/image_property.py.
+ */
+struct ImageProfile
+{
+  int rows     = 0;
+  int cols     = 0;
+  int channels = 0;
+  // distinct BGR triples (gray levels for one channel)
+  uint64_t uniqueColors = 0;
+  // standard deviation over all channel values, as numpy.std
+  double stddev = 0.0;
+  // 5th / 95th percentile of the gray image, interpolated as numpy.percentile
+  double p5  = 0.0;
+  double p95 = 0.0;
+  // variance of the aperture 1 Laplacian over all channels
+  double laplacianVariance = 0.0;
+  // mean HSV value, max(B, G, R)
+  double meanBrightness = 0.0;
+};
+
+/**
+ * @brief All metrics of ImageProfile in one pass over the pixels, rows split over threads.
+ *
+ * Unique colors are marked in a shared 2^24-bit set (a bit is only written when it is still
+ * clear), gray levels go to a histogram for the percentiles, the Laplacian comes from the 3x3
+ * neighbourhood with reflected borders. Gray is BT.601 in the fixed point of COLOR_BGR2GRAY.
+ *
+ * @param img CV_8UC1 or CV_8UC3 (BGR)
+ * @param grayHist If given, receives that gray level histogram, for percentiles of another definition
+ */
+ImageProfile computeImageProfile(const cv::Mat &img, Histogram *grayHist = nullptr);
+
+#endif
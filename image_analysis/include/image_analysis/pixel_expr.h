@@ -0,0 +1,395 @@
+#ifndef IMAGE_ANALYSIS_PIXEL_EXPR_H_
+#define IMAGE_ANALYSIS_PIXEL_EXPR_H_
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+/*
+Lazy per-pixel image algebra. Arithmetic on pixel_expr::lazy(mat) builds an expression tree instead
+of images:
+
+  using pixel_expr::lazy;
+  cv::Mat out = clamp((lazy(img) - blur) * 1.5 + lazy(img), 0, 255).mat(CV_8U);
+
+evaluates in one pass over memory instead of one pass per operator. Rows are split over threads and
+walked in spans of kExprSpan values; every node of the tree computes its span into a float buffer
+that stays in L1, with plain loops the compiler vectorizes. Images of one expression must share
+size and channel count, channels are treated as independent values. Math is in float, the sink
+converts with saturation as convertTo.
+
+Everything lives in namespace pixel_expr. The operators and min / max / abs / sqrt / pow / clamp
+take at least one expression (ImageExpr) operand, so argument-dependent lookup finds them without a
+using-directive and they never join overload resolution for plain cv::Mat or arithmetic operands.
+*/
+
+namespace pixel_expr
+{
+
+// values per tile row, one buffer of this many floats per node lives on the stack
+constexpr int kExprSpan = 256;
+
+// size and channel count of the images of an expression, checked to agree
+struct ExprShape
+{
+  cv::Size size;
+  int channels = 0;
+
+  void merge(const cv::Mat &m)
+  {
+    if (channels == 0)
+    {
+      size     = m.size();
+      channels = m.channels();
+      return;
+    }
+    CV_Assert(m.size() == size && m.channels() == channels);
+  }
+};
+
+template <class E>
+struct ImageExpr
+{
+  const E &self() const { return static_cast<const E &>(*this); }
+
+  // evaluates the expression into a new image of depth ddepth
+  cv::Mat mat(int ddepth = CV_32F) const;
+};
+
+// E is a node type of this header, i.e. derives from ImageExpr<E>
+template <class E>
+constexpr bool IsExpr = std::is_base_of<ImageExpr<E>, E>::value;
+
+template <class... E>
+using EnableIfExpr = std::enable_if_t<(IsExpr<E> && ...), int>;
+
+// an image as a leaf; holds the cv::Mat header, so the expression keeps its data alive
+class ExprSource : public ImageExpr<ExprSource>
+{
+ public:
+  explicit ExprSource(const cv::Mat &m) : m_(m)
+  {
+    const int depth = m.depth();
+    CV_Assert(!m.empty() && m.dims == 2
+              && (depth == CV_8U || depth == CV_16U || depth == CV_16S || depth == CV_32F || depth == CV_64F));
+  }
+
+  void shape(ExprShape &s) const { s.merge(m_); }
+
+  // values x .. x + n of row y (x counts channel values, not pixels)
+  void span(int y, int x, int n, float *out) const
+  {
+    switch (m_.depth())
+    {
+    case CV_8U: convert(m_.ptr<uchar>(y) + x, n, out); break;
+    case CV_16U: convert(m_.ptr<ushort>(y) + x, n, out); break;
+    case CV_16S: convert(m_.ptr<short>(y) + x, n, out); break;
+    case CV_32F: std::memcpy(out, m_.ptr<float>(y) + x, n * sizeof(float)); break;
+    default: convert(m_.ptr<double>(y) + x, n, out); break;
+    }
+  }
+
+ private:
+  template <class T>
+  static void convert(const T *p, int n, float *out)
+  {
+    for (int i = 0; i < n; ++i)
+    {
+      out[i] = static_cast<float>(p[i]);
+    }
+  }
+
+  cv::Mat m_;
+};
+
+class ExprConstant : public ImageExpr<ExprConstant>
+{
+ public:
+  explicit ExprConstant(double v) : v_(static_cast<float>(v)) {}
+
+  void shape(ExprShape &) const {}
+  float value() const { return v_; }
+  void span(int, int, int n, float *out) const { std::fill(out, out + n, v_); }
+
+ private:
+  float v_;
+};
+
+template <class Op, class A>
+class ExprUnary : public ImageExpr<ExprUnary<Op, A>>
+{
+ public:
+  ExprUnary(const A &a, const Op &op) : a_(a), op_(op) {}
+
+  void shape(ExprShape &s) const { a_.shape(s); }
+  void span(int y, int x, int n, float *out) const
+  {
+    a_.span(y, x, n, out);
+    op_(out, n);
+  }
+
+ private:
+  A a_;
+  Op op_;
+};
+
+template <class Op, class A, class B>
+class ExprBinary : public ImageExpr<ExprBinary<Op, A, B>>
+{
+ public:
+  ExprBinary(const A &a, const B &b) : a_(a), b_(b) {}
+
+  void shape(ExprShape &s) const
+  {
+    a_.shape(s);
+    b_.shape(s);
+  }
+  void span(int y, int x, int n, float *out) const
+  {
+    a_.span(y, x, n, out);
+    // a constant right operand is broadcast rather than written out
+    if constexpr (std::is_same<B, ExprConstant>::value)
+    {
+      Op()(out, b_.value(), n);
+    }
+    else
+    {
+      alignas(32) float rhs[kExprSpan];
+      b_.span(y, x, n, rhs);
+      Op()(out, rhs, n);
+    }
+  }
+
+ private:
+  A a_;
+  B b_;
+};
+
+// a op= b over a span, b a span or a scalar
+#define IMAGE_ANALYSIS_EXPR_OP(Name, expression)               \
+  struct Name                                                  \
+  {                                                            \
+    void operator()(float *a, const float *b, int n) const     \
+    {                                                          \
+      for (int i = 0; i < n; ++i)                              \
+      {                                                        \
+        const float x = a[i], y = b[i];                        \
+        a[i]          = (expression);                          \
+      }                                                        \
+    }                                                          \
+    void operator()(float *a, float y, int n) const            \
+    {                                                          \
+      for (int i = 0; i < n; ++i)                              \
+      {                                                        \
+        const float x = a[i];                                  \
+        a[i]          = (expression);                          \
+      }                                                        \
+    }                                                          \
+  };
+IMAGE_ANALYSIS_EXPR_OP(ExprAdd, x + y)
+IMAGE_ANALYSIS_EXPR_OP(ExprSub, x - y)
+IMAGE_ANALYSIS_EXPR_OP(ExprMul, x * y)
+IMAGE_ANALYSIS_EXPR_OP(ExprDiv, x / y)
+IMAGE_ANALYSIS_EXPR_OP(ExprMin, std::min(x, y))
+IMAGE_ANALYSIS_EXPR_OP(ExprMax, std::max(x, y))
+#undef IMAGE_ANALYSIS_EXPR_OP
+
+// every combination of expression, cv::Mat and scalar operands, at least one an expression
+#define IMAGE_ANALYSIS_EXPR_BINARY(function, Op)                                                    \
+  template <class A, class B, EnableIfExpr<A, B> = 0>                                               \
+  ExprBinary<Op, A, B> function(const ImageExpr<A> &a, const ImageExpr<B> &b)                       \
+  {                                                                                                 \
+    return ExprBinary<Op, A, B>(a.self(), b.self());                                                \
+  }                                                                                                 \
+  template <class A, EnableIfExpr<A> = 0>                                                           \
+  ExprBinary<Op, A, ExprSource> function(const ImageExpr<A> &a, const cv::Mat &b)                   \
+  {                                                                                                 \
+    return ExprBinary<Op, A, ExprSource>(a.self(), ExprSource(b));                                  \
+  }                                                                                                 \
+  template <class B, EnableIfExpr<B> = 0>                                                           \
+  ExprBinary<Op, ExprSource, B> function(const cv::Mat &a, const ImageExpr<B> &b)                   \
+  {                                                                                                 \
+    return ExprBinary<Op, ExprSource, B>(ExprSource(a), b.self());                                  \
+  }                                                                                                 \
+  template <class A, EnableIfExpr<A> = 0>                                                           \
+  ExprBinary<Op, A, ExprConstant> function(const ImageExpr<A> &a, double b)                         \
+  {                                                                                                 \
+    return ExprBinary<Op, A, ExprConstant>(a.self(), ExprConstant(b));                              \
+  }                                                                                                 \
+  template <class B, EnableIfExpr<B> = 0>                                                           \
+  ExprBinary<Op, ExprConstant, B> function(double a, const ImageExpr<B> &b)                         \
+  {                                                                                                 \
+    return ExprBinary<Op, ExprConstant, B>(ExprConstant(a), b.self());                              \
+  }
+IMAGE_ANALYSIS_EXPR_BINARY(operator+, ExprAdd)
+IMAGE_ANALYSIS_EXPR_BINARY(operator-, ExprSub)
+IMAGE_ANALYSIS_EXPR_BINARY(operator*, ExprMul)
+IMAGE_ANALYSIS_EXPR_BINARY(operator/, ExprDiv)
+IMAGE_ANALYSIS_EXPR_BINARY(min, ExprMin)
+IMAGE_ANALYSIS_EXPR_BINARY(max, ExprMax)
+#undef IMAGE_ANALYSIS_EXPR_BINARY
+
+struct ExprNeg
+{
+  void operator()(float *a, int n) const
+  {
+    for (int i = 0; i < n; ++i)
+    {
+      a[i] = -a[i];
+    }
+  }
+};
+
+struct ExprAbs
+{
+  void operator()(float *a, int n) const
+  {
+    for (int i = 0; i < n; ++i)
+    {
+      a[i] = std::abs(a[i]);
+    }
+  }
+};
+
+struct ExprSqrt
+{
+  void operator()(float *a, int n) const
+  {
+    for (int i = 0; i < n; ++i)
+    {
+      a[i] = std::sqrt(a[i]);
+    }
+  }
+};
+
+struct ExprPow
+{
+  float p;
+  void operator()(float *a, int n) const
+  {
+    for (int i = 0; i < n; ++i)
+    {
+      a[i] = std::pow(a[i], p);
+    }
+  }
+};
+
+struct ExprClamp
+{
+  float lo, hi;
+  void operator()(float *a, int n) const
+  {
+    for (int i = 0; i < n; ++i)
+    {
+      a[i] = std::min(std::max(a[i], lo), hi);
+    }
+  }
+};
+
+inline ExprSource lazy(const cv::Mat &m) { return ExprSource(m); }
+
+template <class A, EnableIfExpr<A> = 0>
+ExprUnary<ExprNeg, A> operator-(const ImageExpr<A> &a)
+{
+  return ExprUnary<ExprNeg, A>(a.self(), ExprNeg());
+}
+
+template <class A, EnableIfExpr<A> = 0>
+ExprUnary<ExprAbs, A> abs(const ImageExpr<A> &a)
+{
+  return ExprUnary<ExprAbs, A>(a.self(), ExprAbs());
+}
+
+template <class A, EnableIfExpr<A> = 0>
+ExprUnary<ExprSqrt, A> sqrt(const ImageExpr<A> &a)
+{
+  return ExprUnary<ExprSqrt, A>(a.self(), ExprSqrt());
+}
+
+template <class A, EnableIfExpr<A> = 0>
+ExprUnary<ExprPow, A> pow(const ImageExpr<A> &a, double p)
+{
+  return ExprUnary<ExprPow, A>(a.self(), ExprPow{static_cast<float>(p)});
+}
+
+template <class A, EnableIfExpr<A> = 0>
+ExprUnary<ExprClamp, A> clamp(const ImageExpr<A> &a, double lo, double hi)
+{
+  return ExprUnary<ExprClamp, A>(a.self(), ExprClamp{static_cast<float>(lo), static_cast<float>(hi)});
+}
+
+/**
+ * @brief Evaluates expr into dst in a single pass, rows in parallel.
+ *
+ * dst gets the size and channel count of the images in expr and depth ddepth (CV_8U, CV_16U,
+ * CV_16S or CV_32F), values are saturated as by convertTo. dst may be one of the images of expr:
+ * every span is read in full before it is written.
+ */
+template <class E, EnableIfExpr<E> = 0>
+void evaluate(const ImageExpr<E> &expr, cv::Mat &dst, int ddepth = CV_32F)
+{
+  CV_Assert(ddepth == CV_8U || ddepth == CV_16U || ddepth == CV_16S || ddepth == CV_32F);
+  const E &e = expr.self();
+  ExprShape s;
+  e.shape(s);
+  // an expression of constants only has no size
+  CV_Assert(s.channels > 0);
+  dst.create(s.size, CV_MAKETYPE(ddepth, s.channels));
+
+  const int width = s.size.width * s.channels;
+  cv::parallel_for_(cv::Range(0, s.size.height), [&](const cv::Range &range) {
+    alignas(32) float values[kExprSpan];
+    for (int y = range.start; y < range.end; ++y)
+    {
+      for (int x = 0; x < width; x += kExprSpan)
+      {
+        const int n = std::min(kExprSpan, width - x);
+        e.span(y, x, n, values);
+        switch (ddepth)
+        {
+        case CV_8U:
+        {
+          uchar *out = dst.ptr<uchar>(y) + x;
+          for (int i = 0; i < n; ++i)
+          {
+            out[i] = cv::saturate_cast<uchar>(values[i]);
+          }
+          break;
+        }
+        case CV_16U:
+        {
+          ushort *out = dst.ptr<ushort>(y) + x;
+          for (int i = 0; i < n; ++i)
+          {
+            out[i] = cv::saturate_cast<ushort>(values[i]);
+          }
+          break;
+        }
+        case CV_16S:
+        {
+          short *out = dst.ptr<short>(y) + x;
+          for (int i = 0; i < n; ++i)
+          {
+            out[i] = cv::saturate_cast<short>(values[i]);
+          }
+          break;
+        }
+        default: std::memcpy(dst.ptr<float>(y) + x, values, n * sizeof(float)); break;
+        }
+      }
+    }
+  });
+}
+
+template <class E>
+cv::Mat ImageExpr<E>::mat(int ddepth) const
+{
+  cv::Mat m;
+  evaluate(*this, m, ddepth);
+  return m;
+}
+} // namespace pixel_expr
+
+#endif
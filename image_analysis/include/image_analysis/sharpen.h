@@ -0,0 +1,30 @@
+#ifndef IMAGE_ANALYSIS_SHARPEN_H_
+#define IMAGE_ANALYSIS_SHARPEN_H_
+
+#include <opencv2/opencv.hpp>
+
+/*
+Sharpening of CV_8UC1 images, each one fused integer pass from input to saturated 8-bit output with
+no intermediate image. Borders are reflected (BORDER_REFLECT_101) as in the OpenCV filters. dst
+must not share memory with src.
+*/
+
+// img - |Laplacian (aperture 3)|, as Laplacian + convertScaleAbs + addWeighted(1, -1)
+void sharpenLaplacian(const cv::Mat &src, cv::Mat &dst);
+
+// 3x3 kernel {0, -1, 0; -1, 5, -1; 0, -1, 0}, as filter2D
+void sharpenKernel(const cv::Mat &src, cv::Mat &dst);
+
+/**
+ * @brief Unsharp mask, img + amount * (img - Gaussian(img)).
+ *
+ * The Gaussian is separable in 8-bit fixed point (as cv::GaussianBlur on 8-bit images): every
+ * source row is blurred horizontally once into a rolling window of 2r + 1 rows, the vertical pass
+ * and the mask are then applied per output row, so the blurred image is never stored.
+ *
+ * @param sigma Gaussian sigma, the aperture is the one cv::GaussianBlur picks for 8-bit images
+ * @param amount Weight of the detail, in [0, 16]
+ */
+void unsharpMask(const cv::Mat &src, cv::Mat &dst, double sigma = 1.0, double amount = 0.5);
+
+#endif
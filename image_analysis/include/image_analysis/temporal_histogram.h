@@ -0,0 +1,70 @@
+#ifndef IMAGE_ANALYSIS_TEMPORAL_HISTOGRAM_H_
+#define IMAGE_ANALYSIS_TEMPORAL_HISTOGRAM_H_
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "image_analysis/histogram.h"
+
+/**
+ * @brief Rolling brightness statistics of a video stream, updated one frame at a time.
+ *
+ * Keeps two views of the recent past: the exact histogram of the last `window` frames (a ring of
+ * per-frame counts; an update adds the new frame and subtracts the evicted one) and an
+ * exponentially decayed histogram of pixel fractions. Neither revisits older frames.
+ */
+class TemporalHistogram
+{
+ public:
+  /**
+   * @param window Number of frames of the sliding window
+   * @param decay Weight of the newest frame in the decayed histogram, in (0, 1]
+   * @param sample_step Count every sample_step-th pixel of a frame, see computeHistogram
+   */
+  TemporalHistogram(int window = 30, double decay = 0.1, int sample_step = 1);
+
+  // CV_8UC1 or CV_16UC1, every frame of one depth; a depth change starts over
+  void update(const cv::Mat &frame);
+  void reset();
+
+  int frames() const { return frames_; }
+  // histogram of the newest frame
+  const Histogram &last() const { return frame_; }
+
+  int windowPercentile(double p) const;
+  double windowMean() const;
+  int decayedPercentile(double p) const;
+  double decayedMean() const;
+
+  // rank error of the percentiles above caused by pixel sampling, see percentileErrorBound
+  double windowErrorBound(double confidence = 0.95) const;
+  double decayedErrorBound(double confidence = 0.95) const;
+
+ private:
+  void refreshCdf() const;
+
+  int window_;
+  double decay_;
+  int sample_step_;
+
+  int frames_ = 0;
+  Histogram frame_;
+  // window_ frame histograms, the oldest at head_
+  std::vector<std::vector<uint32_t>> ring_;
+  std::vector<uint64_t> ring_totals_;
+  int head_ = 0;
+  std::vector<uint64_t> window_counts_;
+  uint64_t window_total_ = 0;
+  // fraction of pixels per value, sums to 1
+  std::vector<double> decayed_;
+  // effective number of samples behind decayed_, the weighted DKW sample size
+  double decayed_samples_ = 0;
+
+  // cumulative views, rebuilt lazily by the percentile queries
+  mutable bool dirty_ = true;
+  mutable std::vector<uint64_t> window_cdf_;
+  mutable std::vector<double> decayed_cdf_;
+};
+
+#endif
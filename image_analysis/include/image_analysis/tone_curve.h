@@ -0,0 +1,49 @@
+#ifndef IMAGE_ANALYSIS_TONE_CURVE_H_
+#define IMAGE_ANALYSIS_TONE_CURVE_H_
+
+#include <opencv2/opencv.hpp>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Chain of point operations on gray levels normalized to [0, 1].
+ *
+ * Curves compose without rounding in between and compile into one lookup table, 256 entries for
+ * 8-bit images and 65536 for 16-bit ones, so a chain of N operations costs a single pass.
+ */
+class ToneCurve
+{
+ public:
+  using Function = std::function<double(double)>;
+
+  // identity
+  ToneCurve();
+  explicit ToneCurve(const Function &f);
+
+  // 1 / (1 + exp(-k (x - x0))), steepens contrast around x0
+  static ToneCurve sigmoid(double x0, double k);
+  // x^gamma, gamma < 1 lifts dark regions
+  static ToneCurve gamma(double gamma);
+  // alpha * x + beta
+  static ToneCurve brightnessContrast(double alpha, double beta);
+  static ToneCurve clamp(double lo = 0.0, double hi = 1.0);
+
+  // this curve followed by next
+  ToneCurve then(const ToneCurve &next) const;
+
+  double operator()(double x) const;
+
+  // 1x256 CV_8U or 1x65536 CV_16U table, output clamped to the range of depth
+  cv::Mat lut(int depth) const;
+
+  // CV_8U or CV_16U with any number of channels, dst may be src
+  void apply(const cv::Mat &src, cv::Mat &dst) const;
+
+ private:
+  std::vector<Function> steps_;
+};
+
+// src through a table from ToneCurve::lut, for reusing one table across frames
+void applyToneLut(const cv::Mat &src, const cv::Mat &lut, cv::Mat &dst);
+
+#endif
@@ -0,0 +1,132 @@
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "image_analysis/batch_runner.h"
+#include "image_analysis/clahe.h"
+#include "image_analysis/cli_args.h"
+#include "image_analysis/gradient_magnitude.h"
+#include "image_analysis/sharpen.h"
+#include "image_analysis/tone_curve.h"
+
+// the operator for name and the decode flags it needs, false for an unknown name
+static bool makeOperator(const std::string &name, BatchOperator &op, int &readFlags)
+{
+  readFlags = cv::IMREAD_GRAYSCALE;
+  if (name == "copy")
+  {
+    readFlags = cv::IMREAD_UNCHANGED;
+    op        = [](const cv::Mat &img) { return img; };
+  }
+  else if (name == "enhance")
+  {
+    const cv::Mat lut = ToneCurve::sigmoid(125.0 / 255.0, 0.08 * 255.0).lut(CV_8U);
+    op                = [lut](const cv::Mat &img) {
+      cv::Mat out;
+      applyToneLut(img, lut, out);
+      return out;
+    };
+  }
+  else if (name == "sharpen")
+  {
+    op = [](const cv::Mat &img) {
+      cv::Mat out;
+      unsharpMask(img, out, 1.0, 0.5);
+      return out;
+    };
+  }
+  else if (name == "gradient")
+  {
+    op = [](const cv::Mat &img) {
+      cv::Mat out;
+      gradientMagnitude(img, out);
+      return out;
+    };
+  }
+  else if (name == "clahe")
+  {
+    readFlags = cv::IMREAD_COLOR;
+    // in place on the decoded image, which the runner drops for the result anyway
+    op = [](const cv::Mat &img) {
+      cv::Mat out = img;
+      claheColorInPlace(out);
+      return out;
+    };
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+static const char *const kUsage = "usage: batch_process <file_list> <output_dir> [operator] [.ext] [decode compute encode]";
+
+static void printStage(const char *name, const BatchStageStats &s, double seconds)
+{
+  // share of the wall time the workers of the stage were busy
+  const double load = seconds > 0.0 ? s.busySeconds / (seconds * s.threads) : 0.0;
+  std::printf("  %-8s %2d threads %8llu images %9.1f MB  busy %5.1f%%\n", name, s.threads,
+              static_cast<unsigned long long>(s.items), s.bytes / 1e6, 100.0 * load);
+}
+
+int main(int argc, char **argv)
+{
+  // batch_process <file_list> <output_dir> [copy | enhance | sharpen | gradient | clahe] [.ext]
+  //               [decode_threads compute_threads encode_threads]
+  if (argc < 3)
+  {
+    std::cerr << kUsage << std::endl;
+    return -1;
+  }
+  BatchOptions options;
+  options.outputDir      = argv[2];
+  const std::string name = argc > 3 ? argv[3] : "copy";
+  BatchOperator op;
+  if (!makeOperator(name, op, options.readFlags))
+  {
+    std::cerr << "Unknown operator " << name << std::endl;
+    return -1;
+  }
+  if (argc > 4 && std::string(argv[4]) != "-")
+  {
+    options.extension = argv[4];
+  }
+  if (argc > 5)
+  {
+    // all three counts or none
+    if (argc < 8 || !parseArg(argv[5], options.decodeThreads) || !parseArg(argv[6], options.computeThreads) ||
+        !parseArg(argv[7], options.encodeThreads) || options.decodeThreads <= 0 || options.computeThreads <= 0 ||
+        options.encodeThreads <= 0)
+    {
+      std::cerr << kUsage << std::endl;
+      return -1;
+    }
+  }
+  else
+  {
+    // decoding is the heaviest stage for compressed inputs
+    const int cores        = std::max(3, static_cast<int>(std::thread::hardware_concurrency()));
+    options.encodeThreads  = std::max(1, cores / 4);
+    options.computeThreads = std::max(1, cores / 4);
+    options.decodeThreads  = cores - options.encodeThreads - options.computeThreads;
+  }
+
+  const std::vector<std::string> inputs = readFileList(argv[1]);
+  const BatchStats stats                = runBatch(inputs, op, options);
+
+  for (const std::string &path : stats.failed)
+  {
+    std::cerr << path << " failed" << std::endl;
+  }
+  std::printf("%llu of %zu images in %.2f s, %.1f images/s, %.1f MB/s read\n",
+              static_cast<unsigned long long>(stats.written), inputs.size(), stats.seconds, stats.imagesPerSecond(),
+              stats.seconds > 0.0 ? stats.decode.bytes / 1e6 / stats.seconds : 0.0);
+  printStage("decode", stats.decode, stats.seconds);
+  printStage("compute", stats.compute, stats.seconds);
+  printStage("encode", stats.encode, stats.seconds);
+  return stats.failed.empty() ? 0 : 1;
+}
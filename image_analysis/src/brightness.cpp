@@ -1,18 +1,93 @@
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
+#include <string>
+#include <vector>
+
+#include "image_analysis/histogram.h"
+
+// 读取为单通道灰度图，16 位图像保持 16 位
+static cv::Mat loadGray(const std::string &path)
+{
+  return cv::imread(path, cv::IMREAD_GRAYSCALE | cv::IMREAD_ANYDEPTH);
+}
+
+/**
+ * @brief Batch mode: one line per image, "path p_1 ... p_n mean", in directory order.
+ *
+ * Images are decoded and counted in parallel, a chunk at a time so memory stays flat on huge
+ * directories; unreadable files get "path failed".
+ */
+static int runBatch(const std::string &dir, const std::vector<double> &percentiles)
+{
+  std::vector<std::string> files;
+  for (const auto &entry : std::filesystem::directory_iterator(dir))
+  {
+    if (entry.is_regular_file())
+    {
+      files.push_back(entry.path().string());
+    }
+  }
+  std::sort(files.begin(), files.end());
+
+  const size_t chunk = 256;
+  std::vector<std::string> lines;
+  for (size_t begin = 0; begin < files.size(); begin += chunk)
+  {
+    const size_t end = std::min(files.size(), begin + chunk);
+    lines.assign(end - begin, std::string());
+    // nested parallel_for_ inside computeHistogram runs serially, images are the unit of work here
+    cv::parallel_for_(cv::Range(static_cast<int>(begin), static_cast<int>(end)), [&](const cv::Range &range) {
+      Histogram hist;
+      for (int i = range.start; i < range.end; ++i)
+      {
+        std::string &line = lines[i - begin];
+        cv::Mat gray      = loadGray(files[i]);
+        if (gray.empty() || (gray.depth() != CV_8U && gray.depth() != CV_16U))
+        {
+          line = files[i] + " failed";
+          continue;
+        }
+        computeHistogram(gray, hist);
+        line = files[i];
+        for (double p : percentiles)
+        {
+          line += " " + std::to_string(histogramPercentile(hist, p));
+        }
+        line += " " + std::to_string(histogramMean(hist));
+      }
+    });
+    for (const auto &line : lines)
+    {
+      std::cout << line << '\n';
+    }
+  }
+  std::cout.flush();
+  return 0;
+}
 
 int main(int argc, char **argv)
 {
-  // 加载图像
-  cv::Mat image;
-  if (argc == 1)
+  // brightness [image | directory] [percentile ...]，百分位取值 0~1，默认 0.2 0.8
+  std::string input = argc > 1 ? argv[1] : "../../assets/1.pgm";
+  std::vector<double> percentiles;
+  for (int i = 2; i < argc; ++i)
+  {
+    percentiles.push_back(std::stod(argv[i]));
+  }
+  if (percentiles.empty())
   {
-    image = cv::imread("../../assets/1.pgm");
+    percentiles = {0.2, 0.8};
   }
-  else
+
+  if (std::filesystem::is_directory(input))
   {
-    image = cv::imread(argv[1]);
+    return runBatch(input, percentiles);
   }
+
+  // 加载图像
+  cv::Mat image = cv::imread(input, cv::IMREAD_UNCHANGED);
   if (image.empty())
   {
     std::cout << "图像加载失败" << std::endl;
@@ -20,44 +95,46 @@ int main(int argc, char **argv)
   }
 
   // 转换为灰度图像
-  cv::Mat grayImage;
-  cvtColor(image, grayImage, cv::COLOR_BGR2GRAY);
+  cv::Mat grayImage = image;
+  if (image.channels() == 3)
+  {
+    cv::cvtColor(image, grayImage, cv::COLOR_BGR2GRAY);
+  }
+  else if (image.channels() == 4)
+  {
+    cv::cvtColor(image, grayImage, cv::COLOR_BGRA2GRAY);
+  }
+  if (grayImage.depth() != CV_8U && grayImage.depth() != CV_16U)
+  {
+    std::cout << "仅支持 8 位或 16 位图像" << std::endl;
+    return -1;
+  }
 
-  // 计算直方图
-  cv::Mat histogram;
-  int histSize           = 256;      // 从0到255
-  float range[]          = {0, 256}; // 灰度级的范围
-  const float *histRange = {range};
-  bool uniform = true, accumulate = false;
-  calcHist(&grayImage, 1, 0, cv::Mat(), histogram, 1, &histSize, &histRange, uniform, accumulate);
+  // 计算直方图和CDF
+  Histogram hist;
+  computeHistogram(grayImage, hist);
 
-  // 计算CDF
-  cv::Mat cdf;
-  histogram.copyTo(cdf);
-  for (int i = 1; i < histSize; i++)
+  // 百分位阈值：CDF 上二分查找
+  for (double p : percentiles)
   {
-    cdf.at<float>(i) += cdf.at<float>(i - 1);
+    std::cout << "亮度 " << p * 100 << "% 分位阈值是: " << histogramPercentile(hist, p) << std::endl;
   }
-  cdf /= image.total(); // 归一化
+  std::cout << "平均亮度是: " << histogramMean(hist) << std::endl;
 
-  // 寻找最低亮度20%和最高亮度20%的阈值
-  float low_thresh = 0.2, high_thresh = 0.8;
-  float low_val = 0, high_val = 0;
+  // 绘制直方图，16 位图像合并为 256 个显示柱
+  const int histSize = 256;
+  const int group    = static_cast<int>(hist.counts.size()) / histSize;
+  cv::Mat histogram(histSize, 1, CV_32F);
   for (int i = 0; i < histSize; i++)
   {
-    if (cdf.at<float>(i) < low_thresh)
-    {
-      low_val = i;
-    }
-    if (cdf.at<float>(i) < high_thresh)
+    uint64_t sum = 0;
+    for (int j = 0; j < group; j++)
     {
-      high_val = i;
+      sum += hist.counts[i * group + j];
     }
+    histogram.at<float>(i) = static_cast<float>(sum);
   }
-  std::cout << "最低亮度的20%阈值是: " << low_val << std::endl;
-  std::cout << "最高亮度的20%阈值是: " << high_val << std::endl;
 
-  // 绘制直方图（在C++中通常需要额外的库如OpenCV HighGUI或其他图形库）
   int hist_w = 512, hist_h = 400;
   int bin_w = cvRound((double)hist_w / histSize);
   cv::Mat histImage(hist_h, hist_w, CV_8UC1, cv::Scalar(0, 0, 0));
@@ -0,0 +1,295 @@
+#include "image_analysis/batch_runner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+#include "image_analysis/bounded_queue.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+struct BatchItem
+{
+  size_t index = 0;
+  cv::Mat image;
+};
+
+double secondsSince(Clock::time_point start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// spins briefly, then yields, then sleeps, so idle stages do not keep their cores busy
+class Backoff
+{
+ public:
+  void wait()
+  {
+    if (spins_ < 16)
+    {
+      ++spins_;
+    }
+    else if (spins_ < 64)
+    {
+      ++spins_;
+      std::this_thread::yield();
+    }
+    else
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+  void reset() { spins_ = 0; }
+
+ private:
+  int spins_ = 0;
+};
+
+void pushWaiting(BoundedQueue<BatchItem> &queue, BatchItem &&item)
+{
+  Backoff backoff;
+  while (!queue.tryPush(std::move(item)))
+  {
+    backoff.wait();
+  }
+}
+
+/**
+ * Pops until the upstream stage has finished and the queue is drained. After done is seen no
+ * more pushes happen, so one more failed pop means the queue is empty for good.
+ */
+template <class Process>
+void drain(BoundedQueue<BatchItem> &queue, const std::atomic<bool> &done, Process process)
+{
+  Backoff backoff;
+  BatchItem item;
+  for (;;)
+  {
+    if (queue.tryPop(item))
+    {
+      backoff.reset();
+      process(std::move(item));
+      continue;
+    }
+    if (done.load(std::memory_order_acquire))
+    {
+      if (queue.tryPop(item))
+      {
+        process(std::move(item));
+        continue;
+      }
+      return;
+    }
+    backoff.wait();
+  }
+}
+
+bool readFile(const std::string &path, std::vector<uchar> &bytes)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+  {
+    return false;
+  }
+  bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return !bytes.empty();
+}
+
+// the stats of one stage, every worker adds its share when it finishes
+struct StageCounter
+{
+  std::mutex mutex;
+  BatchStageStats stats;
+
+  void add(uint64_t items, uint64_t bytes, double busy)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.items += items;
+    stats.bytes += bytes;
+    stats.busySeconds += busy;
+  }
+};
+
+// runs count workers of a stage; the last one to finish raises done
+template <class Worker>
+void startStage(std::vector<std::thread> &threads, int count, std::atomic<int> &running, std::atomic<bool> &done,
+                Worker worker)
+{
+  running = count;
+  for (int i = 0; i < count; ++i)
+  {
+    threads.emplace_back([&running, &done, worker]() {
+      worker();
+      if (running.fetch_sub(1) == 1)
+      {
+        done.store(true, std::memory_order_release);
+      }
+    });
+  }
+}
+} // namespace
+
+std::vector<std::string> readFileList(const std::string &listPath)
+{
+  std::ifstream in(listPath);
+  if (!in)
+  {
+    CV_Error(cv::Error::StsError, "cannot open file list " + listPath);
+  }
+  std::vector<std::string> paths;
+  std::string line;
+  while (std::getline(in, line))
+  {
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    line.erase(0, std::min(line.find_first_not_of(" \t"), line.size()));
+    if (!line.empty() && line[0] != '#')
+    {
+      paths.push_back(line);
+    }
+  }
+  return paths;
+}
+
+BatchStats runBatch(const std::vector<std::string> &inputs, const BatchOperator &op, const BatchOptions &options)
+{
+  CV_Assert(options.decodeThreads > 0 && options.computeThreads > 0 && options.encodeThreads > 0);
+  CV_Assert(options.queueCapacity > 0 && op);
+  std::filesystem::create_directories(options.outputDir);
+
+  BoundedQueue<BatchItem> decoded(options.queueCapacity), computed(options.queueCapacity);
+  std::atomic<size_t> next{0};
+  std::atomic<int> decoding{0}, computing{0}, encoding{0};
+  std::atomic<bool> decodeDone{false}, computeDone{false}, encodeDone{false};
+  StageCounter decodeStats, computeStats, encodeStats;
+
+  std::mutex failedMutex;
+  std::vector<std::string> failed;
+  auto fail = [&](size_t index) {
+    std::lock_guard<std::mutex> lock(failedMutex);
+    failed.push_back(inputs[index]);
+  };
+
+  const Clock::time_point start = Clock::now();
+  std::vector<std::thread> threads;
+
+  startStage(threads, options.decodeThreads, decoding, decodeDone, [&]() {
+    std::vector<uchar> bytes;
+    uint64_t items = 0, total = 0;
+    double busy = 0.0;
+    for (size_t i = next++; i < inputs.size(); i = next++)
+    {
+      const Clock::time_point t0 = Clock::now();
+      BatchItem item;
+      item.index = i;
+      // an exception would end the thread and the process with it, the item fails instead
+      try
+      {
+        if (readFile(inputs[i], bytes))
+        {
+          total += bytes.size();
+          item.image = cv::imdecode(bytes, options.readFlags);
+        }
+      }
+      catch (const std::exception &)
+      {
+        item.image.release();
+      }
+      busy += secondsSince(t0);
+      if (item.image.empty())
+      {
+        fail(i);
+        continue;
+      }
+      ++items;
+      pushWaiting(decoded, std::move(item));
+    }
+    decodeStats.add(items, total, busy);
+  });
+
+  startStage(threads, options.computeThreads, computing, computeDone, [&]() {
+    uint64_t items = 0;
+    double busy    = 0.0;
+    drain(decoded, decodeDone, [&](BatchItem &&item) {
+      const Clock::time_point t0 = Clock::now();
+      try
+      {
+        item.image = op(item.image);
+      }
+      catch (const std::exception &)
+      {
+        item.image.release();
+      }
+      busy += secondsSince(t0);
+      if (item.image.empty())
+      {
+        fail(item.index);
+        return;
+      }
+      ++items;
+      pushWaiting(computed, std::move(item));
+    });
+    computeStats.add(items, 0, busy);
+  });
+
+  startStage(threads, options.encodeThreads, encoding, encodeDone, [&]() {
+    std::vector<uchar> bytes;
+    uint64_t items = 0, total = 0;
+    double busy = 0.0;
+    drain(computed, computeDone, [&](BatchItem &&item) {
+      const Clock::time_point t0 = Clock::now();
+      bool ok = false;
+      try
+      {
+        std::filesystem::path out = std::filesystem::path(options.outputDir) / std::filesystem::path(inputs[item.index]).filename();
+        if (!options.extension.empty())
+        {
+          out.replace_extension(options.extension);
+        }
+        if (cv::imencode(out.extension().string(), item.image, bytes, options.writeParams))
+        {
+          std::ofstream file(out, std::ios::binary);
+          file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+          ok = static_cast<bool>(file);
+        }
+      }
+      catch (const std::exception &)
+      {
+        ok = false;
+      }
+      busy += secondsSince(t0);
+      if (!ok)
+      {
+        fail(item.index);
+        return;
+      }
+      ++items;
+      total += bytes.size();
+    });
+    encodeStats.add(items, total, busy);
+  });
+
+  for (std::thread &t : threads)
+  {
+    t.join();
+  }
+
+  BatchStats stats;
+  stats.seconds         = secondsSince(start);
+  stats.decode          = decodeStats.stats;
+  stats.compute         = computeStats.stats;
+  stats.encode          = encodeStats.stats;
+  stats.decode.threads  = options.decodeThreads;
+  stats.compute.threads = options.computeThreads;
+  stats.encode.threads  = options.encodeThreads;
+  stats.written         = stats.encode.items;
+  stats.failed          = std::move(failed);
+  return stats;
+}
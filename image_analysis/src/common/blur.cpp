@@ -0,0 +1,365 @@
+#include "image_analysis/blur.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace
+{
+// even and DFT-friendly, so the half spectrum has a Nyquist row and column
+int evenDftSize(int n)
+{
+  int size = cv::getOptimalDFTSize(n);
+  while (size % 2 != 0)
+  {
+    size = cv::getOptimalDFTSize(size + 1);
+  }
+  return size;
+}
+
+// spectrum sizes whose cutoffs are kept; a stream has one size, a batch of mixed images a few
+constexpr size_t kCachedCutoffs = 4;
+
+/**
+ * Low-frequency disc of one spectrum size as a cutoff per row: in unshifted row v, columns
+ * u < cutoff[v] (u = 0 .. cols / 2) lie within the radius. The last kCachedCutoffs
+ * (rows, cols, radiusRatio) are cached, most recently used first.
+ */
+std::shared_ptr<const std::vector<int>> radialCutoff(int rows, int cols, double radiusRatio)
+{
+  using Key = std::tuple<int, int, double>;
+  static std::mutex mutex;
+  static std::vector<std::pair<Key, std::shared_ptr<const std::vector<int>>>> cache;
+
+  const Key key = std::make_tuple(rows, cols, radiusRatio);
+  std::lock_guard<std::mutex> lock(mutex);
+  auto found = std::find_if(cache.begin(), cache.end(), [&key](const auto &entry) { return entry.first == key; });
+  if (found != cache.end())
+  {
+    std::rotate(cache.begin(), found, found + 1);
+    return cache.front().second;
+  }
+
+  const double r_max = radiusRatio * std::sqrt(double(rows) * rows + double(cols) * cols) / 2.0;
+  auto cutoff        = std::make_shared<std::vector<int>>(rows);
+  for (int v = 0; v < rows; ++v)
+  {
+    const double fv = v <= rows / 2 ? v : v - rows;
+    const double rem = r_max * r_max - fv * fv;
+    // first u with u^2 + fv^2 > r_max^2
+    int u = rem < 0 ? 0 : static_cast<int>(std::floor(std::sqrt(rem))) + 1;
+    while (u > 0 && double(u - 1) * (u - 1) > rem)
+    {
+      --u;
+    }
+    (*cutoff)[v] = std::min(u, cols / 2 + 1);
+  }
+  // callers still holding an evicted cutoff keep it alive through their shared_ptr
+  if (cache.size() == kCachedCutoffs)
+  {
+    cache.pop_back();
+  }
+  cache.emplace(cache.begin(), key, std::move(cutoff));
+  return cache.front().second;
+}
+
+int reflect101(int i, int n)
+{
+  if (n == 1)
+  {
+    return 0;
+  }
+  return i < 0 ? -i : (i >= n ? 2 * n - 2 - i : i);
+}
+
+struct TileSums
+{
+  int64_t grad2 = 0; // sum of Gx^2 + Gy^2
+  int64_t lap   = 0; // sum of the Laplacian
+  int64_t lap2  = 0; // sum of its square
+  int64_t count = 0;
+};
+
+// Sobel and Laplacian of one pixel from its 3x3 neighbourhood, columns xl, x, xr
+inline void accumulatePixel(const uchar *up, const uchar *mid, const uchar *down, int xl, int x, int xr,
+                            int64_t &grad2, int64_t &lap, int64_t &lap2)
+{
+  const int gx = (up[xr] + 2 * mid[xr] + down[xr]) - (up[xl] + 2 * mid[xl] + down[xl]);
+  const int gy = (down[xl] + 2 * down[x] + down[xr]) - (up[xl] + 2 * up[x] + up[xr]);
+  const int l  = up[x] + down[x] + mid[xl] + mid[xr] - 4 * mid[x];
+  grad2 += gx * gx + gy * gy;
+  lap += l;
+  lap2 += l * l;
+}
+
+void tileSums(const cv::Mat &gray, const cv::Rect &tile, TileSums &sums)
+{
+  const int rows = gray.rows, cols = gray.cols;
+  const int end  = tile.x + tile.width;
+  for (int y = tile.y; y < tile.y + tile.height; ++y)
+  {
+    const uchar *up   = gray.ptr(reflect101(y - 1, rows));
+    const uchar *mid  = gray.ptr(y);
+    const uchar *down = gray.ptr(reflect101(y + 1, rows));
+    int64_t grad2 = 0, lap = 0, lap2 = 0;
+    int x = tile.x;
+    if (x == 0)
+    {
+      accumulatePixel(up, mid, down, reflect101(-1, cols), 0, reflect101(1, cols), grad2, lap, lap2);
+      ++x;
+    }
+    // interior columns, fixed offsets so the loop vectorizes
+    const int inner = std::min(end, cols - 1);
+    for (; x < inner; ++x)
+    {
+      accumulatePixel(up, mid, down, x - 1, x, x + 1, grad2, lap, lap2);
+    }
+    if (x < end)
+    {
+      accumulatePixel(up, mid, down, x - 1, x, reflect101(x + 1, cols), grad2, lap, lap2);
+    }
+    sums.grad2 += grad2;
+    sums.lap += lap;
+    sums.lap2 += lap2;
+  }
+  sums.count += static_cast<int64_t>(tile.width) * tile.height;
+}
+
+// per-tile sums in row-major tile order, tiles in parallel
+std::vector<TileSums> computeTileSums(const cv::Mat &gray, int tileSize, int &tilesX, int &tilesY)
+{
+  CV_Assert(gray.type() == CV_8UC1 && !gray.empty() && tileSize > 0);
+  tilesX = (gray.cols + tileSize - 1) / tileSize;
+  tilesY = (gray.rows + tileSize - 1) / tileSize;
+  std::vector<TileSums> sums(static_cast<size_t>(tilesX) * tilesY);
+  const int nx = tilesX;
+  cv::parallel_for_(cv::Range(0, static_cast<int>(sums.size())), [&](const cv::Range &range) {
+    for (int i = range.start; i < range.end; ++i)
+    {
+      const int x = (i % nx) * tileSize, y = (i / nx) * tileSize;
+      tileSums(gray, cv::Rect(x, y, std::min(tileSize, gray.cols - x), std::min(tileSize, gray.rows - y)), sums[i]);
+    }
+  });
+  return sums;
+}
+
+TileSums totalSums(const cv::Mat &gray)
+{
+  int tilesX, tilesY;
+  TileSums total;
+  for (const TileSums &t : computeTileSums(gray, 64, tilesX, tilesY))
+  {
+    total.grad2 += t.grad2;
+    total.lap += t.lap;
+    total.lap2 += t.lap2;
+    total.count += t.count;
+  }
+  return total;
+}
+
+double variance(const TileSums &t)
+{
+  const double mean = double(t.lap) / t.count;
+  return std::max(0.0, double(t.lap2) / t.count - mean * mean);
+}
+
+int levelIndex(int reduction)
+{
+  switch (reduction)
+  {
+    case 1: return 0;
+    case 2: return 1;
+    case 4: return 2;
+    case 8: return 3;
+    default: CV_Error(cv::Error::StsBadArg, "blur cascade: reduction must be 1, 2, 4 or 8");
+  }
+  return 0;
+}
+
+cv::Mat downsample(const cv::Mat &gray, int reduction)
+{
+  cv::Mat small;
+  cv::resize(gray, small, cv::Size(std::max(1, gray.cols / reduction), std::max(1, gray.rows / reduction)), 0, 0, cv::INTER_AREA);
+  return small;
+}
+
+// runs the stages, level_ yields the image at one reduction (empty if unavailable); stage -1 if
+// not even the full-resolution image is available
+BlurDecision runCascade(const std::vector<BlurCascadeStage> &stages, const std::function<cv::Mat(int)> &level_)
+{
+  CV_Assert(!stages.empty());
+  std::array<cv::Mat, 4> levels;
+  BlurDecision decision;
+  for (size_t i = 0; i < stages.size(); ++i)
+  {
+    const BlurCascadeStage &stage = stages[i];
+    cv::Mat &img                  = levels[levelIndex(stage.reduction)];
+    if (img.empty())
+    {
+      img = level_(stage.reduction);
+    }
+    // an unavailable reduced level is downsampled from full resolution instead of skipped, so the
+    // decision never carries the score of an earlier, inconclusive stage
+    if (img.empty() && stage.reduction != 1)
+    {
+      cv::Mat &full = levels[0];
+      if (full.empty())
+      {
+        full = level_(1);
+      }
+      if (!full.empty())
+      {
+        img = downsample(full, stage.reduction);
+      }
+    }
+    if (img.empty())
+    {
+      return BlurDecision();
+    }
+
+    decision.score     = focusScore(img, stage.metric);
+    decision.stage     = static_cast<int>(i);
+    decision.metric    = stage.metric;
+    decision.reduction = stage.reduction;
+    decision.blurry    = decision.score < stage.threshold;
+    if (i + 1 == stages.size() || decision.score < stage.threshold / stage.band || decision.score > stage.threshold * stage.band)
+    {
+      break;
+    }
+  }
+  return decision;
+}
+} // namespace
+
+double computeBlurFFT(const cv::Mat &gray, double radiusRatio)
+{
+  CV_Assert(gray.type() == CV_8UC1 && !gray.empty());
+
+  const int rows = evenDftSize(gray.rows);
+  const int cols = evenDftSize(gray.cols);
+  cv::Mat floatImg;
+  gray.convertTo(floatImg, CV_32F);
+  if (rows != gray.rows || cols != gray.cols)
+  {
+    // mirrored, zeros would add a step edge and fake high-frequency energy
+    cv::copyMakeBorder(floatImg, floatImg, 0, rows - gray.rows, 0, cols - gray.cols, cv::BORDER_REFLECT_101);
+  }
+
+  // real input: the transform runs on half the data, the output is the full complex spectrum
+  cv::Mat spectrum;
+  cv::dft(floatImg, spectrum, cv::DFT_COMPLEX_OUTPUT);
+
+  // F(v, u) = conj F(-v, -u) and the radius is symmetric too, so columns 0 .. cols / 2 suffice:
+  // the inner ones stand for their mirror as well
+  auto cutoff      = radialCutoff(rows, cols, radiusRatio);
+  const int half   = cols / 2;
+  double total     = 0.0;
+  double highFreq  = 0.0;
+  for (int v = 0; v < rows; ++v)
+  {
+    const float *row = spectrum.ptr<float>(v);
+    const int cut    = (*cutoff)[v];
+    double low = 0.0, high = 0.0;
+    for (int u = 0; u <= half; ++u)
+    {
+      const float re   = row[2 * u];
+      const float im   = row[2 * u + 1];
+      const double mag = std::sqrt(re * re + im * im) * (u == 0 || u == half ? 1.0 : 2.0);
+      if (u < cut)
+      {
+        low += mag;
+      }
+      else
+      {
+        high += mag;
+      }
+    }
+    total += low + high;
+    highFreq += high;
+  }
+
+  return total > 0 ? highFreq / total : 0.0;
+}
+
+double laplacianVariance(const cv::Mat &gray)
+{
+  return variance(totalSums(gray));
+}
+
+double tenengrad(const cv::Mat &gray)
+{
+  const TileSums total = totalSums(gray);
+  return double(total.grad2) / total.count;
+}
+
+void computeBlurMap(const cv::Mat &gray, cv::Mat &tenengradMap, cv::Mat &laplacianMap, int tileSize)
+{
+  int tilesX, tilesY;
+  const std::vector<TileSums> sums = computeTileSums(gray, tileSize, tilesX, tilesY);
+  tenengradMap.create(tilesY, tilesX, CV_32F);
+  laplacianMap.create(tilesY, tilesX, CV_32F);
+  for (int ty = 0; ty < tilesY; ++ty)
+  {
+    float *ten = tenengradMap.ptr<float>(ty);
+    float *lap = laplacianMap.ptr<float>(ty);
+    for (int tx = 0; tx < tilesX; ++tx)
+    {
+      const TileSums &t = sums[ty * tilesX + tx];
+      ten[tx]           = static_cast<float>(double(t.grad2) / t.count);
+      lap[tx]           = static_cast<float>(variance(t));
+    }
+  }
+}
+
+const char *focusMetricName(FocusMetric metric)
+{
+  switch (metric)
+  {
+    case FocusMetric::Laplacian: return "Laplacian";
+    case FocusMetric::Tenengrad: return "Tenengrad";
+    case FocusMetric::FFT: return "FFT";
+  }
+  return "";
+}
+
+double focusScore(const cv::Mat &gray, FocusMetric metric)
+{
+  switch (metric)
+  {
+    case FocusMetric::Laplacian: return laplacianVariance(gray);
+    case FocusMetric::Tenengrad: return tenengrad(gray);
+    case FocusMetric::FFT: return computeBlurFFT(gray);
+  }
+  return 0.0;
+}
+
+std::vector<BlurCascadeStage> defaultBlurCascade()
+{
+  return {
+    {FocusMetric::Laplacian, 4, 400.0, 2.5},
+    {FocusMetric::Laplacian, 1, 100.0, 2.0},
+    {FocusMetric::FFT, 1, 0.05, 1.0},
+  };
+}
+
+BlurDecision judgeBlurCascade(const cv::Mat &gray, const std::vector<BlurCascadeStage> &stages)
+{
+  CV_Assert(gray.type() == CV_8UC1 && !gray.empty());
+  return runCascade(stages, [&gray](int reduction) { return reduction == 1 ? gray : downsample(gray, reduction); });
+}
+
+bool judgeBlurCascade(const std::string &path, BlurDecision &decision, const std::vector<BlurCascadeStage> &stages)
+{
+  static const int flags[4] = {cv::IMREAD_GRAYSCALE, cv::IMREAD_REDUCED_GRAYSCALE_2, cv::IMREAD_REDUCED_GRAYSCALE_4, cv::IMREAD_REDUCED_GRAYSCALE_8};
+  decision = runCascade(stages, [&path](int reduction) {
+    return cv::imread(path, flags[levelIndex(reduction)]);
+  });
+  return decision.stage >= 0;
+}
@@ -0,0 +1,209 @@
+#include "image_analysis/clahe.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+constexpr int kLevels = 256;
+
+// BORDER_REFLECT_101 for any distance outside [0, n)
+int reflect101(int i, int n)
+{
+  if (n == 1)
+  {
+    return 0;
+  }
+  while (i < 0 || i >= n)
+  {
+    i = i < 0 ? -i : 2 * n - 2 - i;
+  }
+  return i;
+}
+
+struct GrayLuma
+{
+  static int at(const uchar *row, int x) { return row[x]; }
+};
+
+// BT.601 in 8-bit fixed point, the weights sum to 256
+struct BgrLuma
+{
+  static int at(const uchar *row, int x)
+  {
+    const uchar *p = row + 3 * x;
+    return (29 * p[0] + 150 * p[1] + 77 * p[2] + 128) >> 8;
+  }
+};
+
+/**
+ * Tile geometry and the clipped, equalized table of every tile. As in cv::CLAHE, an image that
+ * does not divide into the grid is treated as padded (reflected) up to the next larger multiple
+ * in both directions; on a side that does divide, that still adds a pixel to every tile.
+ */
+struct ClaheTiles
+{
+  int tilesX, tilesY;
+  int tileW, tileH;
+  std::vector<uchar> luts; // kLevels entries per tile, row-major tiles
+};
+
+template <class Luma>
+ClaheTiles buildTiles(const cv::Mat &src, double clipLimit, cv::Size grid)
+{
+  CV_Assert(grid.width > 0 && grid.height > 0);
+  ClaheTiles t;
+  t.tilesX = grid.width;
+  t.tilesY = grid.height;
+  const bool padded = src.cols % t.tilesX != 0 || src.rows % t.tilesY != 0;
+  t.tileW           = src.cols / t.tilesX + padded;
+  t.tileH           = src.rows / t.tilesY + padded;
+  t.luts.resize(static_cast<size_t>(t.tilesX) * t.tilesY * kLevels);
+
+  const int area        = t.tileW * t.tileH;
+  const float lutScale  = static_cast<float>(kLevels - 1) / area;
+  int clip              = 0;
+  if (clipLimit > 0.0)
+  {
+    clip = std::max(static_cast<int>(clipLimit * area / kLevels), 1);
+  }
+
+  cv::parallel_for_(cv::Range(0, t.tilesX * t.tilesY), [&](const cv::Range &range) {
+    int hist[kLevels];
+    for (int tile = range.start; tile < range.end; ++tile)
+    {
+      const int x0 = (tile % t.tilesX) * t.tileW, y0 = (tile / t.tilesX) * t.tileH;
+      const int xInside = std::min(x0 + t.tileW, src.cols);
+      std::fill(hist, hist + kLevels, 0);
+      for (int y = y0; y < y0 + t.tileH; ++y)
+      {
+        const uchar *row = src.ptr<uchar>(reflect101(y, src.rows));
+        int x            = x0;
+        for (; x < xInside; ++x)
+        {
+          ++hist[Luma::at(row, x)];
+        }
+        for (; x < x0 + t.tileW; ++x)
+        {
+          ++hist[Luma::at(row, reflect101(x, src.cols))];
+        }
+      }
+
+      // clip and spread the excess evenly, the remainder one count at a time
+      if (clip > 0)
+      {
+        int clipped = 0;
+        for (int i = 0; i < kLevels; ++i)
+        {
+          if (hist[i] > clip)
+          {
+            clipped += hist[i] - clip;
+            hist[i] = clip;
+          }
+        }
+        const int batch = clipped / kLevels;
+        int residual    = clipped - batch * kLevels;
+        for (int i = 0; i < kLevels; ++i)
+        {
+          hist[i] += batch;
+        }
+        if (residual != 0)
+        {
+          const int step = std::max(kLevels / residual, 1);
+          for (int i = 0; i < kLevels && residual > 0; i += step, --residual)
+          {
+            ++hist[i];
+          }
+        }
+      }
+
+      uchar *lut = &t.luts[static_cast<size_t>(tile) * kLevels];
+      int sum    = 0;
+      for (int i = 0; i < kLevels; ++i)
+      {
+        sum += hist[i];
+        lut[i] = cv::saturate_cast<uchar>(sum * lutScale);
+      }
+    }
+  });
+  return t;
+}
+
+/**
+ * Bilinear blend of the four nearest tile tables for every pixel, rows in parallel. write(y, x,
+ * luma, level) receives the input level of the pixel and its blended (unrounded) output level.
+ */
+template <class Luma, class Write>
+void mapTiles(const cv::Mat &src, const ClaheTiles &t, Write write)
+{
+  // per column: offsets of the left/right tile tables and their weights
+  std::vector<int> left(src.cols), right(src.cols);
+  std::vector<float> wRight(src.cols), wLeft(src.cols);
+  const float invW = 1.0f / t.tileW, invH = 1.0f / t.tileH;
+  for (int x = 0; x < src.cols; ++x)
+  {
+    const float txf = x * invW - 0.5f;
+    const int tx1   = cvFloor(txf);
+    wRight[x]       = txf - tx1;
+    wLeft[x]        = 1.0f - wRight[x];
+    left[x]         = std::max(tx1, 0) * kLevels;
+    right[x]        = std::min(tx1 + 1, t.tilesX - 1) * kLevels;
+  }
+
+  cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range &range) {
+    for (int y = range.start; y < range.end; ++y)
+    {
+      const float tyf = y * invH - 0.5f;
+      const int ty1   = cvFloor(tyf);
+      const float ya  = tyf - ty1, ya1 = 1.0f - ya;
+      const uchar *top    = &t.luts[static_cast<size_t>(std::max(ty1, 0)) * t.tilesX * kLevels];
+      const uchar *bottom = &t.luts[static_cast<size_t>(std::min(ty1 + 1, t.tilesY - 1)) * t.tilesX * kLevels];
+      const uchar *row    = src.ptr<uchar>(y);
+      for (int x = 0; x < src.cols; ++x)
+      {
+        const int v     = Luma::at(row, x);
+        const float res = (top[left[x] + v] * wLeft[x] + top[right[x] + v] * wRight[x]) * ya1
+                          + (bottom[left[x] + v] * wLeft[x] + bottom[right[x] + v] * wRight[x]) * ya;
+        write(y, x, v, res);
+      }
+    }
+  });
+}
+} // namespace
+
+void claheGray(const cv::Mat &src, cv::Mat &dst, double clipLimit, cv::Size tileGridSize)
+{
+  CV_Assert(src.type() == CV_8UC1 && !src.empty());
+  const ClaheTiles tiles = buildTiles<GrayLuma>(src, clipLimit, tileGridSize);
+  // the tables are complete before any pixel is written, so dst may alias src
+  dst.create(src.size(), CV_8UC1);
+  mapTiles<GrayLuma>(src, tiles, [&dst](int y, int x, int, float level) {
+    dst.ptr<uchar>(y)[x] = cv::saturate_cast<uchar>(level);
+  });
+}
+
+void claheColorInPlace(cv::Mat &bgr, double clipLimit, cv::Size tileGridSize)
+{
+  CV_Assert(bgr.type() == CV_8UC3 && !bgr.empty());
+  const ClaheTiles tiles = buildTiles<BgrLuma>(bgr, clipLimit, tileGridSize);
+
+  float inverse[kLevels];
+  inverse[0] = 0.0f;
+  for (int i = 1; i < kLevels; ++i)
+  {
+    inverse[i] = 1.0f / i;
+  }
+  // the luma of a pixel is read before the pixel is rewritten
+  mapTiles<BgrLuma>(bgr, tiles, [&bgr, &inverse](int y, int x, int luma, float level) {
+    uchar *p = bgr.ptr<uchar>(y) + 3 * x;
+    if (luma == 0)
+    {
+      p[0] = p[1] = p[2] = cv::saturate_cast<uchar>(level);
+      return;
+    }
+    const float gain = level * inverse[luma];
+    p[0]             = cv::saturate_cast<uchar>(p[0] * gain);
+    p[1]             = cv::saturate_cast<uchar>(p[1] * gain);
+    p[2]             = cv::saturate_cast<uchar>(p[2] * gain);
+  });
+}
@@ -0,0 +1,276 @@
+#include "image_analysis/color_lut.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+/**
+ * Tetrahedron of the unit cube that holds (fr, fg, fb): the vertices are 000, o1, o2 and 111 as
+ * offsets from the cell origin, w the barycentric weights. The cube is split along its main
+ * diagonal into six tetrahedra, picked by the order of the three fractions.
+ */
+struct Tetrahedron
+{
+  int o1, o2;
+  float w0, w1, w2, w3;
+};
+
+inline Tetrahedron tetrahedron(float fr, float fg, float fb, int dr, int dg, int db)
+{
+  if (fr > fg)
+  {
+    if (fg > fb)
+    {
+      return {dr, dr + dg, 1 - fr, fr - fg, fg - fb, fb};
+    }
+    if (fr > fb)
+    {
+      return {dr, dr + db, 1 - fr, fr - fb, fb - fg, fg};
+    }
+    return {db, dr + db, 1 - fb, fb - fr, fr - fg, fg};
+  }
+  if (fb > fg)
+  {
+    return {db, dg + db, 1 - fb, fb - fg, fg - fr, fr};
+  }
+  if (fb > fr)
+  {
+    return {dg, dg + db, 1 - fg, fg - fb, fb - fr, fr};
+  }
+  return {dg, dr + dg, 1 - fg, fg - fr, fr - fb, fb};
+}
+
+// grid cell and fraction of a coordinate in [0, 1], the last cell takes the upper edge
+inline void cell(float v, int size, int &index, float &fraction)
+{
+  const float pos = std::max(0.0f, std::min(1.0f, v)) * (size - 1);
+  index           = std::min(static_cast<int>(pos), size - 2);
+  fraction        = pos - index;
+}
+} // namespace
+
+ColorLut3D::ColorLut3D(int size) :
+  size_(size)
+{
+  CV_Assert(size >= 2 && size <= 256);
+  bake([](const cv::Vec3f &rgb) { return rgb; });
+}
+
+void ColorLut3D::bake(const Transform &transform)
+{
+  data_.resize(static_cast<size_t>(size_) * size_ * size_);
+  const float scale = 1.0f / (size_ - 1);
+  cv::parallel_for_(cv::Range(0, size_), [&](const cv::Range &range) {
+    for (int b = range.start; b < range.end; ++b)
+    {
+      for (int g = 0; g < size_; ++g)
+      {
+        for (int r = 0; r < size_; ++r)
+        {
+          const cv::Vec3f out = transform(cv::Vec3f(r * scale, g * scale, b * scale));
+          cv::Vec4f &entry    = data_[(static_cast<size_t>(b) * size_ + g) * size_ + r];
+          for (int c = 0; c < 3; ++c)
+          {
+            entry[c] = std::max(0.0f, std::min(1.0f, out[c]));
+          }
+          entry[3] = 0.0f;
+        }
+      }
+    }
+  });
+}
+
+cv::Vec3f ColorLut3D::at(int r, int g, int b) const
+{
+  const cv::Vec4f &entry = data_[(static_cast<size_t>(b) * size_ + g) * size_ + r];
+  return cv::Vec3f(entry[0], entry[1], entry[2]);
+}
+
+cv::Vec3f ColorLut3D::sample(const cv::Vec3f &rgb) const
+{
+  int ir, ig, ib;
+  float fr, fg, fb;
+  cell(rgb[0], size_, ir, fr);
+  cell(rgb[1], size_, ig, fg);
+  cell(rgb[2], size_, ib, fb);
+  const int dg = size_, db = size_ * size_;
+  const Tetrahedron t   = tetrahedron(fr, fg, fb, 1, dg, db);
+  const cv::Vec4f *base = &data_[(static_cast<size_t>(ib) * size_ + ig) * size_ + ir];
+  cv::Vec3f rgbOut;
+  for (int c = 0; c < 3; ++c)
+  {
+    rgbOut[c] = base[0][c] * t.w0 + base[t.o1][c] * t.w1 + base[t.o2][c] * t.w2 + base[1 + dg + db][c] * t.w3;
+  }
+  return rgbOut;
+}
+
+void ColorLut3D::apply(const cv::Mat &srcBGR8, cv::Mat &dst) const
+{
+  CV_Assert(srcBGR8.type() == CV_8UC3);
+  dst.create(srcBGR8.size(), CV_8UC3);
+
+  // cell and fraction of every 8-bit level, shared by the three channels
+  int index[256];
+  float fraction[256];
+  for (int v = 0; v < 256; ++v)
+  {
+    cell(v / 255.0f, size_, index[v], fraction[v]);
+  }
+
+  const int dg = size_, db = size_ * size_, d111 = 1 + dg + db;
+  const float *data = &data_[0][0];
+  cv::parallel_for_(cv::Range(0, srcBGR8.rows), [&](const cv::Range &range) {
+    for (int y = range.start; y < range.end; ++y)
+    {
+      const uchar *src = srcBGR8.ptr<uchar>(y);
+      uchar *out       = dst.ptr<uchar>(y);
+      for (int x = 0; x < srcBGR8.cols; ++x, src += 3, out += 3)
+      {
+        const int b = src[0], g = src[1], r = src[2];
+        const Tetrahedron t = tetrahedron(fraction[r], fraction[g], fraction[b], 1, dg, db);
+        const float *base   = data + 4 * ((index[b] * size_ + index[g]) * size_ + index[r]);
+#ifdef __SSE2__
+        // the four vertices as weighted RGBx vectors, then round and saturate to bytes
+        __m128 c = _mm_mul_ps(_mm_loadu_ps(base), _mm_set1_ps(t.w0 * 255.0f));
+        c        = _mm_add_ps(c, _mm_mul_ps(_mm_loadu_ps(base + 4 * t.o1), _mm_set1_ps(t.w1 * 255.0f)));
+        c        = _mm_add_ps(c, _mm_mul_ps(_mm_loadu_ps(base + 4 * t.o2), _mm_set1_ps(t.w2 * 255.0f)));
+        c        = _mm_add_ps(c, _mm_mul_ps(_mm_loadu_ps(base + 4 * d111), _mm_set1_ps(t.w3 * 255.0f)));
+        __m128i v = _mm_cvtps_epi32(c);
+        v         = _mm_packus_epi16(_mm_packs_epi32(v, v), v);
+        const int rgbx = _mm_cvtsi128_si32(v);
+        out[0]         = static_cast<uchar>(rgbx >> 16);
+        out[1]         = static_cast<uchar>(rgbx >> 8);
+        out[2]         = static_cast<uchar>(rgbx);
+#else
+        for (int c = 0; c < 3; ++c)
+        {
+          const float value = base[c] * t.w0 + base[4 * t.o1 + c] * t.w1 + base[4 * t.o2 + c] * t.w2 + base[4 * d111 + c] * t.w3;
+          out[2 - c]        = cv::saturate_cast<uchar>(value * 255.0f);
+        }
+#endif
+      }
+    }
+  });
+}
+
+bool ColorLut3D::load(const std::string &path)
+{
+  std::ifstream in(path);
+  if (!in)
+  {
+    return false;
+  }
+
+  int size = 0;
+  std::string title;
+  std::vector<cv::Vec4f> values;
+  std::string line;
+  while (std::getline(in, line))
+  {
+    if (!line.empty() && line.back() == '\r')
+    {
+      line.pop_back();
+    }
+    const size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line[start] == '#')
+    {
+      continue;
+    }
+
+    std::istringstream ss(line.substr(start));
+    if (std::isdigit(static_cast<unsigned char>(line[start])) || line[start] == '-' || line[start] == '.')
+    {
+      // the table stores the clamped output of bake(), a value outside [0, 1] (or nan) is refused
+      // rather than silently changed; so is a fourth number on the line
+      cv::Vec4f v(0, 0, 0, 0);
+      std::string extra;
+      if (!(ss >> v[0] >> v[1] >> v[2]) || (ss >> extra))
+      {
+        return false;
+      }
+      for (int c = 0; c < 3; ++c)
+      {
+        if (!(v[c] >= 0.0f && v[c] <= 1.0f))
+        {
+          return false;
+        }
+      }
+      values.push_back(v);
+      continue;
+    }
+
+    std::string key;
+    ss >> key;
+    if (key == "TITLE")
+    {
+      const size_t open = line.find('"'), close = line.rfind('"');
+      title = open != std::string::npos && close > open ? line.substr(open + 1, close - open - 1) : std::string();
+    }
+    else if (key == "LUT_3D_SIZE")
+    {
+      ss >> size;
+    }
+    else if (key == "DOMAIN_MIN" || key == "DOMAIN_MAX")
+    {
+      const float expected = key == "DOMAIN_MIN" ? 0.0f : 1.0f;
+      float a, b, c;
+      if (!(ss >> a >> b >> c) || a != expected || b != expected || c != expected)
+      {
+        return false;
+      }
+    }
+    else if (key == "LUT_3D_INPUT_RANGE")
+    {
+      float lo, hi;
+      if (!(ss >> lo >> hi) || lo != 0.0f || hi != 1.0f)
+      {
+        return false;
+      }
+    }
+    else
+    {
+      // LUT_1D_SIZE, LUT_1D_INPUT_RANGE and keywords of other tools
+      return false;
+    }
+  }
+
+  if (size < 2 || size > 256 || values.size() != static_cast<size_t>(size) * size * size)
+  {
+    return false;
+  }
+  size_  = size;
+  title_ = title;
+  data_  = std::move(values);
+  return true;
+}
+
+bool ColorLut3D::save(const std::string &path) const
+{
+  std::ofstream out(path);
+  if (!out)
+  {
+    return false;
+  }
+  if (!title_.empty())
+  {
+    out << "TITLE \"" << title_ << "\"\n";
+  }
+  out << "LUT_3D_SIZE " << size_ << "\n";
+  out << "DOMAIN_MIN 0.0 0.0 0.0\n";
+  out << "DOMAIN_MAX 1.0 1.0 1.0\n";
+  out << std::fixed << std::setprecision(6);
+  for (const cv::Vec4f &v : data_)
+  {
+    out << v[0] << " " << v[1] << " " << v[2] << "\n";
+  }
+  return out.good();
+}
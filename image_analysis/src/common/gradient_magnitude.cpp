@@ -0,0 +1,105 @@
+#include "image_analysis/gradient_magnitude.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <mutex>
+
+namespace
+{
+int reflect101(int i, int n)
+{
+  if (n == 1)
+  {
+    return 0;
+  }
+  return i < 0 ? -i : (i >= n ? 2 * n - 2 - i : i);
+}
+
+// Gx^2 + Gy^2 of pixel x from its 3x3 neighbourhood, side / centre are the smoothing weights
+template <int Side, int Centre>
+inline int squaredGradient(const uchar *up, const uchar *mid, const uchar *down, int xl, int x, int xr)
+{
+  const int gx = Side * (up[xr] + down[xr]) + Centre * mid[xr] - Side * (up[xl] + down[xl]) - Centre * mid[xl];
+  const int gy = Side * (down[xl] + down[xr]) + Centre * down[x] - Side * (up[xl] + up[xr]) - Centre * up[x];
+  return gx * gx + gy * gy;
+}
+
+/**
+ * Runs op(y, x, squared magnitude) over all pixels, rows in parallel. Interior columns pass fixed
+ * offsets so the loop vectorizes, the two border columns reflect.
+ */
+template <int Side, int Centre, class Op>
+void forEachGradient(const cv::Mat &gray, const cv::Range &range, Op op)
+{
+  const int rows = gray.rows, cols = gray.cols;
+  for (int y = range.start; y < range.end; ++y)
+  {
+    const uchar *up   = gray.ptr<uchar>(reflect101(y - 1, rows));
+    const uchar *mid  = gray.ptr<uchar>(y);
+    const uchar *down = gray.ptr<uchar>(reflect101(y + 1, rows));
+    op(y, 0, squaredGradient<Side, Centre>(up, mid, down, reflect101(-1, cols), 0, reflect101(1, cols)));
+    for (int x = 1; x < cols - 1; ++x)
+    {
+      op(y, x, squaredGradient<Side, Centre>(up, mid, down, x - 1, x, x + 1));
+    }
+    if (cols > 1)
+    {
+      op(y, cols - 1, squaredGradient<Side, Centre>(up, mid, down, cols - 2, cols - 1, reflect101(cols, cols)));
+    }
+  }
+}
+
+template <int Side, int Centre>
+void magnitude8u(const cv::Mat &gray, cv::Mat &dst, double range)
+{
+  float scale = 0.0f, shift = 0.0f;
+  if (range > 0.0)
+  {
+    scale = static_cast<float>(255.0 / range);
+  }
+  else
+  {
+    // extremes of the squared magnitude, the square root is monotonic
+    std::mutex mutex;
+    int minSq = INT_MAX, maxSq = 0;
+    cv::parallel_for_(cv::Range(0, gray.rows), [&](const cv::Range &r) {
+      int lo = INT_MAX, hi = 0;
+      forEachGradient<Side, Centre>(gray, r, [&lo, &hi](int, int, int sq) {
+        lo = std::min(lo, sq);
+        hi = std::max(hi, sq);
+      });
+      std::lock_guard<std::mutex> lock(mutex);
+      minSq = std::min(minSq, lo);
+      maxSq = std::max(maxSq, hi);
+    });
+    // as cv::normalize: extremes of the float magnitude, scale and shift in double, applied in float
+    const double lo = std::sqrt(static_cast<float>(minSq)), hi = std::sqrt(static_cast<float>(maxSq));
+    const double s  = 255.0 * (hi - lo > DBL_EPSILON ? 1.0 / (hi - lo) : 0.0);
+    scale           = static_cast<float>(s);
+    shift           = static_cast<float>(-lo * s);
+  }
+
+  cv::parallel_for_(cv::Range(0, gray.rows), [&](const cv::Range &r) {
+    forEachGradient<Side, Centre>(gray, r, [&dst, scale, shift](int y, int x, int sq) {
+      dst.ptr<uchar>(y)[x] = cv::saturate_cast<uchar>(std::sqrt(static_cast<float>(sq)) * scale + shift);
+    });
+  });
+}
+} // namespace
+
+void gradientMagnitude(const cv::Mat &gray, cv::Mat &dst, GradientKernel kernel, double range)
+{
+  CV_Assert(gray.type() == CV_8UC1 && !gray.empty() && range >= 0.0);
+  dst.create(gray.size(), CV_8UC1);
+  CV_Assert(dst.data != gray.data);
+  if (kernel == GradientKernel::Scharr)
+  {
+    magnitude8u<3, 10>(gray, dst, range);
+  }
+  else
+  {
+    magnitude8u<1, 2>(gray, dst, range);
+  }
+}
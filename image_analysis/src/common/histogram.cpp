@@ -0,0 +1,174 @@
+#include "image_analysis/histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace
+{
+// one stripe per thread, so every thread allocates its sub-histograms once
+template <typename CountRows>
+void countStripes(const cv::Mat &img, Histogram &hist, CountRows count_rows)
+{
+  std::mutex merge_mutex;
+  const int n_stripes = std::max(1, std::min(cv::getNumThreads(), img.rows));
+  cv::parallel_for_(cv::Range(0, img.rows), [&](const cv::Range &range) {
+    std::vector<uint32_t> local;
+    count_rows(range, local);
+    std::lock_guard<std::mutex> lock(merge_mutex);
+    for (size_t v = 0; v < hist.counts.size(); ++v)
+    {
+      hist.counts[v] += local[v];
+    }
+  }, n_stripes);
+}
+} // namespace
+
+void computeHistogram(const cv::Mat &img, Histogram &hist, int sample_step)
+{
+  CV_Assert(img.type() == CV_8UC1 || img.type() == CV_16UC1);
+  CV_Assert(sample_step >= 1);
+  // per-thread counters are 32-bit
+  CV_Assert(img.total() < UINT32_MAX);
+
+  const int bins = img.depth() == CV_8U ? 256 : 65536;
+  hist.counts.assign(bins, 0);
+  const int cols = img.cols;
+
+  if (sample_step > 1)
+  {
+    // strided loads gain nothing from the interleaved tables
+    countStripes(img, hist, [&](const cv::Range &range, std::vector<uint32_t> &local) {
+      local.assign(bins, 0);
+      for (int r = range.start; r < range.end; ++r)
+      {
+        if (img.depth() == CV_8U)
+        {
+          const uchar *p = img.ptr<uchar>(r);
+          for (int c = r % sample_step; c < cols; c += sample_step)
+          {
+            ++local[p[c]];
+          }
+        }
+        else
+        {
+          const ushort *p = img.ptr<ushort>(r);
+          for (int c = r % sample_step; c < cols; c += sample_step)
+          {
+            ++local[p[c]];
+          }
+        }
+      }
+    });
+  }
+  else if (img.depth() == CV_8U)
+  {
+    countStripes(img, hist, [&](const cv::Range &range, std::vector<uint32_t> &local) {
+      // four tables take consecutive pixels, an increment never waits on the previous one
+      local.assign(4 * 256, 0);
+      uint32_t *t0 = local.data(), *t1 = t0 + 256, *t2 = t1 + 256, *t3 = t2 + 256;
+      for (int r = range.start; r < range.end; ++r)
+      {
+        const uchar *p = img.ptr<uchar>(r);
+        int c          = 0;
+        for (; c + 4 <= cols; c += 4)
+        {
+          ++t0[p[c]];
+          ++t1[p[c + 1]];
+          ++t2[p[c + 2]];
+          ++t3[p[c + 3]];
+        }
+        for (; c < cols; ++c)
+        {
+          ++t0[p[c]];
+        }
+      }
+      for (int v = 0; v < 256; ++v)
+      {
+        t0[v] += t1[v] + t2[v] + t3[v];
+      }
+    });
+  }
+  else
+  {
+    // 65536 bins: a single table per thread, four would no longer fit in L2
+    countStripes(img, hist, [&](const cv::Range &range, std::vector<uint32_t> &local) {
+      local.assign(65536, 0);
+      for (int r = range.start; r < range.end; ++r)
+      {
+        const ushort *p = img.ptr<ushort>(r);
+        for (int c = 0; c < cols; ++c)
+        {
+          ++local[p[c]];
+        }
+      }
+    });
+  }
+
+  buildCdf(hist);
+}
+
+void buildCdf(Histogram &hist)
+{
+  hist.cdf.resize(hist.counts.size());
+  uint64_t acc = 0;
+  for (size_t v = 0; v < hist.counts.size(); ++v)
+  {
+    acc += hist.counts[v];
+    hist.cdf[v] = acc;
+  }
+  hist.total = acc;
+}
+
+int histogramPercentile(const Histogram &hist, double p)
+{
+  if (hist.total == 0)
+  {
+    return 0;
+  }
+  p                     = std::clamp(p, 0.0, 1.0);
+  // at least one pixel, so p = 0 gives the darkest value present
+  const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * static_cast<double>(hist.total))));
+  return static_cast<int>(std::lower_bound(hist.cdf.begin(), hist.cdf.end(), target) - hist.cdf.begin());
+}
+
+double histogramQuantile(const Histogram &hist, double p)
+{
+  if (hist.total == 0)
+  {
+    return 0.0;
+  }
+  const double pos  = std::clamp(p, 0.0, 1.0) * static_cast<double>(hist.total - 1);
+  const uint64_t k  = static_cast<uint64_t>(pos);
+  // the value of rank r (from 0) is the first one whose cumulative count exceeds r
+  auto valueOfRank  = [&hist](uint64_t r) {
+    return static_cast<double>(std::upper_bound(hist.cdf.begin(), hist.cdf.end(), r) - hist.cdf.begin());
+  };
+  const double low  = valueOfRank(k);
+  const double high = k + 1 < hist.total ? valueOfRank(k + 1) : low;
+  return low + (pos - static_cast<double>(k)) * (high - low);
+}
+
+double histogramMean(const Histogram &hist)
+{
+  if (hist.total == 0)
+  {
+    return 0.0;
+  }
+  double sum = 0;
+  for (size_t v = 0; v < hist.counts.size(); ++v)
+  {
+    sum += static_cast<double>(v) * hist.counts[v];
+  }
+  return sum / hist.total;
+}
+
+double percentileErrorBound(double n, double confidence)
+{
+  CV_Assert(confidence > 0 && confidence < 1);
+  if (n <= 0)
+  {
+    return 1.0;
+  }
+  return std::min(1.0, std::sqrt(std::log(2.0 / (1.0 - confidence)) / (2.0 * n)));
+}
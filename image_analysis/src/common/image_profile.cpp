@@ -0,0 +1,152 @@
+#include "image_analysis/image_profile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "image_analysis/histogram.h"
+
+namespace
+{
+int reflect101(int i, int n)
+{
+  if (n == 1)
+  {
+    return 0;
+  }
+  return i < 0 ? -i : (i >= n ? 2 * n - 2 - i : i);
+}
+
+// per-stripe sums, merged once per stripe
+struct ProfileSums
+{
+  uint64_t sum   = 0;
+  uint64_t sumSq = 0;
+  int64_t lap    = 0;
+  int64_t lapSq  = 0;
+  uint64_t value = 0;
+  uint64_t gray[256] = {};
+};
+
+// pixel x of a row of cn channels, xl / xr its neighbour columns
+template <int cn>
+inline void profilePixel(const uchar *up, const uchar *mid, const uchar *down, int xl, int x, int xr,
+                         std::atomic<uint64_t> *colors, ProfileSums &s)
+{
+  const uchar *p = mid + cn * x;
+  uint32_t key   = 0;
+  int maxValue   = 0;
+  for (int c = 0; c < cn; ++c)
+  {
+    const int v = p[c];
+    key         = (key << 8) | v;
+    maxValue    = std::max(maxValue, v);
+    s.sum += v;
+    s.sumSq += v * v;
+    const int l = up[cn * x + c] + down[cn * x + c] + mid[cn * xl + c] + mid[cn * xr + c] - 4 * v;
+    s.lap += l;
+    s.lapSq += l * l;
+  }
+  s.value += maxValue;
+  if (cn == 3)
+  {
+    ++s.gray[(p[0] * 1868 + p[1] * 9617 + p[2] * 4899 + (1 << 13)) >> 14];
+  }
+  else
+  {
+    ++s.gray[p[0]];
+  }
+
+  // most pixels repeat a color already seen, so the atomic write is the rare case
+  const uint64_t bit          = uint64_t(1) << (key & 63);
+  std::atomic<uint64_t> &word = colors[key >> 6];
+  if (!(word.load(std::memory_order_relaxed) & bit))
+  {
+    word.fetch_or(bit, std::memory_order_relaxed);
+  }
+}
+
+template <int cn>
+void profileRow(const uchar *up, const uchar *mid, const uchar *down, int cols, std::atomic<uint64_t> *colors,
+                ProfileSums &s)
+{
+  profilePixel<cn>(up, mid, down, reflect101(-1, cols), 0, reflect101(1, cols), colors, s);
+  for (int x = 1; x < cols - 1; ++x)
+  {
+    profilePixel<cn>(up, mid, down, x - 1, x, x + 1, colors, s);
+  }
+  if (cols > 1)
+  {
+    profilePixel<cn>(up, mid, down, cols - 2, cols - 1, reflect101(cols, cols), colors, s);
+  }
+}
+} // namespace
+
+ImageProfile computeImageProfile(const cv::Mat &img, Histogram *grayHist)
+{
+  CV_Assert((img.type() == CV_8UC1 || img.type() == CV_8UC3) && !img.empty());
+  const int rows = img.rows, cols = img.cols, cn = img.channels();
+
+  const size_t words = (size_t(1) << (8 * cn)) / 64 + 1;
+  std::unique_ptr<std::atomic<uint64_t>[]> colors(new std::atomic<uint64_t>[words]());
+  ProfileSums total;
+  std::mutex mutex;
+  cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range &range) {
+    ProfileSums s;
+    for (int y = range.start; y < range.end; ++y)
+    {
+      const uchar *up   = img.ptr<uchar>(reflect101(y - 1, rows));
+      const uchar *mid  = img.ptr<uchar>(y);
+      const uchar *down = img.ptr<uchar>(reflect101(y + 1, rows));
+      if (cn == 3)
+      {
+        profileRow<3>(up, mid, down, cols, colors.get(), s);
+      }
+      else
+      {
+        profileRow<1>(up, mid, down, cols, colors.get(), s);
+      }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    total.sum += s.sum;
+    total.sumSq += s.sumSq;
+    total.lap += s.lap;
+    total.lapSq += s.lapSq;
+    total.value += s.value;
+    for (int v = 0; v < 256; ++v)
+    {
+      total.gray[v] += s.gray[v];
+    }
+  });
+
+  ImageProfile profile;
+  profile.rows     = rows;
+  profile.cols     = cols;
+  profile.channels = cn;
+  for (size_t w = 0; w < words; ++w)
+  {
+    profile.uniqueColors += __builtin_popcountll(colors[w].load(std::memory_order_relaxed));
+  }
+
+  const double pixels  = static_cast<double>(rows) * cols;
+  const double samples = pixels * cn;
+  const double mean    = total.sum / samples;
+  profile.stddev       = std::sqrt(std::max(0.0, total.sumSq / samples - mean * mean));
+  const double lapMean = total.lap / samples;
+  profile.laplacianVariance = std::max(0.0, total.lapSq / samples - lapMean * lapMean);
+  profile.meanBrightness    = total.value / pixels;
+
+  Histogram hist;
+  hist.counts.assign(total.gray, total.gray + 256);
+  buildCdf(hist);
+  profile.p5  = histogramQuantile(hist, 0.05);
+  profile.p95 = histogramQuantile(hist, 0.95);
+  if (grayHist)
+  {
+    *grayHist = std::move(hist);
+  }
+  return profile;
+}
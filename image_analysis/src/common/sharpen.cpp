@@ -0,0 +1,152 @@
+#include "image_analysis/sharpen.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+int reflect101(int i, int n)
+{
+  if (n == 1)
+  {
+    return 0;
+  }
+  while (i < 0 || i >= n)
+  {
+    i = i < 0 ? -i : 2 * n - 2 - i;
+  }
+  return i;
+}
+
+/**
+ * Runs op(up, mid, down, out, xl, x, xr) for every pixel of the 3x3 filters, rows in parallel.
+ * Interior columns pass fixed offsets so the loop vectorizes, the two border columns reflect.
+ */
+template <class Op>
+void forEach3x3(const cv::Mat &src, cv::Mat &dst, Op op)
+{
+  CV_Assert(src.type() == CV_8UC1 && !src.empty());
+  dst.create(src.size(), CV_8UC1);
+  CV_Assert(dst.data != src.data);
+  const int rows = src.rows, cols = src.cols;
+  cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range &range) {
+    for (int y = range.start; y < range.end; ++y)
+    {
+      const uchar *up   = src.ptr<uchar>(reflect101(y - 1, rows));
+      const uchar *mid  = src.ptr<uchar>(y);
+      const uchar *down = src.ptr<uchar>(reflect101(y + 1, rows));
+      uchar *out        = dst.ptr<uchar>(y);
+      op(up, mid, down, out, reflect101(-1, cols), 0, reflect101(1, cols));
+      for (int x = 1; x < cols - 1; ++x)
+      {
+        op(up, mid, down, out, x - 1, x, x + 1);
+      }
+      if (cols > 1)
+      {
+        op(up, mid, down, out, cols - 2, cols - 1, reflect101(cols, cols));
+      }
+    }
+  });
+}
+} // namespace
+
+void sharpenLaplacian(const cv::Mat &src, cv::Mat &dst)
+{
+  forEach3x3(src, dst, [](const uchar *up, const uchar *mid, const uchar *down, uchar *out, int xl, int x, int xr) {
+    // aperture 3 Laplacian is {2, 0, 2; 0, -8, 0; 2, 0, 2}
+    const int lap = 2 * (up[xl] + up[xr] + down[xl] + down[xr]) - 8 * mid[x];
+    out[x]        = static_cast<uchar>(std::max(mid[x] - std::min(std::abs(lap), 255), 0));
+  });
+}
+
+void sharpenKernel(const cv::Mat &src, cv::Mat &dst)
+{
+  forEach3x3(src, dst, [](const uchar *up, const uchar *mid, const uchar *down, uchar *out, int xl, int x, int xr) {
+    const int v = 5 * mid[x] - up[x] - down[x] - mid[xl] - mid[xr];
+    out[x]      = static_cast<uchar>(std::min(std::max(v, 0), 255));
+  });
+}
+
+void unsharpMask(const cv::Mat &src, cv::Mat &dst, double sigma, double amount)
+{
+  CV_Assert(src.type() == CV_8UC1 && !src.empty() && sigma > 0 && amount >= 0 && amount <= 16);
+  dst.create(src.size(), CV_8UC1);
+  CV_Assert(dst.data != src.data);
+
+  // Q8 weights summing to exactly 256, the aperture cv::GaussianBlur uses for 8-bit images
+  const int ksize  = cvRound(sigma * 3 * 2 + 1) | 1;
+  const int radius = ksize / 2;
+  cv::Mat kernel   = cv::getGaussianKernel(ksize, sigma, CV_64F);
+  std::vector<uint16_t> weights(ksize);
+  int sum = 0;
+  for (int k = 0; k < ksize; ++k)
+  {
+    weights[k] = static_cast<uint16_t>(cvRound(kernel.at<double>(k) * 256));
+    sum += weights[k];
+  }
+  weights[radius] = static_cast<uint16_t>(weights[radius] + 256 - sum);
+  const int amountQ8 = cvRound(amount * 256);
+
+  const int rows = src.rows, cols = src.cols;
+  // every stripe warms up its own window of ksize - 1 rows, so no more stripes than threads
+  cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range &range) {
+    std::vector<uchar> padded(cols + 2 * radius);
+    // horizontally blurred rows y - radius .. y + radius, Q8 (at most 255 * 256, fits 16 bits)
+    std::vector<std::vector<uint16_t>> window(ksize, std::vector<uint16_t>(cols));
+    std::vector<uint32_t> vertical(cols);
+
+    auto blurRow = [&](int virtualRow, std::vector<uint16_t> &h) {
+      const uchar *row = src.ptr<uchar>(reflect101(virtualRow, rows));
+      std::copy(row, row + cols, padded.begin() + radius);
+      for (int i = 0; i < radius; ++i)
+      {
+        padded[radius - 1 - i]    = row[reflect101(-1 - i, cols)];
+        padded[radius + cols + i] = row[reflect101(cols + i, cols)];
+      }
+      std::fill(h.begin(), h.end(), 0);
+      for (int k = 0; k < ksize; ++k)
+      {
+        const uint16_t w = weights[k];
+        const uchar *p   = padded.data() + k;
+        for (int x = 0; x < cols; ++x)
+        {
+          h[x] = static_cast<uint16_t>(h[x] + w * p[x]);
+        }
+      }
+    };
+    // window slot of virtual row v
+    auto slot = [&](int v) { return ((v % ksize) + ksize) % ksize; };
+
+    for (int v = range.start - radius; v < range.start + radius; ++v)
+    {
+      blurRow(v, window[slot(v)]);
+    }
+    for (int y = range.start; y < range.end; ++y)
+    {
+      blurRow(y + radius, window[slot(y + radius)]);
+
+      std::fill(vertical.begin(), vertical.end(), 0);
+      for (int k = 0; k < ksize; ++k)
+      {
+        const uint32_t w    = weights[k];
+        const uint16_t *h   = window[slot(y - radius + k)].data();
+        for (int x = 0; x < cols; ++x)
+        {
+          vertical[x] += w * h[x];
+        }
+      }
+
+      // img + amount * (img - blur), the blur rounded to Q8, the detail term to whole levels
+      const uchar *in = src.ptr<uchar>(y);
+      uchar *out      = dst.ptr<uchar>(y);
+      for (int x = 0; x < cols; ++x)
+      {
+        const int blur   = static_cast<int>((vertical[x] + 128) >> 8);
+        const int detail = (((in[x] << 8) - blur) * amountQ8 + (1 << 15)) >> 16;
+        out[x]           = static_cast<uchar>(std::min(std::max(in[x] + detail, 0), 255));
+      }
+    }
+  }, cv::getNumThreads());
+}
@@ -0,0 +1,163 @@
+#include "image_analysis/temporal_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+TemporalHistogram::TemporalHistogram(int window, double decay, int sample_step) :
+  window_(window), decay_(decay), sample_step_(sample_step)
+{
+  CV_Assert(window >= 1 && decay > 0 && decay <= 1 && sample_step >= 1);
+}
+
+void TemporalHistogram::reset()
+{
+  frames_ = 0;
+  ring_.clear();
+  ring_totals_.clear();
+  head_ = 0;
+  window_counts_.clear();
+  window_total_ = 0;
+  decayed_.clear();
+  decayed_samples_ = 0;
+  dirty_           = true;
+}
+
+void TemporalHistogram::update(const cv::Mat &frame)
+{
+  computeHistogram(frame, frame_, sample_step_);
+  const size_t bins = frame_.counts.size();
+  if (window_counts_.size() != bins)
+  {
+    reset();
+    window_counts_.assign(bins, 0);
+    decayed_.assign(bins, 0.0);
+  }
+
+  // sliding window: the new frame replaces the oldest one in the ring
+  int slot;
+  if (static_cast<int>(ring_.size()) < window_)
+  {
+    ring_.emplace_back(bins, 0);
+    ring_totals_.push_back(0);
+    slot = static_cast<int>(ring_.size()) - 1;
+  }
+  else
+  {
+    const auto &old = ring_[head_];
+    for (size_t v = 0; v < bins; ++v)
+    {
+      window_counts_[v] -= old[v];
+    }
+    window_total_ -= ring_totals_[head_];
+    slot  = head_;
+    head_ = (head_ + 1) % window_;
+  }
+  auto &counts = ring_[slot];
+  for (size_t v = 0; v < bins; ++v)
+  {
+    counts[v] = static_cast<uint32_t>(frame_.counts[v]);
+    window_counts_[v] += counts[v];
+  }
+  ring_totals_[slot] = frame_.total;
+  window_total_ += frame_.total;
+
+  // exponential decay over pixel fractions, so frames of any size weigh the same
+  if (frame_.total > 0)
+  {
+    const double w     = frames_ == 0 ? 1.0 : decay_;
+    const double scale = w / static_cast<double>(frame_.total);
+    for (size_t v = 0; v < bins; ++v)
+    {
+      decayed_[v] = (1.0 - w) * decayed_[v] + scale * frame_.counts[v];
+    }
+    // 1 / sum of squared pixel weights: n for the first frame, tending to n (2 - a) / a
+    const double inv = frames_ == 0 ? 1.0 / frame_.total : (1.0 - w) * (1.0 - w) / decayed_samples_ + w * w / frame_.total;
+    decayed_samples_ = 1.0 / inv;
+  }
+
+  ++frames_;
+  dirty_ = true;
+}
+
+void TemporalHistogram::refreshCdf() const
+{
+  if (!dirty_)
+  {
+    return;
+  }
+  window_cdf_.resize(window_counts_.size());
+  decayed_cdf_.resize(decayed_.size());
+  uint64_t acc = 0;
+  double facc  = 0;
+  for (size_t v = 0; v < window_counts_.size(); ++v)
+  {
+    acc += window_counts_[v];
+    facc += decayed_[v];
+    window_cdf_[v]  = acc;
+    decayed_cdf_[v] = facc;
+  }
+  dirty_ = false;
+}
+
+int TemporalHistogram::windowPercentile(double p) const
+{
+  if (window_total_ == 0)
+  {
+    return 0;
+  }
+  refreshCdf();
+  p                     = std::clamp(p, 0.0, 1.0);
+  const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * static_cast<double>(window_total_))));
+  return static_cast<int>(std::lower_bound(window_cdf_.begin(), window_cdf_.end(), target) - window_cdf_.begin());
+}
+
+double TemporalHistogram::windowMean() const
+{
+  if (window_total_ == 0)
+  {
+    return 0.0;
+  }
+  double sum = 0;
+  for (size_t v = 0; v < window_counts_.size(); ++v)
+  {
+    sum += static_cast<double>(v) * window_counts_[v];
+  }
+  return sum / window_total_;
+}
+
+int TemporalHistogram::decayedPercentile(double p) const
+{
+  if (frames_ == 0 || decayed_samples_ == 0)
+  {
+    return 0;
+  }
+  refreshCdf();
+  // the fractions sum to 1 only up to rounding, search relative to the last cdf entry
+  const double target = std::clamp(p, 0.0, 1.0) * decayed_cdf_.back();
+  // a zero target would stop at the empty leading bins, so p = 0 gives the darkest value present,
+  // as windowPercentile and histogramPercentile do
+  const auto it = target > 0 ? std::lower_bound(decayed_cdf_.begin(), decayed_cdf_.end(), target)
+                             : std::upper_bound(decayed_cdf_.begin(), decayed_cdf_.end(), 0.0);
+  return static_cast<int>(std::min(it - decayed_cdf_.begin(), static_cast<std::ptrdiff_t>(decayed_cdf_.size() - 1)));
+}
+
+double TemporalHistogram::decayedMean() const
+{
+  double sum = 0, weight = 0;
+  for (size_t v = 0; v < decayed_.size(); ++v)
+  {
+    sum += static_cast<double>(v) * decayed_[v];
+    weight += decayed_[v];
+  }
+  return weight > 0 ? sum / weight : 0.0;
+}
+
+double TemporalHistogram::windowErrorBound(double confidence) const
+{
+  return sample_step_ == 1 ? 0.0 : percentileErrorBound(static_cast<double>(window_total_), confidence);
+}
+
+double TemporalHistogram::decayedErrorBound(double confidence) const
+{
+  return sample_step_ == 1 ? 0.0 : percentileErrorBound(decayed_samples_, confidence);
+}
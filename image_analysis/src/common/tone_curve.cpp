@@ -0,0 +1,109 @@
+#include "image_analysis/tone_curve.h"
+
+#include <algorithm>
+#include <cmath>
+
+ToneCurve::ToneCurve()
+{}
+
+ToneCurve::ToneCurve(const Function &f) :
+  steps_{f}
+{}
+
+ToneCurve ToneCurve::sigmoid(double x0, double k)
+{
+  return ToneCurve([x0, k](double x) { return 1.0 / (1.0 + std::exp(-k * (x - x0))); });
+}
+
+ToneCurve ToneCurve::gamma(double gamma)
+{
+  return ToneCurve([gamma](double x) { return std::pow(std::max(0.0, x), gamma); });
+}
+
+ToneCurve ToneCurve::brightnessContrast(double alpha, double beta)
+{
+  return ToneCurve([alpha, beta](double x) { return alpha * x + beta; });
+}
+
+ToneCurve ToneCurve::clamp(double lo, double hi)
+{
+  return ToneCurve([lo, hi](double x) { return std::clamp(x, lo, hi); });
+}
+
+ToneCurve ToneCurve::then(const ToneCurve &next) const
+{
+  ToneCurve chain = *this;
+  chain.steps_.insert(chain.steps_.end(), next.steps_.begin(), next.steps_.end());
+  return chain;
+}
+
+double ToneCurve::operator()(double x) const
+{
+  for (const Function &f : steps_)
+  {
+    x = f(x);
+  }
+  return x;
+}
+
+cv::Mat ToneCurve::lut(int depth) const
+{
+  if (depth == CV_8U)
+  {
+    cv::Mat table(1, 256, CV_8U);
+    for (int i = 0; i < 256; ++i)
+    {
+      table.at<uchar>(i) = cv::saturate_cast<uchar>((*this)(i / 255.0) * 255.0);
+    }
+    return table;
+  }
+
+  if (depth == CV_16U)
+  {
+    cv::Mat table(1, 65536, CV_16U);
+    ushort *t = table.ptr<ushort>();
+    cv::parallel_for_(cv::Range(0, 65536), [&](const cv::Range &range) {
+      for (int i = range.start; i < range.end; ++i)
+      {
+        t[i] = cv::saturate_cast<ushort>((*this)(i / 65535.0) * 65535.0);
+      }
+    });
+    return table;
+  }
+
+  CV_Error(cv::Error::StsUnsupportedFormat, "ToneCurve: only CV_8U and CV_16U tables");
+}
+
+void ToneCurve::apply(const cv::Mat &src, cv::Mat &dst) const
+{
+  applyToneLut(src, lut(src.depth()), dst);
+}
+
+void applyToneLut(const cv::Mat &src, const cv::Mat &lut, cv::Mat &dst)
+{
+  CV_Assert(!src.empty() && lut.isContinuous() && lut.depth() == src.depth());
+
+  if (src.depth() == CV_8U)
+  {
+    CV_Assert(lut.total() == 256);
+    cv::LUT(src, lut, dst);
+    return;
+  }
+
+  // cv::LUT takes 8-bit sources only
+  CV_Assert(src.depth() == CV_16U && lut.total() == 65536);
+  dst.create(src.size(), src.type());
+  const ushort *t   = lut.ptr<ushort>();
+  const int width   = src.cols * src.channels();
+  cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range &range) {
+    for (int y = range.start; y < range.end; ++y)
+    {
+      const ushort *s = src.ptr<ushort>(y);
+      ushort *d       = dst.ptr<ushort>(y);
+      for (int x = 0; x < width; ++x)
+      {
+        d[x] = t[s[x]];
+      }
+    }
+  });
+}
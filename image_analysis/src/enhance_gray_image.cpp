@@ -1,6 +1,17 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
 #include <cmath>
+#include <string>
+
+#include "image_analysis/clahe.h"
+#include "image_analysis/cli_args.h"
+#include "image_analysis/tone_curve.h"
+
+// sigmoid of enhanceGrayDetail on the normalized gray scale, x0 and k given in 8-bit levels
+static ToneCurve sigmoidCurve(double x0, double k)
+{
+  return ToneCurve::sigmoid(x0 / 255.0, k * 255.0);
+}
 
 /**
  * @brief Enhance grayscale image detail around a specified gray level while compressing low/high gray levels.
@@ -14,15 +25,8 @@ cv::Mat enhanceGrayDetail(const cv::Mat &img_gray, double x0 = 125.0, double k =
 {
   CV_Assert(img_gray.type() == CV_8UC1);
 
-  cv::Mat lut(1, 256, CV_8UC1); // LUT ensures high performance even on large images.
-  for (int i = 0; i < 256; ++i)
-  {
-    double y         = 255.0 / (1.0 + std::exp(-k * (static_cast<double>(i) - x0)));
-    lut.at<uchar>(i) = static_cast<uchar>(std::clamp(y, 0.0, 255.0));
-  }
-
   cv::Mat enhanced;
-  cv::LUT(img_gray, lut, enhanced);
+  sigmoidCurve(x0, k).apply(img_gray, enhanced); // LUT ensures high performance even on large images.
   return enhanced;
 }
 
@@ -32,26 +36,10 @@ void gammaEnhanceInPlace(cv::Mat &img, double gamma = 0.6)
   CV_Assert(!img.empty());
   const int depth = img.depth();
 
-  if (depth == CV_8U)
-  {
-    // 8-bit: LUT-based gamma (in-place overwrite, type preserved)
-    cv::Mat lut(1, 256, CV_8U);
-    for (int i = 0; i < 256; ++i)
-    {
-      double v                = std::pow(i / 255.0, gamma) * 255.0;
-      lut.at<std::uint8_t>(i) = static_cast<std::uint8_t>(std::clamp(std::lround(v), 0L, 255L));
-    }
-    cv::LUT(img, lut, img); // overwrites img, keeps CV_8U/CV_8UCn
-    return;
-  }
-
-  if (depth == CV_16U)
+  if (depth == CV_8U || depth == CV_16U)
   {
-    // 16-bit: convert to float, apply gamma, convert back (type preserved at end)
-    cv::Mat tmp32f;
-    img.convertTo(tmp32f, CV_32F, 1.0 / 65535.0);
-    cv::pow(tmp32f, gamma, tmp32f);
-    tmp32f.convertTo(img, CV_16U, 65535.0); // overwrite original; still CV_16U(Cn)
+    // 256 or 65536-entry LUT (in-place overwrite, type preserved)
+    ToneCurve::gamma(gamma).apply(img, img);
     return;
   }
 
@@ -71,24 +59,16 @@ void claheEnhanceInPlace(cv::Mat &img, double clipLimit = 2.0, cv::Size tileGrid
   CV_Assert(!img.empty());
   CV_Assert(img.depth() == CV_8U);
 
-  cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(clipLimit, tileGridSize);
-
   if (img.channels() == 1)
   {
-    clahe->apply(img, img); // overwrites, keeps CV_8U
+    claheGray(img, img, clipLimit, tileGridSize); // overwrites, keeps CV_8U
     return;
   }
 
   if (img.channels() == 3)
   {
-    // Work in Lab to enhance luminance only; type remains CV_8UC3
-    cv::Mat lab;
-    cv::cvtColor(img, lab, cv::COLOR_BGR2Lab);
-    std::vector<cv::Mat> ch;
-    cv::split(lab, ch);
-    clahe->apply(ch[0], ch[0]); // enhance L
-    cv::merge(ch, lab);
-    cv::cvtColor(lab, img, cv::COLOR_Lab2BGR); // overwrite original
+    // enhance luma only, chroma kept; type remains CV_8UC3
+    claheColorInPlace(img, clipLimit, tileGridSize);
     return;
   }
 
@@ -97,9 +77,10 @@ void claheEnhanceInPlace(cv::Mat &img, double clipLimit = 2.0, cv::Size tileGrid
 
 int main(int argc, char **argv)
 {
-  if (argc < 2)
+  double gamma = 0.0;
+  if (argc < 2 || (argc > 2 && (!parseArg(argv[2], gamma) || gamma <= 0.0)))
   {
-    std::cout << "Usage: ./enhance_gray_image <gray_image_path>" << std::endl;
+    std::cout << "Usage: ./enhance_gray_image <gray_image_path> [gamma > 0]" << std::endl;
     return -1;
   }
 
@@ -110,7 +91,16 @@ int main(int argc, char **argv)
     return -1;
   }
 
-  cv::Mat enhanced_img = enhanceGrayDetail(img_gray, 125.0, 0.08);
+  cv::Mat enhanced_img;
+  if (argc > 2)
+  {
+    // sigmoid then gamma, composed into one table and one pass
+    sigmoidCurve(125.0, 0.08).then(ToneCurve::gamma(gamma)).apply(img_gray, enhanced_img);
+  }
+  else
+  {
+    enhanced_img = enhanceGrayDetail(img_gray, 125.0, 0.08);
+  }
 
   cv::imshow("Original", img_gray);
   cv::imshow("Enhanced", enhanced_img);
@@ -1,31 +1,35 @@
 #include <opencv2/opencv.hpp>
+#include <iostream>
+#include <string>
+
+#include "image_analysis/cli_args.h"
+#include "image_analysis/gradient_magnitude.h"
 
 int main(int argc, char **argv)
 {
+  // gradient [image] [sobel | scharr] [range]
+  // range > 0 maps that magnitude to 255 in a single pass, otherwise the output is min-max normalized
+  std::string path = argc > 1 ? argv[1] : "../../assets/sky.jpg";
+  // use Scharr instead of Sobel for better edge sensitivity
+  GradientKernel kernel = argc > 2 && std::string(argv[2]) == "scharr" ? GradientKernel::Scharr : GradientKernel::Sobel;
+  double range          = 0.0;
+  if (argc > 3 && !parseArg(argv[3], range))
+  {
+    std::cerr << "usage: gradient [image] [sobel | scharr] [range]" << std::endl;
+    return -1;
+  }
+
   // Load input image in grayscale
-  cv::Mat src = cv::imread("../../assets/sky.jpg", cv::IMREAD_GRAYSCALE);
+  cv::Mat src = cv::imread(path, cv::IMREAD_GRAYSCALE);
   if (src.empty())
   {
     std::cerr << "Error: Could not load image." << std::endl;
     return -1;
   }
 
-  // Calculate gradients using Sobel operator
-  cv::Mat grad_x, grad_y;
-  cv::Sobel(src, grad_x, CV_32F, 1, 0, 3);
-  cv::Sobel(src, grad_y, CV_32F, 0, 1, 3);
-  // use cv::Scharr instead of cv::Sobel for better edge sensitivity
-  // cv::Scharr(src, grad_x, CV_32F, 1, 0);
-  // cv::Scharr(src, grad_y, CV_32F, 0, 1);
-
-  // Compute gradient magnitude
-  cv::Mat grad_mag;
-  cv::magnitude(grad_x, grad_y, grad_mag);
-
-  // Normalize to 0-255 and convert to CV_8U for display
+  // Gradient magnitude, normalized to 0-255 as CV_8U for display
   cv::Mat grad_display;
-  cv::normalize(grad_mag, grad_display, 0, 255, cv::NORM_MINMAX);
-  grad_display.convertTo(grad_display, CV_8U);
+  gradientMagnitude(src, grad_display, kernel, range);
 
   // Save and show result
   cv::imwrite("gradient_image.jpg", grad_display);
@@ -0,0 +1,62 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <string>
+
+#include "image_analysis/image_profile.h"
+
+namespace
+{
+bool loadImage(const std::string &path, cv::Mat &img)
+{
+  img = cv::imread(path, cv::IMREAD_UNCHANGED);
+  if (img.empty() || img.depth() != CV_8U)
+  {
+    return false;
+  }
+  if (img.channels() == 4)
+  {
+    cv::cvtColor(img, img, cv::COLOR_BGRA2BGR);
+  }
+  return img.channels() == 1 || img.channels() == 3;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  // image_profile [image ...]
+  // one image prints the report of script/image_property.py, several print one line per image:
+  // path rows cols unique_colors stddev p5 p95 laplacian_variance mean_brightness
+  if (argc <= 2)
+  {
+    std::string path = argc > 1 ? argv[1] : "../assets/1.pgm";
+    cv::Mat img;
+    if (!loadImage(path, img))
+    {
+      std::cerr << "Error: Could not load 8-bit image " << path << std::endl;
+      return -1;
+    }
+    const ImageProfile p = computeImageProfile(img);
+    std::cout << "分辨率: " << p.rows << "x" << p.cols << " (" << p.rows * p.cols << " 像素)[1920x1080]" << std::endl;
+    std::cout << "唯一颜色数: " << p.uniqueColors << "[>10000]" << std::endl;
+    std::cout << "噪声水平（标准差）: " << cv::format("%.2f", p.stddev) << "[<10]" << std::endl;
+    std::cout << "动态范围 (使用5th和95th百分位数): " << p.p95 - p.p5 << " (P5: " << p.p5 << ", P95: " << p.p95
+              << ")[>150]" << std::endl;
+    std::cout << "纹理锐度（Laplacian方差）: " << p.laplacianVariance << "[>100]" << std::endl;
+    std::cout << "平均亮度: " << p.meanBrightness << "[=128,0-255]" << std::endl;
+    return 0;
+  }
+
+  for (int i = 1; i < argc; ++i)
+  {
+    cv::Mat img;
+    if (!loadImage(argv[i], img))
+    {
+      std::cerr << "skip " << argv[i] << std::endl;
+      continue;
+    }
+    const ImageProfile p = computeImageProfile(img);
+    std::cout << argv[i] << " " << p.rows << " " << p.cols << " " << p.uniqueColors << " " << p.stddev << " " << p.p5
+              << " " << p.p95 << " " << p.laplacianVariance << " " << p.meanBrightness << std::endl;
+  }
+  return 0;
+}
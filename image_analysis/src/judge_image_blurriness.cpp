@@ -1,5 +1,5 @@
 /*
-judge whether image is blurry and how blurry it is
+judge whether image is blurry and how blurry it is, see include/image_analysis/blur.h
 
 | Method                    | Advantages          | Limitations                          |
 | ------------------------- | ------------------- | ------------------------------------ |
@@ -12,114 +12,68 @@ judge whether image is blurry and how blurry it is
 
 #include <opencv2/opencv.hpp>
 #include <iostream>
+#include <string>
+#include <vector>
 
-// Compute high-frequency energy ratio
-double computeBlurFFT(const cv::Mat &gray, double radiusRatio = 0.1)
-{
-  // radiusRatio = 0.1 means we exclude the innermost 10% (i.e., the low frequencies) when summing "high frequency" energy.
-  // Convert to float
-  cv::Mat floatImg;
-  gray.convertTo(floatImg, CV_32F);
-
-  // Expand to complex matrix
-  cv::Mat planes[] = {floatImg, cv::Mat::zeros(gray.size(), CV_32F)};
-  cv::Mat complexImg;
-  cv::merge(planes, 2, complexImg);
-
-  // Perform DFT
-  cv::dft(complexImg, complexImg);
-
-  // Compute magnitude
-  cv::split(complexImg, planes);
-  cv::magnitude(planes[0], planes[1], planes[0]);
-  cv::Mat mag = planes[0];
+#include "image_analysis/blur.h"
+#include "image_analysis/cli_args.h"
 
-  // Shift zero-frequency to center
-  int cx = mag.cols / 2;
-  int cy = mag.rows / 2;
-  cv::Mat q0(mag, cv::Rect(0, 0, cx, cy));
-  cv::Mat q1(mag, cv::Rect(cx, 0, cx, cy));
-  cv::Mat q2(mag, cv::Rect(0, cy, cx, cy));
-  cv::Mat q3(mag, cv::Rect(cx, cy, cx, cy));
-  cv::Mat tmp;
-  q0.copyTo(tmp);
-  q3.copyTo(q0);
-  tmp.copyTo(q3);
-  q1.copyTo(tmp);
-  q2.copyTo(q1);
-  tmp.copyTo(q2);
-
-  // Compute high-frequency energy ratio
-  double totalEnergy = 0.0, highFreqEnergy = 0.0;
-  int rows = mag.rows, cols = mag.cols;
-  double r_max = radiusRatio * std::sqrt(rows * rows + cols * cols) / 2.0;
+int main(int argc, char **argv)
+{
+  // judge_image_blurriness [image] [tile]
+  // cheap thumbnail score first, full resolution Laplacian and FFT only when the thumbnail is inconclusive
+  std::string path = argc > 1 ? argv[1] : "../../assets/桂林.jpg";
+  int tileSize     = 0;
+  if (argc > 2 && (!parseArg(argv[2], tileSize) || tileSize <= 0))
+  {
+    std::cerr << "usage: judge_image_blurriness [image] [tile > 0]" << std::endl;
+    return -1;
+  }
 
-  for (int y = 0; y < rows; ++y)
+  // the tile map needs the full-resolution image anyway, so it is decoded once and the cascade
+  // downsamples it; otherwise the cascade decodes only the reduced levels it reaches
+  const std::vector<BlurCascadeStage> stages = defaultBlurCascade();
+  BlurDecision decision;
+  cv::Mat img;
+  bool found = false;
+  if (tileSize > 0)
   {
-    float *row = mag.ptr<float>(y);
-    for (int x = 0; x < cols; ++x)
+    img   = cv::imread(path, cv::IMREAD_GRAYSCALE);
+    found = !img.empty();
+    if (found)
     {
-      double dx   = x - cols / 2;
-      double dy   = y - rows / 2;
-      double dist = std::sqrt(dx * dx + dy * dy);
-      double val  = row[x];
-      totalEnergy += val;
-      if (dist > r_max)
-      {
-        highFreqEnergy += val;
-      }
+      decision = judgeBlurCascade(img, stages);
     }
   }
-
-  return highFreqEnergy / totalEnergy;
-}
-
-int main()
-{
-  cv::Mat img = cv::imread("../../assets/桂林.jpg", cv::IMREAD_GRAYSCALE);
-  if (img.empty())
+  else
+  {
+    found = judgeBlurCascade(path, decision, stages);
+  }
+  if (!found)
   {
     std::cerr << "Image not found\n";
     return -1;
   }
 
-  // Variance of Laplacian
-  {
-    cv::Mat lap;
-    cv::Laplacian(img, lap, CV_64F);
-    cv::Scalar mu, sigma;
-    cv::meanStdDev(lap, mu, sigma);
-    double variance = sigma.val[0] * sigma.val[0];
-
-    std::cout << "Variance of Laplacian: " << variance << std::endl;
+  std::cout << "Stage " << decision.stage + 1 << "/" << stages.size() << ": " << focusMetricName(decision.metric)
+            << " at 1/" << decision.reduction << " resolution, score " << decision.score
+            << " (threshold " << stages[decision.stage].threshold << ")" << std::endl;
+  std::cout << (decision.blurry ? "Image is blurry\n" : "Image is sharp\n");
 
-    double threshold = 100.0; // Example value, tune for your camera
-    if (variance < threshold)
-    {
-      std::cout << "Image is blurry\n";
-    }
-    else
-    {
-      std::cout << "Image is sharp\n";
-    }
-  }
-
-  // Frequency domain analysis
+  // local focus: Tenengrad per tile, for partially defocused images and picking a focus ROI
+  if (tileSize > 0)
   {
-    double blurScore = computeBlurFFT(img);
-    std::cout << "High-frequency ratio: " << blurScore << std::endl;
-
-    double threshold = 0.05; // depends on your image size and dataset
-    if (blurScore < threshold)
-    {
-      std::cout << "Image is blurry.\n";
-    }
-    else
+    cv::Mat tenengradMap, laplacianMap;
+    computeBlurMap(img, tenengradMap, laplacianMap, tileSize);
+    std::cout << "Tenengrad per tile:\n";
+    for (int y = 0; y < tenengradMap.rows; ++y)
     {
-      std::cout << "Image is sharp.\n";
+      for (int x = 0; x < tenengradMap.cols; ++x)
+      {
+        std::cout << cvRound(tenengradMap.at<float>(y, x)) << (x + 1 < tenengradMap.cols ? " " : "\n");
+      }
     }
   }
 
-
   return 0;
 }
@@ -6,6 +6,8 @@ get color remapping from a single reference patch
 #include <algorithm>
 #include <cmath>
 
+#include "image_analysis/color_lut.h"
+
 /* ---- sRGB <-> linear helpers ---- */
 static inline float srgbToLinear(float c)
 {
@@ -16,26 +18,17 @@ static inline float linearToSrgb(float c)
   return (c <= 0.0031308f) ? (c * 12.92f) : (1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f);
 }
 
-static cv::Mat toLinearSRGB(const cv::Mat &bgr8)
+// diagonal gains in linear light that take the measured patch to the target, RGB order
+static cv::Vec3f patchGains(const cv::Vec3b &measuredRGB, const cv::Vec3b &targetRGB)
 {
-  cv::Mat f32;
-  bgr8.convertTo(f32, CV_32F, 1.0 / 255.0);
-  cv::Mat lin = f32.clone();
-  lin.forEach<cv::Vec3f>([](cv::Vec3f &px, const int *) {
-    for (int c = 0; c < 3; ++c) px[c] = srgbToLinear(px[c]);
-  });
-  return lin;
-}
-static cv::Mat toSRGB8(const cv::Mat &lin)
-{
-  cv::Mat srgb = lin.clone();
-  srgb.forEach<cv::Vec3f>([](cv::Vec3f &px, const int *) {
-    for (int c = 0; c < 3; ++c)
-      px[c] = linearToSrgb(std::max(0.0f, std::min(1.0f, px[c])));
-  });
-  cv::Mat u8;
-  srgb.convertTo(u8, CV_8U, 255.0);
-  return u8;
+  auto toLin = [](int v) -> float { return srgbToLinear(v / 255.0f); };
+  const float eps = 1e-9f;
+  cv::Vec3f measLinRGB(toLin(measuredRGB[0]), toLin(measuredRGB[1]), toLin(measuredRGB[2]));
+  cv::Vec3f targLinRGB(toLin(targetRGB[0]), toLin(targetRGB[1]), toLin(targetRGB[2]));
+  return cv::Vec3f(
+      targLinRGB[0] / std::max(eps, measLinRGB[0]),
+      targLinRGB[1] / std::max(eps, measLinRGB[1]),
+      targLinRGB[2] / std::max(eps, measLinRGB[2]));
 }
 
 /**
@@ -51,35 +44,52 @@ static cv::Mat remapFromSinglePatch(
     const cv::Vec3b &measuredRGB,
     const cv::Vec3b &targetRGB)
 {
-  // Whole image to linear (BGR float)
-  cv::Mat linBGR = toLinearSRGB(srcBGR8);
-
   auto toLin = [](int v) -> float { return srgbToLinear(v / 255.0f); };
-  // Gains computed in RGB order
-  const float eps = 1e-9f;
-  cv::Vec3f measLinRGB(toLin(measuredRGB[0]), toLin(measuredRGB[1]), toLin(measuredRGB[2]));
-  cv::Vec3f targLinRGB(toLin(targetRGB[0]), toLin(targetRGB[1]), toLin(targetRGB[2]));
-  cv::Vec3f gRGB(
-      targLinRGB[0] / std::max(eps, measLinRGB[0]),
-      targLinRGB[1] / std::max(eps, measLinRGB[1]),
-      targLinRGB[2] / std::max(eps, measLinRGB[2]));
+  const cv::Vec3f gRGB = patchGains(measuredRGB, targetRGB);
 
-  // Apply diagonal in linear space (remember linBGR is BGR)
-  linBGR.forEach<cv::Vec3f>([&](cv::Vec3f &px, const int *) {
-    px[0] *= gRGB[2]; // B channel gets g_B
-    px[1] *= gRGB[1]; // G channel gets g_G
-    px[2] *= gRGB[0]; // R channel gets g_R
-  });
+  // linearize -> diagonal gain -> clamp -> encode is a curve per channel of an 8-bit value, so it
+  // is evaluated once per level into a 256-entry table (BGR order) and the image takes one lookup pass
+  const cv::Vec3f gBGR(gRGB[2], gRGB[1], gRGB[0]);
+  cv::Mat lut(1, 256, CV_8UC3);
+  for (int v = 0; v < 256; ++v)
+  {
+    const float lin = toLin(v);
+    cv::Vec3b &entry = lut.at<cv::Vec3b>(v);
+    for (int c = 0; c < 3; ++c)
+    {
+      entry[c] = cv::saturate_cast<uchar>(linearToSrgb(std::max(0.0f, std::min(1.0f, lin * gBGR[c]))) * 255.0f);
+    }
+  }
 
-  // Clamp, then encode back to sRGB
-  cv::min(linBGR, 1.0, linBGR);
-  cv::max(linBGR, 0.0, linBGR);
-  return toSRGB8(linBGR);
+  cv::Mat dst;
+  cv::LUT(srcBGR8, lut, dst);
+  return dst;
+}
+
+/**
+ * The same correction as a 3D LUT, so it can be chained with other color transforms and applied
+ * by anything that reads .cube files.
+ */
+static ColorLut3D bakeSinglePatch(const cv::Vec3b &measuredRGB, const cv::Vec3b &targetRGB, int size = 33)
+{
+  const cv::Vec3f gRGB = patchGains(measuredRGB, targetRGB);
+  ColorLut3D lut(size);
+  lut.setTitle("remap from single patch");
+  lut.bake([gRGB](const cv::Vec3f &rgb) {
+    cv::Vec3f out;
+    for (int c = 0; c < 3; ++c)
+    {
+      out[c] = linearToSrgb(std::max(0.0f, std::min(1.0f, srgbToLinear(rgb[c]) * gRGB[c])));
+    }
+    return out;
+  });
+  return lut;
 }
 
 int main(int argc, char **argv)
 {
-  std::string path = "../../assets/sky.jpg";
+  // remap_color [image] [lut.cube]
+  std::string path = argc > 1 ? argv[1] : "../../assets/sky.jpg";
   cv::Mat img      = cv::imread(path, cv::IMREAD_COLOR); // BGR, sRGB
   if (img.empty())
   {
@@ -93,5 +103,11 @@ int main(int argc, char **argv)
 
   cv::Mat mapped = remapFromSinglePatch(img, measuredRGB, targetRGB);
   cv::imwrite("mapped_to_standard.png", mapped);
+
+  if (argc > 2 && !bakeSinglePatch(measuredRGB, targetRGB).save(argv[2]))
+  {
+    std::cerr << "Cannot write " << argv[2] << "\n";
+    return 1;
+  }
   return 0;
 }
\ No newline at end of file
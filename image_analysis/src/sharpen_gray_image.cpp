@@ -1,10 +1,14 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
+#include <string>
 
-int main()
+#include "image_analysis/sharpen.h"
+
+int main(int argc, char **argv)
 {
   // Load grayscale image
-  cv::Mat img = cv::imread("../assets/sky.jpg", cv::IMREAD_GRAYSCALE);
+  std::string path = argc > 1 ? argv[1] : "../assets/sky.jpg";
+  cv::Mat img      = cv::imread(path, cv::IMREAD_GRAYSCALE);
   if (img.empty())
   {
     std::cerr << "Failed to load image." << std::endl;
@@ -15,23 +19,17 @@ int main()
 
   // Method 1: Uses Laplacian to capture edges and subtracts it from the original to enhance edges.
   cv::Mat laplacian_sharpened;
-  cv::Mat laplacian;
-  cv::Laplacian(img, laplacian, CV_16S, 3);
-  cv::Mat laplacian_abs;
-  cv::convertScaleAbs(laplacian, laplacian_abs);
-  cv::addWeighted(img, 1.0, laplacian_abs, -1.0, 0, laplacian_sharpened);
+  sharpenLaplacian(img, laplacian_sharpened);
   cv::imshow("laplacian", laplacian_sharpened);
 
   // Method 2: Uses a sharpening kernel that enhances the center pixel while subtracting neighboring pixel contributions.
   cv::Mat kernel_sharpened;
-  cv::Mat kernel = (cv::Mat_<float>(3, 3) << 0, -1, 0, -1, 5, -1, 0, -1, 0);
-  cv::filter2D(img, kernel_sharpened, img.depth(), kernel);
+  sharpenKernel(img, kernel_sharpened);
   cv::imshow("kernel", kernel_sharpened);
 
-  cv::Mat blurred;
+  // Method 3: Unsharp mask, adds back the difference to a Gaussian blur.
   cv::Mat sharpened;
-  cv::GaussianBlur(img, blurred, cv::Size(0, 0), 1);
-  cv::addWeighted(img, 1.5, blurred, -0.5, 0, sharpened);
+  unsharpMask(img, sharpened, 1.0, 0.5);
   cv::imshow("blurred", sharpened);
 
   // Show result
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+#include "image_analysis/batch_runner.h"
+
+TEST(BatchRunnerTest, failuresDoNotStopTheBatch)
+{
+  const std::filesystem::path dir = std::filesystem::temp_directory_path() / "batch_runner_test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir / "out");
+
+  // the pixel value tells the operator what to do with the image
+  std::vector<std::string> inputs;
+  for (int v : {10, 20, 30, 40, 50})
+  {
+    const std::string path = (dir / (std::to_string(v) + ".pgm")).string();
+    cv::imwrite(path, cv::Mat(8, 8, CV_8UC1, cv::Scalar(v)));
+    inputs.push_back(path);
+  }
+  inputs.push_back((dir / "missing.pgm").string());
+
+  BatchOperator op = [](const cv::Mat &img) -> cv::Mat {
+    const int v = img.at<uchar>(0, 0);
+    if (v == 20)
+    {
+      throw std::out_of_range("not a cv::Exception");
+    }
+    if (v == 30)
+    {
+      CV_Error(cv::Error::StsBadArg, "operator failed");
+    }
+    if (v == 40)
+    {
+      return cv::Mat();
+    }
+    cv::Mat inverted;
+    cv::bitwise_not(img, inverted);
+    return inverted;
+  };
+  BatchOptions options;
+  options.decodeThreads = options.computeThreads = options.encodeThreads = 2;
+  options.readFlags = cv::IMREAD_GRAYSCALE;
+  options.outputDir = (dir / "out").string();
+
+  BatchStats stats = runBatch(inputs, op, options);
+  EXPECT_EQ(stats.written, 2u);
+  std::sort(stats.failed.begin(), stats.failed.end());
+  std::vector<std::string> expected = {inputs[1], inputs[2], inputs[3], inputs[5]};
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(stats.failed, expected);
+
+  cv::Mat out = cv::imread((dir / "out" / "10.pgm").string(), cv::IMREAD_GRAYSCALE);
+  ASSERT_FALSE(out.empty());
+  EXPECT_EQ(out.at<uchar>(0, 0), 245);
+
+  std::filesystem::remove_all(dir);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
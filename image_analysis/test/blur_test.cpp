@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "image_analysis/blur.h"
+
+namespace
+{
+// smooth shading plus noise, so blurring removes most but not all of the detail
+cv::Mat texture(int rows, int cols, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> noise(-60, 60);
+  cv::Mat img(rows, cols, CV_8UC1);
+  for (int y = 0; y < rows; ++y)
+  {
+    for (int x = 0; x < cols; ++x)
+    {
+      img.at<uchar>(y, x) = cv::saturate_cast<uchar>(128 + 40 * std::sin(x * 0.2) + noise(rng));
+    }
+  }
+  return img;
+}
+
+cv::Mat blurred(const cv::Mat &img, double sigma)
+{
+  cv::Mat out;
+  cv::GaussianBlur(img, out, cv::Size(0, 0), sigma);
+  return out;
+}
+
+// computeBlurFFT over the full spectrum with the disc tested per frequency, no half spectrum and
+// no cutoff table; rows and cols must already be even DFT sizes so no padding is involved
+double referenceBlurFFT(const cv::Mat &gray, double radiusRatio)
+{
+  cv::Mat floatImg, spectrum;
+  gray.convertTo(floatImg, CV_32F);
+  cv::dft(floatImg, spectrum, cv::DFT_COMPLEX_OUTPUT);
+  const int rows = gray.rows, cols = gray.cols;
+  const double r_max = radiusRatio * std::sqrt(double(rows) * rows + double(cols) * cols) / 2.0;
+  double total = 0.0, highFreq = 0.0;
+  for (int v = 0; v < rows; ++v)
+  {
+    const double fv = v <= rows / 2 ? v : v - rows;
+    for (int u = 0; u < cols; ++u)
+    {
+      const double fu  = u <= cols / 2 ? u : u - cols;
+      const cv::Vec2f c = spectrum.at<cv::Vec2f>(v, u);
+      const double mag = std::sqrt(c[0] * c[0] + c[1] * c[1]);
+      total += mag;
+      if (fu * fu + fv * fv > r_max * r_max)
+      {
+        highFreq += mag;
+      }
+    }
+  }
+  return highFreq / total;
+}
+} // namespace
+
+TEST(BlurTest, sharpScoresHigher)
+{
+  const cv::Mat sharp = texture(64, 64, 1);
+  const cv::Mat soft  = blurred(sharp, 2.0);
+  EXPECT_GT(computeBlurFFT(sharp), computeBlurFFT(soft));
+  EXPECT_GT(laplacianVariance(sharp), laplacianVariance(soft));
+  EXPECT_GT(tenengrad(sharp), tenengrad(soft));
+
+  const double ratio = computeBlurFFT(sharp);
+  EXPECT_GE(ratio, 0.0);
+  EXPECT_LE(ratio, 1.0);
+  // a flat image has only the DC term, up to rounding in the float transform
+  EXPECT_NEAR(computeBlurFFT(cv::Mat(32, 32, CV_8UC1, cv::Scalar(90))), 0.0, 1e-6);
+
+  EXPECT_EQ(focusScore(sharp, FocusMetric::Laplacian), laplacianVariance(sharp));
+  EXPECT_EQ(focusScore(sharp, FocusMetric::Tenengrad), tenengrad(sharp));
+  EXPECT_EQ(focusScore(sharp, FocusMetric::FFT), computeBlurFFT(sharp));
+}
+
+TEST(BlurTest, cutoffCache)
+{
+  // more spectrum sizes than the cache holds, each cutoff evicted and rebuilt on the second pass
+  const std::vector<std::pair<int, int>> sizes = {{16, 16}, {18, 24}, {24, 18}, {30, 32}, {32, 40}, {40, 36}};
+  std::vector<double> first;
+  for (size_t i = 0; i < sizes.size(); ++i)
+  {
+    const cv::Mat img = texture(sizes[i].first, sizes[i].second, unsigned(10 + i));
+    first.push_back(computeBlurFFT(img));
+    EXPECT_NEAR(first.back(), referenceBlurFFT(img, 0.1), 1e-9) << i;
+    // cached right away
+    EXPECT_EQ(computeBlurFFT(img), first.back()) << i;
+    // same size, other radius
+    EXPECT_NEAR(computeBlurFFT(img, 0.3), referenceBlurFFT(img, 0.3), 1e-9) << i;
+  }
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    for (size_t i = 0; i < sizes.size(); ++i)
+    {
+      const cv::Mat img = texture(sizes[i].first, sizes[i].second, unsigned(10 + i));
+      EXPECT_EQ(computeBlurFFT(img), first[i]) << pass << " " << i;
+    }
+  }
+}
+
+TEST(BlurTest, blurMap)
+{
+  // right half blurred, 32 px tiles with a partial last row and column
+  cv::Mat img         = texture(100, 70, 2);
+  const cv::Mat right = img.colRange(32, 64);
+  blurred(right, 3.0).copyTo(right);
+
+  cv::Mat tenengradMap, laplacianMap;
+  computeBlurMap(img, tenengradMap, laplacianMap, 32);
+  ASSERT_EQ(tenengradMap.rows, 4);
+  ASSERT_EQ(tenengradMap.cols, 3);
+  ASSERT_EQ(tenengradMap.type(), CV_32F);
+  ASSERT_EQ(laplacianMap.size(), tenengradMap.size());
+  ASSERT_EQ(laplacianMap.type(), CV_32F);
+
+  // tile means weighted by tile area add up to the whole-image score
+  double weighted = 0.0;
+  for (int ty = 0; ty < 4; ++ty)
+  {
+    const int h = std::min(32, 100 - 32 * ty);
+    for (int tx = 0; tx < 3; ++tx)
+    {
+      const int w = std::min(32, 70 - 32 * tx);
+      weighted += double(tenengradMap.at<float>(ty, tx)) * h * w;
+    }
+    EXPECT_LT(tenengradMap.at<float>(ty, 1), tenengradMap.at<float>(ty, 0)) << ty;
+    EXPECT_LT(laplacianMap.at<float>(ty, 1), laplacianMap.at<float>(ty, 0)) << ty;
+  }
+  EXPECT_NEAR(weighted / (100 * 70), tenengrad(img), 1e-3 * tenengrad(img));
+
+  // one tile is the whole image
+  computeBlurMap(img, tenengradMap, laplacianMap, 128);
+  ASSERT_EQ(tenengradMap.size(), cv::Size(1, 1));
+  EXPECT_NEAR(tenengradMap.at<float>(0, 0), tenengrad(img), 1e-5 * tenengrad(img));
+  EXPECT_NEAR(laplacianMap.at<float>(0, 0), laplacianVariance(img), 1e-5 * laplacianVariance(img));
+}
+
+TEST(BlurTest, cascade)
+{
+  const cv::Mat sharp = texture(128, 128, 3);
+  const cv::Mat flat(128, 128, CV_8UC1, cv::Scalar(100));
+
+  BlurDecision decision = judgeBlurCascade(sharp);
+  EXPECT_FALSE(decision.blurry);
+  EXPECT_EQ(decision.stage, 0);
+  EXPECT_EQ(decision.reduction, 4);
+
+  decision = judgeBlurCascade(flat);
+  EXPECT_TRUE(decision.blurry);
+  EXPECT_EQ(decision.stage, 0);
+  EXPECT_EQ(decision.score, 0.0);
+
+  // the first stage's band holds the score, so the second decides
+  const double lap = laplacianVariance(sharp);
+  const std::vector<BlurCascadeStage> stages = {
+    {FocusMetric::Laplacian, 1, lap, 2.0},
+    {FocusMetric::Tenengrad, 2, 1e9, 1.0},
+  };
+  decision = judgeBlurCascade(sharp, stages);
+  EXPECT_TRUE(decision.blurry);
+  EXPECT_EQ(decision.stage, 1);
+  EXPECT_EQ(decision.metric, FocusMetric::Tenengrad);
+  EXPECT_EQ(decision.reduction, 2);
+
+  // the last stage compares against its threshold alone, whatever the band
+  const std::vector<BlurCascadeStage> last = {{FocusMetric::Laplacian, 1, lap * 0.9, 4.0}};
+  decision = judgeBlurCascade(sharp, last);
+  EXPECT_FALSE(decision.blurry);
+  EXPECT_EQ(decision.stage, 0);
+  EXPECT_EQ(decision.score, lap);
+}
+
+TEST(BlurTest, cascadeFromFile)
+{
+  const cv::Mat sharp = texture(128, 128, 4);
+  const std::string path = "blur_test.pgm";
+  ASSERT_TRUE(cv::imwrite(path, sharp));
+
+  // full resolution only: a lossless file gives the same decision as the cv::Mat
+  const std::vector<BlurCascadeStage> stages = {
+    {FocusMetric::Laplacian, 1, laplacianVariance(sharp), 2.0},
+    {FocusMetric::FFT, 1, 0.05, 1.0},
+  };
+  BlurDecision fromFile;
+  ASSERT_TRUE(judgeBlurCascade(path, fromFile, stages));
+  const BlurDecision fromMat = judgeBlurCascade(sharp, stages);
+  EXPECT_EQ(fromFile.blurry, fromMat.blurry);
+  EXPECT_EQ(fromFile.score, fromMat.score);
+  EXPECT_EQ(fromFile.stage, 1);
+
+  ASSERT_TRUE(judgeBlurCascade(path, fromFile));
+  EXPECT_FALSE(fromFile.blurry);
+  EXPECT_GE(fromFile.stage, 0);
+  std::remove(path.c_str());
+
+  EXPECT_FALSE(judgeBlurCascade("blur_test_missing.pgm", fromFile));
+  EXPECT_EQ(fromFile.stage, -1);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <random>
+
+#include "image_analysis/clahe.h"
+
+namespace
+{
+// smooth ramp with noise, so the tiles get different tables
+cv::Mat testImage(int rows, int cols, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> noise(-20, 20);
+  cv::Mat img(rows, cols, CV_8UC1);
+  for (int y = 0; y < rows; ++y)
+  {
+    for (int x = 0; x < cols; ++x)
+    {
+      img.at<uchar>(y, x) = cv::saturate_cast<uchar>(60 + 100 * x / cols + 40 * y / rows + noise(rng));
+    }
+  }
+  return img;
+}
+} // namespace
+
+TEST(ClaheTest, matchesOpenCV)
+{
+  // divisible, neither side divisible, only one side divisible, smaller than the grid
+  const cv::Size sizes[] = {{128, 96}, {131, 101}, {128, 101}, {131, 96}, {5, 7}};
+  for (const cv::Size &size : sizes)
+  {
+    for (double clipLimit : {0.0, 2.0, 40.0})
+    {
+      const cv::Mat src = testImage(size.height, size.width, size.area());
+      cv::Mat expected, actual;
+      cv::createCLAHE(clipLimit, cv::Size(8, 8))->apply(src, expected);
+      claheGray(src, actual, clipLimit, cv::Size(8, 8));
+      EXPECT_EQ(cv::norm(actual, expected, cv::NORM_INF), 0) << size.width << "x" << size.height << " clip " << clipLimit;
+    }
+  }
+
+  // in place
+  cv::Mat img = testImage(120, 90, 1), expected;
+  cv::createCLAHE(2.0, cv::Size(4, 6))->apply(img, expected);
+  claheGray(img, img, 2.0, cv::Size(4, 6));
+  EXPECT_EQ(cv::norm(img, expected, cv::NORM_INF), 0);
+}
+
+TEST(ClaheTest, colorKeepsGray)
+{
+  // a gray BGR image has luma equal to every channel, so it maps like the gray one
+  const cv::Mat gray = testImage(100, 140, 2);
+  cv::Mat bgr, expected;
+  cv::cvtColor(gray, bgr, cv::COLOR_GRAY2BGR);
+  claheGray(gray, expected);
+  claheColorInPlace(bgr);
+  for (int y = 0; y < gray.rows; ++y)
+  {
+    for (int x = 0; x < gray.cols; ++x)
+    {
+      const cv::Vec3b p = bgr.at<cv::Vec3b>(y, x);
+      ASSERT_LE(std::abs(p[0] - expected.at<uchar>(y, x)), 1);
+      ASSERT_EQ(p[0], p[1]);
+      ASSERT_EQ(p[0], p[2]);
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "image_analysis/color_lut.h"
+
+namespace
+{
+cv::Mat randomBGR(int rows, int cols, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> level(0, 255);
+  cv::Mat img(rows, cols, CV_8UC3);
+  for (int y = 0; y < rows; ++y)
+  {
+    for (int x = 0; x < cols; ++x)
+    {
+      img.at<cv::Vec3b>(y, x) = cv::Vec3b(level(rng), level(rng), level(rng));
+    }
+  }
+  return img;
+}
+
+// a smooth transform: channel mixing and a power curve, RGB in and out
+cv::Vec3f grade(const cv::Vec3f &rgb)
+{
+  const float r = 0.8f * rgb[0] + 0.2f * rgb[1];
+  const float g = 0.1f * rgb[0] + 0.8f * rgb[1] + 0.1f * rgb[2];
+  const float b = 0.3f * rgb[1] + 0.7f * rgb[2];
+  return cv::Vec3f(std::pow(r, 1.5f), std::pow(g, 1.2f), 0.25f + 0.5f * b * b);
+}
+
+bool loadText(const std::string &text)
+{
+  const std::string path = "color_lut_test_load.cube";
+  std::ofstream(path) << text;
+  ColorLut3D lut(2);
+  const bool ok = lut.load(path);
+  std::remove(path.c_str());
+  return ok;
+}
+
+// a 2^3 identity table: header lines, then the entries with the first one replaced by first
+std::string identityCube(const std::string &header, const std::string &first = "0 0 0", int entries = 8)
+{
+  std::string text = "LUT_3D_SIZE 2\n" + header + first + "\n";
+  for (int i = 1; i < entries; ++i)
+  {
+    text += std::to_string(i & 1) + " " + std::to_string((i >> 1) & 1) + " " + std::to_string(i >> 2) + "\n";
+  }
+  return text;
+}
+} // namespace
+
+TEST(ColorLutTest, identity)
+{
+  const cv::Mat src = randomBGR(61, 77, 1);
+  for (int size : {2, 17, 33})
+  {
+    ColorLut3D lut(size);
+    cv::Mat dst;
+    lut.apply(src, dst);
+    EXPECT_EQ(cv::norm(dst, src, cv::NORM_INF), 0) << size;
+  }
+}
+
+TEST(ColorLutTest, tetrahedralNearExact)
+{
+  ColorLut3D lut(33);
+  lut.bake(grade);
+  const cv::Mat src = randomBGR(128, 128, 2);
+  cv::Mat dst;
+  lut.apply(src, dst);
+  for (int y = 0; y < src.rows; ++y)
+  {
+    for (int x = 0; x < src.cols; ++x)
+    {
+      const cv::Vec3b p   = src.at<cv::Vec3b>(y, x);
+      const cv::Vec3f rgb = grade(cv::Vec3f(p[2] / 255.0f, p[1] / 255.0f, p[0] / 255.0f));
+      const cv::Vec3b q   = dst.at<cv::Vec3b>(y, x);
+      for (int c = 0; c < 3; ++c)
+      {
+        const int exact = cv::saturate_cast<uchar>(std::min(1.0f, std::max(0.0f, rgb[c])) * 255.0f);
+        ASSERT_LE(std::abs(q[2 - c] - exact), 1) << y << " " << x << " " << c;
+      }
+    }
+  }
+}
+
+TEST(ColorLutTest, cubeRoundTrip)
+{
+  ColorLut3D lut(17);
+  lut.bake(grade);
+  lut.setTitle("grade test");
+  const std::string path = "color_lut_test.cube";
+  ASSERT_TRUE(lut.save(path));
+
+  ColorLut3D loaded(2);
+  ASSERT_TRUE(loaded.load(path));
+  std::remove(path.c_str());
+  EXPECT_EQ(loaded.size(), 17);
+  EXPECT_EQ(loaded.title(), "grade test");
+  for (int b = 0; b < 17; ++b)
+  {
+    for (int g = 0; g < 17; ++g)
+    {
+      for (int r = 0; r < 17; ++r)
+      {
+        // six decimals in the file
+        const cv::Vec3f expected = lut.at(r, g, b), actual = loaded.at(r, g, b);
+        for (int c = 0; c < 3; ++c)
+        {
+          ASSERT_NEAR(actual[c], expected[c], 1e-6);
+        }
+      }
+    }
+  }
+
+  const cv::Mat src = randomBGR(40, 50, 3);
+  cv::Mat expected, actual;
+  lut.apply(src, expected);
+  loaded.apply(src, actual);
+  EXPECT_LE(cv::norm(actual, expected, cv::NORM_INF), 1);
+}
+
+TEST(ColorLutTest, loadRejects)
+{
+  EXPECT_TRUE(loadText(identityCube("")));
+  EXPECT_TRUE(loadText("# comment\nTITLE \"t\"\n" + identityCube("DOMAIN_MIN 0 0 0\nDOMAIN_MAX 1 1 1\n")));
+  // entries out of range or not numbers
+  EXPECT_FALSE(loadText(identityCube("", "1.5 0 0")));
+  EXPECT_FALSE(loadText(identityCube("", "-0.2 0 0")));
+  EXPECT_FALSE(loadText(identityCube("", "0 nan 0")));
+  // a fourth number, too few entries
+  EXPECT_FALSE(loadText(identityCube("", "0 0 0 0")));
+  EXPECT_FALSE(loadText(identityCube("", "0 0 0", 7)));
+  // unknown and 1D keywords, other domains
+  EXPECT_FALSE(loadText(identityCube("LUT_IN_VIDEO_RANGE\n")));
+  EXPECT_FALSE(loadText(identityCube("LUT_1D_SIZE 2\n")));
+  EXPECT_FALSE(loadText(identityCube("DOMAIN_MAX 2 2 2\n")));
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
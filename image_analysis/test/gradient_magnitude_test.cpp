@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "image_analysis/gradient_magnitude.h"
+
+namespace
+{
+cv::Mat testImage(int rows, int cols, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> noise(-30, 30);
+  cv::Mat img(rows, cols, CV_8UC1);
+  for (int y = 0; y < rows; ++y)
+  {
+    for (int x = 0; x < cols; ++x)
+    {
+      // a bright square on a ramp, so there are strong and weak edges
+      const int square = (x > cols / 3 && x < cols / 2 && y > rows / 4) ? 120 : 0;
+      img.at<uchar>(y, x) = cv::saturate_cast<uchar>(40 + x * 60 / cols + square + noise(rng));
+    }
+  }
+  return img;
+}
+
+// the chain gradient.cpp used before: CV_32F derivatives, magnitude, then normalize or a fixed scale
+cv::Mat referenceMagnitude(const cv::Mat &gray, GradientKernel kernel, double range)
+{
+  cv::Mat gx, gy, mag, out;
+  if (kernel == GradientKernel::Scharr)
+  {
+    cv::Scharr(gray, gx, CV_32F, 1, 0);
+    cv::Scharr(gray, gy, CV_32F, 0, 1);
+  }
+  else
+  {
+    cv::Sobel(gray, gx, CV_32F, 1, 0, 3);
+    cv::Sobel(gray, gy, CV_32F, 0, 1, 3);
+  }
+  cv::magnitude(gx, gy, mag);
+  if (range > 0)
+  {
+    mag.convertTo(out, CV_8U, 255.0 / range);
+  }
+  else
+  {
+    cv::normalize(mag, mag, 0, 255, cv::NORM_MINMAX);
+    mag.convertTo(out, CV_8U);
+  }
+  return out;
+}
+} // namespace
+
+TEST(GradientMagnitudeTest, matchesOpenCV)
+{
+  const cv::Mat gray = testImage(97, 131, 1);
+  for (GradientKernel kernel : {GradientKernel::Sobel, GradientKernel::Scharr})
+  {
+    for (double range : {0.0, 200.0, 1000.0})
+    {
+      const cv::Mat expected = referenceMagnitude(gray, kernel, range);
+      cv::Mat actual;
+      gradientMagnitude(gray, actual, kernel, range);
+      // an FMA build of OpenCV may round values on a half level the other way
+      cv::Mat diff;
+      cv::absdiff(actual, expected, diff);
+      EXPECT_LE(cv::norm(diff, cv::NORM_INF), 1) << static_cast<int>(kernel) << " range " << range;
+      EXPECT_LE(cv::countNonZero(diff), static_cast<int>(gray.total() / 1000)) << static_cast<int>(kernel) << " range " << range;
+    }
+  }
+
+  // a flat image has no gradient and normalizes to zero
+  cv::Mat flat(20, 30, CV_8UC1, cv::Scalar(77)), out;
+  gradientMagnitude(flat, out);
+  EXPECT_EQ(cv::countNonZero(out), 0);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
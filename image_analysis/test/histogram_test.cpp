@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "image_analysis/histogram.h"
+
+namespace
+{
+// numpy.percentile with the default linear interpolation, q in [0, 100]
+double numpyPercentile(std::vector<double> values, double q)
+{
+  std::sort(values.begin(), values.end());
+  const double pos = q / 100.0 * (values.size() - 1);
+  const size_t k   = static_cast<size_t>(std::floor(pos));
+  const double t   = pos - k;
+  const double a = values[k], b = values[std::min(k + 1, values.size() - 1)];
+  return t >= 0.5 ? b - (b - a) * (1 - t) : a + (b - a) * t;
+}
+} // namespace
+
+TEST(HistogramTest, test1)
+{
+  std::mt19937 rng(5);
+  // a narrow band of levels, so most bins are empty
+  std::binomial_distribution<int> level(60, 0.5);
+  cv::Mat img(123, 77, CV_8UC1);
+  std::vector<double> values;
+  for (int y = 0; y < img.rows; ++y)
+  {
+    for (int x = 0; x < img.cols; ++x)
+    {
+      img.at<uchar>(y, x) = static_cast<uchar>(100 + level(rng));
+      values.push_back(img.at<uchar>(y, x));
+    }
+  }
+
+  Histogram hist;
+  computeHistogram(img, hist);
+  ASSERT_EQ(hist.counts.size(), 256u);
+  EXPECT_EQ(hist.total, img.total());
+  cv::Mat expected;
+  const int channel = 0, bins = 256;
+  const float range[] = {0, 256};
+  const float *ranges = range;
+  cv::calcHist(&img, 1, &channel, cv::noArray(), expected, 1, &bins, &ranges);
+  for (int v = 0; v < 256; ++v)
+  {
+    ASSERT_EQ(hist.counts[v], static_cast<uint64_t>(expected.at<float>(v))) << v;
+  }
+
+  std::vector<double> sorted = values;
+  std::sort(sorted.begin(), sorted.end());
+  for (double p : {0.0, 0.01, 0.05, 0.2, 0.5, 0.95, 1.0})
+  {
+    // the smallest value with at least ceil(p * n) pixels at or below it, at least one
+    const size_t rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(p * sorted.size())));
+    EXPECT_EQ(histogramPercentile(hist, p), sorted[rank - 1]) << p;
+    EXPECT_NEAR(histogramQuantile(hist, p), numpyPercentile(values, p * 100), 1e-9) << p;
+  }
+
+  double mean = 0;
+  for (double v : values)
+  {
+    mean += v;
+  }
+  EXPECT_NEAR(histogramMean(hist), mean / values.size(), 1e-9);
+
+  // sampling keeps every step-th pixel, shifted by one per row
+  computeHistogram(img, hist, 3);
+  uint64_t sampled = 0;
+  for (int y = 0; y < img.rows; ++y)
+  {
+    sampled += (img.cols - y % 3 + 2) / 3;
+  }
+  EXPECT_EQ(hist.total, sampled);
+}
+
+TEST(HistogramTest, test16U)
+{
+  std::mt19937 rng(6);
+  std::uniform_int_distribution<int> level(0, 65535);
+  cv::Mat img(40, 50, CV_16UC1);
+  std::vector<uint64_t> expected(65536, 0);
+  for (int y = 0; y < img.rows; ++y)
+  {
+    for (int x = 0; x < img.cols; ++x)
+    {
+      img.at<ushort>(y, x) = static_cast<ushort>(level(rng));
+      ++expected[img.at<ushort>(y, x)];
+    }
+  }
+  Histogram hist;
+  computeHistogram(img, hist);
+  EXPECT_EQ(hist.counts, expected);
+  EXPECT_EQ(hist.cdf.back(), img.total());
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "image_analysis/image_profile.h"
+
+namespace
+{
+// numpy.percentile with the default linear interpolation, q in [0, 100]
+double numpyPercentile(std::vector<double> values, double q)
+{
+  std::sort(values.begin(), values.end());
+  const double pos = q / 100.0 * (values.size() - 1);
+  const size_t k   = static_cast<size_t>(std::floor(pos));
+  const double t   = pos - k;
+  const double a = values[k], b = values[std::min(k + 1, values.size() - 1)];
+  return t >= 0.5 ? b - (b - a) * (1 - t) : a + (b - a) * t;
+}
+
+// mean and variance of all values, as numpy mean / var
+std::pair<double, double> meanVariance(const std::vector<double> &values)
+{
+  double mean = 0;
+  for (double v : values)
+  {
+    mean += v;
+  }
+  mean /= values.size();
+  double var = 0;
+  for (double v : values)
+  {
+    var += (v - mean) * (v - mean);
+  }
+  return {mean, var / values.size()};
+}
+
+cv::Mat testImage(int rows, int cols, int type, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> noise(-40, 40);
+  cv::Mat img(rows, cols, type);
+  uchar *p = img.ptr<uchar>(0);
+  for (size_t i = 0; i < img.total() * img.channels(); ++i)
+  {
+    p[i] = cv::saturate_cast<uchar>(128 + 60 * std::sin(i * 0.01) + noise(rng));
+  }
+  return img;
+}
+} // namespace
+
+// every metric against the computation of script/image_property.py
+TEST(ImageProfileTest, matchesScript)
+{
+  for (int type : {CV_8UC1, CV_8UC3})
+  {
+    const cv::Mat img = testImage(61, 83, type, type + 1);
+    const int cn      = img.channels();
+    const ImageProfile profile = computeImageProfile(img);
+    EXPECT_EQ(profile.rows, img.rows);
+    EXPECT_EQ(profile.cols, img.cols);
+    EXPECT_EQ(profile.channels, cn);
+
+    std::set<std::tuple<int, int, int>> colors;
+    std::vector<double> values, laplacian, gray;
+    double brightness = 0;
+    cv::Mat lap, grayImg;
+    cv::Laplacian(img, lap, CV_64F);
+    if (cn == 3)
+    {
+      cv::cvtColor(img, grayImg, cv::COLOR_BGR2GRAY);
+    }
+    else
+    {
+      grayImg = img;
+    }
+    for (int y = 0; y < img.rows; ++y)
+    {
+      const uchar *row = img.ptr<uchar>(y);
+      const double *l  = lap.ptr<double>(y);
+      for (int x = 0; x < img.cols; ++x)
+      {
+        const uchar *px = row + cn * x;
+        colors.emplace(px[0], cn == 3 ? px[1] : 0, cn == 3 ? px[2] : 0);
+        brightness += *std::max_element(px, px + cn);
+        for (int c = 0; c < cn; ++c)
+        {
+          values.push_back(px[c]);
+          laplacian.push_back(l[cn * x + c]);
+        }
+        gray.push_back(grayImg.at<uchar>(y, x));
+      }
+    }
+
+    EXPECT_EQ(profile.uniqueColors, colors.size());
+    EXPECT_NEAR(profile.stddev, std::sqrt(meanVariance(values).second), 1e-9);
+    EXPECT_NEAR(profile.laplacianVariance, meanVariance(laplacian).second, 1e-6);
+    EXPECT_NEAR(profile.meanBrightness, brightness / img.total(), 1e-9);
+    EXPECT_NEAR(profile.p5, numpyPercentile(gray, 5), 1e-9);
+    EXPECT_NEAR(profile.p95, numpyPercentile(gray, 95), 1e-9);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "image_analysis/pixel_expr.h"
+
+// everything else is found through argument-dependent lookup on the expression operands
+using pixel_expr::lazy;
+
+// only node types of the header take part in its operators
+static_assert(pixel_expr::IsExpr<pixel_expr::ExprSource> && pixel_expr::IsExpr<pixel_expr::ExprConstant>);
+static_assert(!pixel_expr::IsExpr<cv::Mat> && !pixel_expr::IsExpr<double>);
+
+namespace
+{
+cv::Mat randomImage(int rows, int cols, int type, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  cv::Mat img(rows, cols, type);
+  uchar *p = img.ptr<uchar>(0);
+  for (size_t i = 0; i < img.total() * img.elemSize(); ++i)
+  {
+    p[i] = static_cast<uchar>(rng());
+  }
+  return img;
+}
+
+cv::Mat constant(const cv::Mat &like, double v) { return cv::Mat(like.size(), like.type(), cv::Scalar::all(v)); }
+
+// the step by step float result convert to ddepth, as the expression sink
+cv::Mat sink(const cv::Mat &values, int ddepth)
+{
+  cv::Mat out;
+  values.convertTo(out, ddepth);
+  return out;
+}
+} // namespace
+
+TEST(PixelExprTest, matchesOpenCV)
+{
+  // three channels and rows longer than one span
+  const cv::Mat a = randomImage(37, 157, CV_8UC3, 1), b = randomImage(37, 157, CV_8UC3, 2);
+  cv::Mat a32, b32;
+  a.convertTo(a32, CV_32F);
+  b.convertTo(b32, CV_32F);
+
+  // clamp((a - b) * 1.5 + a, 0, 255)
+  cv::Mat sharpened;
+  cv::subtract(a32, b32, sharpened);
+  cv::multiply(sharpened, constant(a32, 1.5), sharpened);
+  cv::add(sharpened, a32, sharpened);
+  cv::max(sharpened, constant(a32, 0), sharpened);
+  cv::min(sharpened, constant(a32, 255), sharpened);
+  const auto sharpenedExpr = clamp((lazy(a) - b) * 1.5 + a, 0, 255);
+
+  // (255 - a) / (b + 1) + sqrt(|a - b|) * 2 - min(a, b), constants on the left as well
+  cv::Mat mixed, denominator, root, smaller;
+  cv::subtract(constant(a32, 255), a32, mixed);
+  cv::add(b32, constant(b32, 1), denominator);
+  cv::divide(mixed, denominator, mixed);
+  cv::absdiff(a32, b32, root);
+  cv::sqrt(root, root);
+  cv::multiply(root, constant(root, 2), root);
+  cv::add(mixed, root, mixed);
+  cv::min(a32, b32, smaller);
+  cv::subtract(mixed, smaller, mixed);
+  const auto mixedExpr = (255.0 - lazy(a)) / (lazy(b) + 1.0) + sqrt(abs(lazy(a) - b)) * 2.0 - min(lazy(a), b);
+
+  // far outside [0, 255], so the 8U and 16U sinks saturate at both ends
+  cv::Mat wide;
+  cv::subtract(a32, b32, wide);
+  cv::multiply(wide, constant(wide, 300), wide);
+  const auto wideExpr = (lazy(a) - b) * 300.0;
+
+  for (int ddepth : {CV_8U, CV_16U, CV_32F})
+  {
+    EXPECT_EQ(cv::norm(sharpenedExpr.mat(ddepth), sink(sharpened, ddepth), cv::NORM_INF), 0) << ddepth;
+    EXPECT_EQ(cv::norm(mixedExpr.mat(ddepth), sink(mixed, ddepth), cv::NORM_INF), 0) << ddepth;
+    EXPECT_EQ(cv::norm(wideExpr.mat(ddepth), sink(wide, ddepth), cv::NORM_INF), 0) << ddepth;
+  }
+
+  // dst is one of the sources
+  cv::Mat inPlace = a.clone();
+  evaluate(clamp((lazy(inPlace) - b) * 1.5 + inPlace, 0, 255), inPlace, CV_8U);
+  EXPECT_EQ(cv::norm(inPlace, sink(sharpened, CV_8U), cv::NORM_INF), 0);
+  cv::Mat inPlace32 = a32.clone();
+  evaluate((255.0 - lazy(inPlace32)) / (lazy(b) + 1.0) + sqrt(abs(lazy(inPlace32) - b)) * 2.0 - min(lazy(inPlace32), b),
+           inPlace32, CV_32F);
+  EXPECT_EQ(cv::norm(inPlace32, mixed, cv::NORM_INF), 0);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "image_analysis/sharpen.h"
+
+namespace
+{
+cv::Mat testImage(int rows, int cols, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> noise(-25, 25);
+  cv::Mat img(rows, cols, CV_8UC1);
+  for (int y = 0; y < rows; ++y)
+  {
+    for (int x = 0; x < cols; ++x)
+    {
+      const int stripe = (x / 9) % 2 ? 90 : 0;
+      img.at<uchar>(y, x) = cv::saturate_cast<uchar>(50 + stripe + y * 80 / rows + noise(rng));
+    }
+  }
+  return img;
+}
+} // namespace
+
+TEST(SharpenTest, laplacianMatchesOpenCV)
+{
+  for (const cv::Size &size : {cv::Size(64, 48), cv::Size(1, 5), cv::Size(7, 1), cv::Size(2, 2)})
+  {
+    const cv::Mat img = testImage(size.height, size.width, size.area());
+    cv::Mat laplacian, laplacianAbs, expected, actual;
+    cv::Laplacian(img, laplacian, CV_16S, 3);
+    cv::convertScaleAbs(laplacian, laplacianAbs);
+    cv::addWeighted(img, 1.0, laplacianAbs, -1.0, 0, expected);
+    sharpenLaplacian(img, actual);
+    EXPECT_EQ(cv::norm(actual, expected, cv::NORM_INF), 0) << size.width << "x" << size.height;
+  }
+}
+
+TEST(SharpenTest, kernelMatchesOpenCV)
+{
+  for (const cv::Size &size : {cv::Size(64, 48), cv::Size(1, 5), cv::Size(7, 1), cv::Size(2, 2)})
+  {
+    const cv::Mat img = testImage(size.height, size.width, size.area());
+    cv::Mat kernel = (cv::Mat_<float>(3, 3) << 0, -1, 0, -1, 5, -1, 0, -1, 0);
+    cv::Mat expected, actual;
+    cv::filter2D(img, expected, img.depth(), kernel);
+    sharpenKernel(img, actual);
+    EXPECT_EQ(cv::norm(actual, expected, cv::NORM_INF), 0) << size.width << "x" << size.height;
+  }
+}
+
+TEST(SharpenTest, unsharpMaskNearOpenCV)
+{
+  const cv::Mat img = testImage(80, 120, 3);
+  for (double sigma : {1.0, 2.5})
+  {
+    cv::Mat blurred, expected, actual;
+    cv::GaussianBlur(img, blurred, cv::Size(0, 0), sigma);
+    cv::addWeighted(img, 1.5, blurred, -0.5, 0, expected);
+    unsharpMask(img, actual, sigma, 0.5);
+    EXPECT_LE(cv::norm(actual, expected, cv::NORM_INF), 1) << "sigma " << sigma;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
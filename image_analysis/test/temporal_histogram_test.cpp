@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+
+#include "image_analysis/temporal_histogram.h"
+
+TEST(TemporalHistogramTest, test1)
+{
+  TemporalHistogram temporal(3, 0.5);
+  // no pixel darker than 40
+  for (int v : {40, 60, 80, 100})
+  {
+    cv::Mat frame(16, 16, CV_8UC1, cv::Scalar(v));
+    frame(cv::Rect(0, 0, 16, 4)).setTo(cv::Scalar(v + 100));
+    temporal.update(frame);
+  }
+  EXPECT_EQ(temporal.frames(), 4);
+
+  // the window holds the last three frames
+  EXPECT_EQ(temporal.windowPercentile(0.0), 60);
+  EXPECT_EQ(temporal.windowPercentile(1.0), 200);
+  EXPECT_EQ(temporal.windowPercentile(0.5), 80);
+  // the decayed histogram still holds some of the first frame, its darkest level is 40
+  EXPECT_EQ(temporal.decayedPercentile(0.0), 40);
+  EXPECT_EQ(temporal.decayedPercentile(1.0), 200);
+  const Histogram &last = temporal.last();
+  EXPECT_EQ(histogramPercentile(last, 0.0), 100);
+  EXPECT_EQ(histogramPercentile(last, 1.0), 200);
+
+  temporal.reset();
+  EXPECT_EQ(temporal.decayedPercentile(0.0), 0);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+
+#include "image_analysis/tone_curve.h"
+
+namespace
+{
+cv::Mat randomImage(int rows, int cols, int type, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  const int maxValue = CV_MAT_DEPTH(type) == CV_16U ? 65535 : 255;
+  std::uniform_int_distribution<int> level(0, maxValue);
+  cv::Mat img(rows, cols, type);
+  const int width = cols * img.channels();
+  for (int y = 0; y < rows; ++y)
+  {
+    for (int x = 0; x < width; ++x)
+    {
+      if (img.depth() == CV_16U)
+      {
+        img.ptr<ushort>(y)[x] = static_cast<ushort>(level(rng));
+      }
+      else
+      {
+        img.ptr<uchar>(y)[x] = static_cast<uchar>(level(rng));
+      }
+    }
+  }
+  return img;
+}
+
+// the curve evaluated in double for every sample, rounded once
+cv::Mat referenceApply(const ToneCurve &curve, const cv::Mat &src)
+{
+  cv::Mat dst(src.size(), src.type());
+  const int width = src.cols * src.channels();
+  for (int y = 0; y < src.rows; ++y)
+  {
+    for (int x = 0; x < width; ++x)
+    {
+      if (src.depth() == CV_16U)
+      {
+        dst.ptr<ushort>(y)[x] = cv::saturate_cast<ushort>(curve(src.ptr<ushort>(y)[x] / 65535.0) * 65535.0);
+      }
+      else
+      {
+        dst.ptr<uchar>(y)[x] = cv::saturate_cast<uchar>(curve(src.ptr<uchar>(y)[x] / 255.0) * 255.0);
+      }
+    }
+  }
+  return dst;
+}
+} // namespace
+
+TEST(ToneCurveTest, table)
+{
+  const cv::Mat identity = ToneCurve().lut(CV_8U);
+  ASSERT_EQ(identity.total(), 256u);
+  ASSERT_EQ(identity.type(), CV_8U);
+  for (int i = 0; i < 256; ++i)
+  {
+    EXPECT_EQ(identity.at<uchar>(i), i);
+  }
+
+  const ToneCurve gamma = ToneCurve::gamma(2.0);
+  const cv::Mat table8  = gamma.lut(CV_8U);
+  for (int i = 0; i < 256; ++i)
+  {
+    EXPECT_EQ(table8.at<uchar>(i), cv::saturate_cast<uchar>(std::pow(i / 255.0, 2.0) * 255.0)) << i;
+  }
+  const cv::Mat table16 = gamma.lut(CV_16U);
+  ASSERT_EQ(table16.total(), 65536u);
+  ASSERT_EQ(table16.type(), CV_16U);
+  for (int i = 0; i < 65536; i += 97)
+  {
+    EXPECT_EQ(table16.at<ushort>(i), cv::saturate_cast<ushort>(std::pow(i / 65535.0, 2.0) * 65535.0)) << i;
+  }
+
+  // outputs beyond [0, 1] saturate
+  const cv::Mat bright = ToneCurve::brightnessContrast(2.0, 0.25).lut(CV_8U);
+  EXPECT_EQ(bright.at<uchar>(0), 64);
+  EXPECT_EQ(bright.at<uchar>(255), 255);
+  EXPECT_THROW(gamma.lut(CV_32F), cv::Exception);
+}
+
+TEST(ToneCurveTest, then)
+{
+  const ToneCurve a     = ToneCurve::brightnessContrast(1.5, -0.1);
+  const ToneCurve b     = ToneCurve::gamma(0.5);
+  const ToneCurve c     = ToneCurve::clamp(0.2, 0.9);
+  const ToneCurve chain = a.then(b).then(c);
+  for (double x = 0.0; x <= 1.0; x += 1.0 / 64)
+  {
+    EXPECT_DOUBLE_EQ(chain(x), c(b(a(x)))) << x;
+  }
+  // order matters, and composing does not change the parts
+  EXPECT_NE(b.then(a)(0.5), a.then(b)(0.5));
+  EXPECT_DOUBLE_EQ(a(0.5), 0.65);
+
+  // the chain rounds once, where two 8-bit tables in a row round twice
+  const cv::Mat table = a.then(b).lut(CV_8U);
+  int twice           = 0;
+  for (int i = 0; i < 256; ++i)
+  {
+    EXPECT_EQ(table.at<uchar>(i), cv::saturate_cast<uchar>(b(a(i / 255.0)) * 255.0)) << i;
+    const uchar first = cv::saturate_cast<uchar>(a(i / 255.0) * 255.0);
+    twice += table.at<uchar>(i) != cv::saturate_cast<uchar>(b(first / 255.0) * 255.0);
+  }
+  EXPECT_GT(twice, 0);
+}
+
+TEST(ToneCurveTest, applyMatchesReference)
+{
+  const ToneCurve curve = ToneCurve::sigmoid(0.45, 8.0).then(ToneCurve::gamma(0.8));
+  for (int type : {CV_8UC1, CV_8UC3, CV_16UC1, CV_16UC3})
+  {
+    const cv::Mat src      = randomImage(37, 53, type, type + 1);
+    const cv::Mat expected = referenceApply(curve, src);
+    cv::Mat dst;
+    curve.apply(src, dst);
+    EXPECT_EQ(dst.type(), type);
+    EXPECT_EQ(cv::norm(dst, expected, cv::NORM_INF), 0) << type;
+
+    // in place, and through a table built once
+    cv::Mat inPlace = src.clone();
+    curve.apply(inPlace, inPlace);
+    EXPECT_EQ(cv::norm(inPlace, expected, cv::NORM_INF), 0) << type;
+    cv::Mat reused;
+    applyToneLut(src, curve.lut(src.depth()), reused);
+    EXPECT_EQ(cv::norm(reused, expected, cv::NORM_INF), 0) << type;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
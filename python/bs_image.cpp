@@ -0,0 +1,678 @@
+// Python bindings of the edge, Harris and image_analysis kernels.
+//
+// Images come in through the buffer protocol (numpy arrays, memoryview, bytearray, bs_image.Image)
+// and are wrapped by a cv::Mat header in place, without a copy. Results are bs_image.Image objects
+// that own their cv::Mat and export it through the buffer protocol, so numpy.asarray(result) is a
+// view as well. Every kernel runs with the GIL released, other Python threads keep running and
+// several threads can call into the module at once.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <opencv2/opencv.hpp>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "canny.h"
+#include "prewitt.h"
+#include "roberts.h"
+#include "sobel.h"
+#include "feature_descriptor/harris.h"
+#include "image_analysis/blur.h"
+#include "image_analysis/clahe.h"
+#include "image_analysis/gradient_magnitude.h"
+#include "image_analysis/histogram.h"
+#include "image_analysis/image_profile.h"
+#include "image_analysis/sharpen.h"
+
+namespace
+{
+/**
+ * A new tuple or list of n items made by item(i). Returns nullptr, with the exception set, when
+ * the sequence or any item cannot be created; the items made so far are released.
+ */
+template <class Item>
+PyObject *newSequence(bool tuple, Py_ssize_t n, Item item)
+{
+  PyObject *seq = tuple ? PyTuple_New(n) : PyList_New(n);
+  for (Py_ssize_t i = 0; seq != nullptr && i < n; ++i)
+  {
+    PyObject *value = item(i);
+    if (value == nullptr)
+    {
+      Py_CLEAR(seq);
+    }
+    else if (tuple)
+    {
+      PyTuple_SET_ITEM(seq, i, value);
+    }
+    else
+    {
+      PyList_SET_ITEM(seq, i, value);
+    }
+  }
+  return seq;
+}
+
+// ---------------------------------------------------------------------------------------------
+// bs_image.Image: a cv::Mat exported through the buffer protocol
+
+struct ImageObject
+{
+  PyObject_HEAD
+  cv::Mat *mat;
+  // shape and strides handed out in Py_buffer, live as long as the object
+  Py_ssize_t shape[3];
+  Py_ssize_t strides[3];
+  char format[2];
+};
+
+const char *formatOf(int depth)
+{
+  switch (depth)
+  {
+  case CV_8U: return "B";
+  case CV_8S: return "b";
+  case CV_16U: return "H";
+  case CV_16S: return "h";
+  case CV_32S: return "i";
+  case CV_32F: return "f";
+  default: return "d";
+  }
+}
+
+int imageGetBuffer(PyObject *self, Py_buffer *view, int flags)
+{
+  ImageObject *image = reinterpret_cast<ImageObject *>(self);
+  const cv::Mat &m   = *image->mat;
+  const int ndim     = m.channels() > 1 ? 3 : 2;
+  const bool strided = (flags & PyBUF_STRIDES) == PyBUF_STRIDES;
+  if (!strided && !m.isContinuous())
+  {
+    PyErr_SetString(PyExc_BufferError, "image rows are not contiguous, request a strided buffer");
+    return -1;
+  }
+  view->buf        = m.data;
+  view->obj        = self;
+  view->len        = static_cast<Py_ssize_t>(m.rows) * m.cols * m.elemSize();
+  view->readonly   = 0;
+  view->itemsize   = static_cast<Py_ssize_t>(m.elemSize1());
+  view->format     = (flags & PyBUF_FORMAT) ? image->format : nullptr;
+  view->ndim       = ndim;
+  view->shape      = (flags & PyBUF_ND) == PyBUF_ND ? image->shape : nullptr;
+  view->strides    = strided ? image->strides : nullptr;
+  view->suboffsets = nullptr;
+  view->internal   = nullptr;
+  Py_INCREF(self);
+  return 0;
+}
+
+void imageDealloc(PyObject *self)
+{
+  delete reinterpret_cast<ImageObject *>(self)->mat;
+  Py_TYPE(self)->tp_free(self);
+}
+
+PyObject *imageShape(PyObject *self, void *)
+{
+  const ImageObject *image = reinterpret_cast<ImageObject *>(self);
+  const int ndim           = image->mat->channels() > 1 ? 3 : 2;
+  return newSequence(true, ndim, [image](Py_ssize_t i) { return PyLong_FromSsize_t(image->shape[i]); });
+}
+
+PyObject *imageRepr(PyObject *self)
+{
+  const cv::Mat &m = *reinterpret_cast<ImageObject *>(self)->mat;
+  return PyUnicode_FromFormat("bs_image.Image(rows=%d, cols=%d, channels=%d, format='%s')", m.rows, m.cols,
+                              m.channels(), formatOf(m.depth()));
+}
+
+PyBufferProcs imageBufferProcs = {imageGetBuffer, nullptr};
+
+PyGetSetDef imageGetSet[] = {
+  {"shape", imageShape, nullptr, "(rows, cols) or (rows, cols, channels)", nullptr},
+  {nullptr, nullptr, nullptr, nullptr, nullptr},
+};
+
+PyTypeObject ImageType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+// a new Image sharing the data of m by reference count
+PyObject *wrapImage(const cv::Mat &m)
+{
+  ImageObject *image = PyObject_New(ImageObject, &ImageType);
+  if (image == nullptr)
+  {
+    return nullptr;
+  }
+  image->mat        = new cv::Mat(m);
+  image->shape[0]   = m.rows;
+  image->shape[1]   = m.cols;
+  image->shape[2]   = m.channels();
+  image->strides[0] = static_cast<Py_ssize_t>(m.step[0]);
+  image->strides[1] = static_cast<Py_ssize_t>(m.elemSize());
+  image->strides[2] = static_cast<Py_ssize_t>(m.elemSize1());
+  image->format[0]  = formatOf(m.depth())[0];
+  image->format[1]  = '\0';
+  return reinterpret_cast<PyObject *>(image);
+}
+
+// ---------------------------------------------------------------------------------------------
+// input images
+
+/**
+ * A uint8 image borrowed from any object with the buffer protocol: shape (rows, cols) or (rows,
+ * cols, channels), pixels of a row packed, rows at any positive stride (numpy slices of rows and
+ * columns ranges work, flipped or channel-strided views do not). The buffer stays acquired, and
+ * the exporter cannot resize it, until the object goes out of scope.
+ */
+class InputImage
+{
+ public:
+  InputImage() = default;
+  InputImage(const InputImage &)            = delete;
+  InputImage &operator=(const InputImage &) = delete;
+  ~InputImage()
+  {
+    if (held_)
+    {
+      PyBuffer_Release(&view_);
+    }
+  }
+
+  // sets a Python error and returns false if obj is not such an image
+  bool acquire(PyObject *obj, bool gray_only)
+  {
+    if (PyObject_GetBuffer(obj, &view_, PyBUF_RECORDS_RO) != 0)
+    {
+      return false;
+    }
+    held_ = true;
+
+    const char *format = view_.format != nullptr ? view_.format : "B";
+    if (format[0] == '<' || format[0] == '>' || format[0] == '=' || format[0] == '@' || format[0] == '!')
+    {
+      ++format;
+    }
+    if (view_.itemsize != 1 || std::strcmp(format, "B") != 0)
+    {
+      return fail("expected a uint8 image");
+    }
+    if (view_.ndim != 2 && view_.ndim != 3)
+    {
+      return fail("expected an image of shape (rows, cols) or (rows, cols, channels)");
+    }
+    const Py_ssize_t rows     = view_.shape[0];
+    const Py_ssize_t cols     = view_.shape[1];
+    const Py_ssize_t channels = view_.ndim == 3 ? view_.shape[2] : 1;
+    if (rows <= 0 || cols <= 0 || channels < 1 || channels > 4)
+    {
+      return fail("expected a non-empty image with 1 to 4 channels");
+    }
+    if (gray_only && channels != 1)
+    {
+      return fail("expected a single-channel image");
+    }
+    const bool packed = view_.strides[1] == channels && (view_.ndim == 2 || view_.strides[2] == 1);
+    if (!packed || view_.strides[0] < cols * channels)
+    {
+      return fail("image pixels must be packed within a row and rows must not overlap");
+    }
+    mat_ = cv::Mat(static_cast<int>(rows), static_cast<int>(cols), CV_8UC(static_cast<int>(channels)), view_.buf,
+                   static_cast<size_t>(view_.strides[0]));
+    return true;
+  }
+
+  // read only, the kernels do not write their inputs
+  cv::Mat &mat() { return mat_; }
+
+ private:
+  bool fail(const char *message)
+  {
+    PyErr_SetString(PyExc_ValueError, message);
+    return false;
+  }
+
+  Py_buffer view_;
+  bool held_ = false;
+  cv::Mat mat_;
+};
+
+// runs f with the GIL released; an exception from f becomes a RuntimeError
+template <class F>
+bool runWithoutGil(F &&f)
+{
+  std::string error;
+  bool failed           = false;
+  PyThreadState *thread = PyEval_SaveThread();
+  try
+  {
+    f();
+  }
+  catch (const std::exception &e)
+  {
+    failed = true;
+    error  = e.what();
+  }
+  PyEval_RestoreThread(thread);
+  if (failed)
+  {
+    PyErr_SetString(PyExc_RuntimeError, error.c_str());
+  }
+  return !failed;
+}
+
+// parses (image) for the functions of a single gray image
+bool parseGray(PyObject *args, PyObject *kwargs, InputImage &in)
+{
+  static const char *keywords[] = {"image", nullptr};
+  PyObject *obj                 = nullptr;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", const_cast<char **>(keywords), &obj))
+  {
+    return false;
+  }
+  return in.acquire(obj, true);
+}
+
+// ---------------------------------------------------------------------------------------------
+// edge_dection
+
+PyObject *pyCanny(PyObject *, PyObject *args, PyObject *kwargs)
+{
+  static const char *keywords[] = {"image", "low", "high", nullptr};
+  PyObject *obj                 = nullptr;
+  double low = 40.0, high = 80.0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|dd", const_cast<char **>(keywords), &obj, &low, &high))
+  {
+    return nullptr;
+  }
+  InputImage in;
+  if (!in.acquire(obj, true))
+  {
+    return nullptr;
+  }
+  cv::Mat dst;
+  const bool ok = runWithoutGil([&]() {
+    cv::Mat blurred, gradXY, theta, suppressed;
+    gaussianFilter(in.mat(), blurred);
+    getGrandient(blurred, gradXY, theta);
+    nonLocalMaxValue(gradXY, theta, suppressed);
+    doubleThreshold(low, high, suppressed, dst);
+  });
+  return ok ? wrapImage(dst) : nullptr;
+}
+
+// |Gx| + |Gy| of 3x3 kernels; border pixels keep the input, as Sobel and Prewitt leave them
+template <void (*Filter)(cv::Mat &, cv::Mat &, cv::Mat &, cv::Mat &)>
+PyObject *absGradient(PyObject *args, PyObject *kwargs, const float (&kx)[9], const float (&ky)[9])
+{
+  InputImage in;
+  if (!parseGray(args, kwargs, in))
+  {
+    return nullptr;
+  }
+  cv::Mat dst;
+  const bool ok = runWithoutGil([&]() {
+    cv::Mat kernel_x = cv::Mat(3, 3, CV_32FC1, const_cast<float *>(kx));
+    cv::Mat kernel_y = cv::Mat(3, 3, CV_32FC1, const_cast<float *>(ky));
+    dst              = in.mat().clone();
+    Filter(in.mat(), dst, kernel_x, kernel_y);
+  });
+  return ok ? wrapImage(dst) : nullptr;
+}
+
+PyObject *pySobel(PyObject *, PyObject *args, PyObject *kwargs)
+{
+  static const float kx[9] = {-1, 0, 1, -2, 0, 2, -1, 0, 1};
+  static const float ky[9] = {-1, -2, -1, 0, 0, 0, 1, 2, 1};
+  return absGradient<Sobel>(args, kwargs, kx, ky);
+}
+
+PyObject *pyPrewitt(PyObject *, PyObject *args, PyObject *kwargs)
+{
+  static const float kx[9] = {-1, 0, 1, -1, 0, 1, -1, 0, 1};
+  static const float ky[9] = {-1, -1, -1, 0, 0, 0, 1, 1, 1};
+  return absGradient<Prewitt>(args, kwargs, kx, ky);
+}
+
+PyObject *pyRoberts(PyObject *, PyObject *args, PyObject *kwargs)
+{
+  InputImage in;
+  if (!parseGray(args, kwargs, in))
+  {
+    return nullptr;
+  }
+  cv::Mat dst;
+  const bool ok = runWithoutGil([&]() { dst = roberts(in.mat()); });
+  return ok ? wrapImage(dst) : nullptr;
+}
+
+// ---------------------------------------------------------------------------------------------
+// feature_descriptor
+
+PyObject *pyHarrisCorners(PyObject *, PyObject *args, PyObject *kwargs)
+{
+  InputImage in;
+  if (!parseGray(args, kwargs, in))
+  {
+    return nullptr;
+  }
+  cv::Mat dst;
+  const bool ok = runWithoutGil([&]() {
+    // one detector per thread, its buffers are reused by the next call of that thread
+    thread_local Harris harris;
+    std::vector<cv::Point> corners;
+    harris.detect(in.mat(), corners);
+    dst.create(static_cast<int>(corners.size()), 2, CV_32SC1);
+    if (!corners.empty())
+    {
+      std::memcpy(dst.data, corners.data(), corners.size() * sizeof(cv::Point));
+    }
+  });
+  return ok ? wrapImage(dst) : nullptr;
+}
+
+// ---------------------------------------------------------------------------------------------
+// image_analysis
+
+PyObject *pyProfile(PyObject *, PyObject *args, PyObject *kwargs)
+{
+  static const char *keywords[] = {"image", nullptr};
+  PyObject *obj                 = nullptr;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", const_cast<char **>(keywords), &obj))
+  {
+    return nullptr;
+  }
+  InputImage in;
+  if (!in.acquire(obj, false))
+  {
+    return nullptr;
+  }
+  ImageProfile p;
+  int p5 = 0, p95 = 0;
+  if (!runWithoutGil([&]() {
+        // the module's one percentile definition, see pyPercentiles, not the interpolated p5 / p95
+        Histogram hist;
+        p   = computeImageProfile(in.mat(), &hist);
+        p5  = histogramPercentile(hist, 0.05);
+        p95 = histogramPercentile(hist, 0.95);
+      }))
+  {
+    return nullptr;
+  }
+  return Py_BuildValue("{s:i,s:i,s:i,s:K,s:d,s:i,s:i,s:d,s:d}", "rows", p.rows, "cols", p.cols, "channels",
+                       p.channels, "unique_colors", static_cast<unsigned long long>(p.uniqueColors), "stddev",
+                       p.stddev, "p5", p5, "p95", p95, "laplacian_variance", p.laplacianVariance,
+                       "mean_brightness", p.meanBrightness);
+}
+
+PyObject *pyHistogram(PyObject *, PyObject *args, PyObject *kwargs)
+{
+  InputImage in;
+  if (!parseGray(args, kwargs, in))
+  {
+    return nullptr;
+  }
+  Histogram hist;
+  if (!runWithoutGil([&]() { computeHistogram(in.mat(), hist); }))
+  {
+    return nullptr;
+  }
+  return newSequence(false, static_cast<Py_ssize_t>(hist.counts.size()),
+                     [&hist](Py_ssize_t i) { return PyLong_FromUnsignedLongLong(hist.counts[i]); });
+}
+
+// smallest gray level whose cumulative share of the pixels reaches p, i.e.
+// np.searchsorted(cdf / total, p) of script/brightness.py; p = 0 gives the darkest level present
+PyObject *pyPercentiles(PyObject *, PyObject *args, PyObject *kwargs)
+{
+  static const char *keywords[] = {"image", "fractions", nullptr};
+  PyObject *obj = nullptr, *fractions = nullptr;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO", const_cast<char **>(keywords), &obj, &fractions))
+  {
+    return nullptr;
+  }
+  PyObject *seq = PySequence_Fast(fractions, "fractions must be a sequence of numbers in [0, 1]");
+  if (seq == nullptr)
+  {
+    return nullptr;
+  }
+  std::vector<double> ps(PySequence_Fast_GET_SIZE(seq));
+  for (size_t i = 0; i < ps.size(); ++i)
+  {
+    ps[i] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(seq, i));
+  }
+  Py_DECREF(seq);
+  if (PyErr_Occurred())
+  {
+    return nullptr;
+  }
+
+  InputImage in;
+  if (!in.acquire(obj, true))
+  {
+    return nullptr;
+  }
+  std::vector<int> values(ps.size());
+  if (!runWithoutGil([&]() {
+        Histogram hist;
+        computeHistogram(in.mat(), hist);
+        for (size_t i = 0; i < ps.size(); ++i)
+        {
+          values[i] = histogramPercentile(hist, ps[i]);
+        }
+      }))
+  {
+    return nullptr;
+  }
+  return newSequence(false, static_cast<Py_ssize_t>(values.size()),
+                     [&values](Py_ssize_t i) { return PyLong_FromLong(values[i]); });
+}
+
+PyObject *pyClahe(PyObject *, PyObject *args, PyObject *kwargs)
+{
+  static const char *keywords[] = {"image", "clip_limit", "tiles", nullptr};
+  PyObject *obj                 = nullptr;
+  double clip_limit             = 2.0;
+  int tiles                     = 8;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|di", const_cast<char **>(keywords), &obj, &clip_limit, &tiles))
+  {
+    return nullptr;
+  }
+  InputImage in;
+  if (!in.acquire(obj, true))
+  {
+    return nullptr;
+  }
+  cv::Mat dst;
+  const bool ok = runWithoutGil([&]() { claheGray(in.mat(), dst, clip_limit, cv::Size(tiles, tiles)); });
+  return ok ? wrapImage(dst) : nullptr;
+}
+
+PyObject *pyGradientMagnitude(PyObject *, PyObject *args, PyObject *kwargs)
+{
+  static const char *keywords[] = {"image", "kernel", "range", nullptr};
+  PyObject *obj                 = nullptr;
+  const char *kernel            = "sobel";
+  double range                  = 0.0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|sd", const_cast<char **>(keywords), &obj, &kernel, &range))
+  {
+    return nullptr;
+  }
+  GradientKernel k;
+  if (std::strcmp(kernel, "sobel") == 0)
+  {
+    k = GradientKernel::Sobel;
+  }
+  else if (std::strcmp(kernel, "scharr") == 0)
+  {
+    k = GradientKernel::Scharr;
+  }
+  else
+  {
+    PyErr_SetString(PyExc_ValueError, "kernel must be 'sobel' or 'scharr'");
+    return nullptr;
+  }
+  InputImage in;
+  if (!in.acquire(obj, true))
+  {
+    return nullptr;
+  }
+  cv::Mat dst;
+  const bool ok = runWithoutGil([&]() { gradientMagnitude(in.mat(), dst, k, range); });
+  return ok ? wrapImage(dst) : nullptr;
+}
+
+PyObject *pyUnsharpMask(PyObject *, PyObject *args, PyObject *kwargs)
+{
+  static const char *keywords[] = {"image", "sigma", "amount", nullptr};
+  PyObject *obj                 = nullptr;
+  double sigma = 1.0, amount = 0.5;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|dd", const_cast<char **>(keywords), &obj, &sigma, &amount))
+  {
+    return nullptr;
+  }
+  InputImage in;
+  if (!in.acquire(obj, true))
+  {
+    return nullptr;
+  }
+  cv::Mat dst;
+  const bool ok = runWithoutGil([&]() { unsharpMask(in.mat(), dst, sigma, amount); });
+  return ok ? wrapImage(dst) : nullptr;
+}
+
+PyObject *pySharpenLaplacian(PyObject *, PyObject *args, PyObject *kwargs)
+{
+  InputImage in;
+  if (!parseGray(args, kwargs, in))
+  {
+    return nullptr;
+  }
+  cv::Mat dst;
+  const bool ok = runWithoutGil([&]() { sharpenLaplacian(in.mat(), dst); });
+  return ok ? wrapImage(dst) : nullptr;
+}
+
+PyObject *pySharpenKernel(PyObject *, PyObject *args, PyObject *kwargs)
+{
+  InputImage in;
+  if (!parseGray(args, kwargs, in))
+  {
+    return nullptr;
+  }
+  cv::Mat dst;
+  const bool ok = runWithoutGil([&]() { sharpenKernel(in.mat(), dst); });
+  return ok ? wrapImage(dst) : nullptr;
+}
+
+PyObject *pyFocusScore(PyObject *, PyObject *args, PyObject *kwargs)
+{
+  static const char *keywords[] = {"image", "metric", nullptr};
+  PyObject *obj                 = nullptr;
+  const char *metric            = "laplacian";
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|s", const_cast<char **>(keywords), &obj, &metric))
+  {
+    return nullptr;
+  }
+  FocusMetric m;
+  if (std::strcmp(metric, "laplacian") == 0)
+  {
+    m = FocusMetric::Laplacian;
+  }
+  else if (std::strcmp(metric, "tenengrad") == 0)
+  {
+    m = FocusMetric::Tenengrad;
+  }
+  else if (std::strcmp(metric, "fft") == 0)
+  {
+    m = FocusMetric::FFT;
+  }
+  else
+  {
+    PyErr_SetString(PyExc_ValueError, "metric must be 'laplacian', 'tenengrad' or 'fft'");
+    return nullptr;
+  }
+  InputImage in;
+  if (!in.acquire(obj, true))
+  {
+    return nullptr;
+  }
+  double score = 0.0;
+  if (!runWithoutGil([&]() { score = focusScore(in.mat(), m); }))
+  {
+    return nullptr;
+  }
+  return PyFloat_FromDouble(score);
+}
+
+#define BS_IMAGE_METHOD(name, function, doc) \
+  {name, reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(function)), METH_VARARGS | METH_KEYWORDS, doc}
+
+PyMethodDef methods[] = {
+  BS_IMAGE_METHOD("canny", pyCanny, "canny(image, low=40.0, high=80.0) -> Image\n\nEdges of a uint8 gray image, 255 on edges."),
+  BS_IMAGE_METHOD("sobel", pySobel, "sobel(image) -> Image\n\n|Gx| + |Gy| of the 3x3 Sobel kernels, saturated."),
+  BS_IMAGE_METHOD("prewitt", pyPrewitt, "prewitt(image) -> Image\n\n|Gx| + |Gy| of the 3x3 Prewitt kernels, saturated."),
+  BS_IMAGE_METHOD("roberts", pyRoberts, "roberts(image) -> Image\n\nRoberts cross gradient magnitude."),
+  BS_IMAGE_METHOD("harris_corners", pyHarrisCorners,
+                  "harris_corners(image) -> Image\n\nHarris corners as an int32 array of shape (n, 2), one (x, y) per row."),
+  BS_IMAGE_METHOD("profile", pyProfile,
+                  "profile(image) -> dict\n\nResolution, unique colors, stddev, p5 / p95 (as percentiles), Laplacian "
+                  "variance and mean brightness of a gray or BGR image in one pass."),
+  BS_IMAGE_METHOD("histogram", pyHistogram, "histogram(image) -> list\n\nThe 256 gray level counts."),
+  BS_IMAGE_METHOD("percentiles", pyPercentiles,
+                  "percentiles(image, fractions) -> list\n\nSmallest gray levels whose cumulative share of the pixels "
+                  "reaches each fraction (0 to 1), as script/brightness.py."),
+  BS_IMAGE_METHOD("clahe", pyClahe, "clahe(image, clip_limit=2.0, tiles=8) -> Image\n\nContrast limited adaptive equalization."),
+  BS_IMAGE_METHOD("gradient_magnitude", pyGradientMagnitude,
+                  "gradient_magnitude(image, kernel='sobel', range=0.0) -> Image\n\nGradient magnitude scaled to uint8; "
+                  "range maps that magnitude to 255, 0 normalizes min-max."),
+  BS_IMAGE_METHOD("unsharp_mask", pyUnsharpMask, "unsharp_mask(image, sigma=1.0, amount=0.5) -> Image"),
+  BS_IMAGE_METHOD("sharpen_laplacian", pySharpenLaplacian, "sharpen_laplacian(image) -> Image\n\nimage - |Laplacian|."),
+  BS_IMAGE_METHOD("sharpen_kernel", pySharpenKernel, "sharpen_kernel(image) -> Image\n\n3x3 sharpening kernel."),
+  BS_IMAGE_METHOD("focus_score", pyFocusScore,
+                  "focus_score(image, metric='laplacian') -> float\n\nSharpness by 'laplacian', 'tenengrad' or 'fft', higher is sharper."),
+  {nullptr, nullptr, 0, nullptr},
+};
+#undef BS_IMAGE_METHOD
+
+PyModuleDef moduleDef = {
+  PyModuleDef_HEAD_INIT,
+  "bs_image",
+  "Native image kernels. Inputs are any uint8 buffers (numpy arrays, ...) read in place; outputs are "
+  "bs_image.Image objects, numpy.asarray(image) views them without a copy. The GIL is released while "
+  "a kernel runs.",
+  -1,
+  methods,
+};
+} // namespace
+
+PyMODINIT_FUNC PyInit_bs_image(void)
+{
+  ImageType.tp_name      = "bs_image.Image";
+  ImageType.tp_basicsize = sizeof(ImageObject);
+  ImageType.tp_flags     = Py_TPFLAGS_DEFAULT;
+  ImageType.tp_doc       = "An image owned by the native side, exported through the buffer protocol.";
+  ImageType.tp_dealloc   = imageDealloc;
+  ImageType.tp_repr      = imageRepr;
+  ImageType.tp_as_buffer = &imageBufferProcs;
+  ImageType.tp_getset    = imageGetSet;
+  if (PyType_Ready(&ImageType) < 0)
+  {
+    return nullptr;
+  }
+
+  PyObject *module = PyModule_Create(&moduleDef);
+  if (module == nullptr)
+  {
+    return nullptr;
+  }
+  Py_INCREF(&ImageType);
+  if (PyModule_AddObject(module, "Image", reinterpret_cast<PyObject *>(&ImageType)) < 0)
+  {
+    Py_DECREF(&ImageType);
+    Py_DECREF(module);
+    return nullptr;
+  }
+  return module;
+}
@@ -0,0 +1,47 @@
+// Runs a kernel of the module from C++ for test_bs_image.py:
+//   bs_image_reference canny <in.pgm> <out.pgm> <low> <high>
+//   bs_image_reference gradient_magnitude <in.pgm> <out.pgm>
+// Calls the kernels exactly as bs_image.cpp does, so the outputs must be byte-identical.
+
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <string>
+
+#include "canny.h"
+#include "image_analysis/gradient_magnitude.h"
+
+int main(int argc, char **argv)
+{
+  if (argc < 4)
+  {
+    std::cerr << "usage: bs_image_reference canny|gradient_magnitude <in.pgm> <out.pgm> [low high]" << std::endl;
+    return 2;
+  }
+  const std::string op = argv[1];
+  cv::Mat src          = cv::imread(argv[2], cv::IMREAD_GRAYSCALE);
+  if (src.empty())
+  {
+    std::cerr << "cannot read " << argv[2] << std::endl;
+    return 1;
+  }
+
+  cv::Mat dst;
+  if (op == "canny" && argc == 6)
+  {
+    cv::Mat blurred, gradXY, theta, suppressed;
+    gaussianFilter(src, blurred);
+    getGrandient(blurred, gradXY, theta);
+    nonLocalMaxValue(gradXY, theta, suppressed);
+    doubleThreshold(std::stod(argv[4]), std::stod(argv[5]), suppressed, dst);
+  }
+  else if (op == "gradient_magnitude")
+  {
+    gradientMagnitude(src, dst);
+  }
+  else
+  {
+    std::cerr << "unknown operation " << op << std::endl;
+    return 2;
+  }
+  return cv::imwrite(argv[3], dst) ? 0 : 1;
+}
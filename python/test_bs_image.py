@@ -0,0 +1,117 @@
+"""Smoke test of the bs_image module, registered with ctest:
+
+    python3 test_bs_image.py <directory of the module> <bs_image_reference executable>
+"""
+import os
+import subprocess
+import sys
+import tempfile
+import unittest
+
+import numpy as np
+
+MODULE_DIR, REFERENCE = sys.argv[1], sys.argv[2]
+sys.path.insert(0, MODULE_DIR)
+import bs_image  # noqa: E402
+
+
+def test_image(rows, cols, seed):
+    # a bright square on a ramp with noise, so there are strong and weak edges
+    rng = np.random.default_rng(seed)
+    y, x = np.mgrid[0:rows, 0:cols]
+    img = 40 + x * 60 // cols + rng.integers(-20, 21, (rows, cols))
+    img[rows // 4:rows * 3 // 4, cols // 3:cols // 2] += 120
+    return np.clip(img, 0, 255).astype(np.uint8)
+
+
+def write_pgm(path, img):
+    with open(path, "wb") as f:
+        f.write(b"P5\n%d %d\n255\n" % (img.shape[1], img.shape[0]))
+        f.write(np.ascontiguousarray(img).tobytes())
+
+
+def read_pgm(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    # magic, width, height, maxval, then one whitespace byte before the pixels
+    fields, pos = [], 0
+    while len(fields) < 4:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        end = pos
+        while not data[end:end + 1].isspace():
+            end += 1
+        fields.append(data[pos:end])
+        pos = end
+    cols, rows = int(fields[1]), int(fields[2])
+    return np.frombuffer(data[pos + 1:pos + 1 + rows * cols], np.uint8).reshape(rows, cols)
+
+
+class BsImageTest(unittest.TestCase):
+    def setUp(self):
+        self.img = test_image(96, 128, 1)
+
+    def test_import(self):
+        self.assertTrue(isinstance(bs_image.Image, type))
+        for name in ("canny", "sobel", "harris_corners", "profile", "percentiles", "clahe", "gradient_magnitude"):
+            self.assertTrue(callable(getattr(bs_image, name)), name)
+
+    def test_canny(self):
+        edges = np.asarray(bs_image.canny(self.img, 40, 80))
+        self.assertEqual(edges.shape, self.img.shape)
+        self.assertEqual(edges.dtype, np.uint8)
+        self.assertTrue(edges.any())
+
+    def test_slices(self):
+        # a range of rows and columns is read in place, at the stride of the full array
+        view = self.img[5:81, 7:110]
+        self.assertFalse(view.flags["C_CONTIGUOUS"])
+        expected = np.asarray(bs_image.canny(np.ascontiguousarray(view), 40, 80))
+        np.testing.assert_array_equal(np.asarray(bs_image.canny(view, 40, 80)), expected)
+        rows = self.img[10:50]
+        np.testing.assert_array_equal(np.asarray(bs_image.canny(rows)), np.asarray(bs_image.canny(rows.copy())))
+
+    def test_result_shares_memory(self):
+        result = bs_image.canny(self.img)
+        a, b = np.asarray(result), np.asarray(result)
+        self.assertTrue(np.shares_memory(a, b))
+        # a write through the numpy view is seen through the buffer of the result itself
+        a[3, 4] = 123
+        self.assertEqual(memoryview(result)[3, 4], 123)
+        # the view keeps the native image alive
+        del result
+        self.assertEqual(a[3, 4], 123)
+
+    def test_rejects(self):
+        with self.assertRaises(ValueError):
+            bs_image.canny(self.img.astype(np.float32))
+        with self.assertRaises(ValueError):
+            bs_image.canny(self.img[::-1])
+        with self.assertRaises(ValueError):
+            bs_image.canny(self.img[:, ::-1])
+        with self.assertRaises(ValueError):
+            bs_image.canny(np.dstack([self.img, self.img]))
+
+    def test_percentiles(self):
+        # the definition of script/brightness.py, for percentiles and the p5 / p95 of profile alike
+        fractions = [0.05, 0.2, 0.5, 0.8, 0.95, 1.0]
+        cdf = np.bincount(self.img.ravel(), minlength=256).cumsum()
+        expected = [int(np.searchsorted(cdf / cdf[-1], p)) for p in fractions]
+        self.assertEqual(bs_image.percentiles(self.img, fractions), expected)
+        self.assertEqual(bs_image.percentiles(self.img, [0.0]), [int(self.img.min())])
+        profile = bs_image.profile(self.img)
+        self.assertEqual((profile["p5"], profile["p95"]), (expected[0], expected[4]))
+
+    def test_matches_cpp(self):
+        img = self.img[3:90, 2:121]
+        with tempfile.TemporaryDirectory() as tmp:
+            src, dst = os.path.join(tmp, "in.pgm"), os.path.join(tmp, "out.pgm")
+            write_pgm(src, img)
+            subprocess.run([REFERENCE, "canny", src, dst, "40", "80"], check=True)
+            np.testing.assert_array_equal(np.asarray(bs_image.canny(img, 40, 80)), read_pgm(dst))
+            subprocess.run([REFERENCE, "gradient_magnitude", src, dst], check=True)
+            np.testing.assert_array_equal(np.asarray(bs_image.gradient_magnitude(img)), read_pgm(dst))
+
+
+if __name__ == "__main__":
+    unittest.main(argv=sys.argv[:1])